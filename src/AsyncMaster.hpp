@@ -0,0 +1,526 @@
+#ifndef MODBUS_ASYNCMASTER_HPP
+#define MODBUS_ASYNCMASTER_HPP
+
+/** Coroutine API on top of TCPReactor
+ *
+ * This header is empty unless the compiler supports C++20 coroutines, so
+ * that it can be installed alongside the rest of the library, which builds
+ * in C++11
+ */
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include <modbus/common.hpp>
+#include <modbus/Functions.hpp>
+#include <modbus/TCP.hpp>
+#include <modbus/TCPReactor.hpp>
+
+namespace modbus {
+    /** A coroutine that runs a conversation with one or more devices
+     *
+     * The coroutine starts immediately, and runs until its first suspension.
+     * It is then resumed from the reactor thread as replies arrive. A Task
+     * may be co_await'ed by another Task.
+     *
+     * The Task object owns the coroutine, and must be kept alive until done()
+     * returns true
+     */
+    class Task {
+    public:
+        struct promise_type {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+
+            Task get_return_object() {
+                return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle
+                ) noexcept {
+                    auto continuation = handle.promise().continuation;
+                    if (continuation) {
+                        return continuation;
+                    }
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception() {
+                error = std::current_exception();
+            }
+        };
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+
+        explicit Task(std::coroutine_handle<promise_type> handle)
+            : m_handle(handle) {
+        }
+
+    public:
+        Task(Task&& other) noexcept
+            : m_handle(other.m_handle) {
+            other.m_handle = nullptr;
+        }
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (m_handle) {
+                    m_handle.destroy();
+                }
+                m_handle = other.m_handle;
+                other.m_handle = nullptr;
+            }
+            return *this;
+        }
+
+        Task(Task const&) = delete;
+        Task& operator=(Task const&) = delete;
+
+        ~Task() {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+        }
+
+        /** Whether the coroutine finished */
+        bool done() const {
+            return !m_handle || m_handle.done();
+        }
+
+        /** Rethrows the exception that terminated the coroutine, if any */
+        void get() const {
+            if (m_handle && m_handle.promise().error) {
+                std::rethrow_exception(m_handle.promise().error);
+            }
+        }
+
+        bool await_ready() const noexcept {
+            return done();
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            m_handle.promise().continuation = awaiting;
+        }
+
+        void await_resume() const {
+            get();
+        }
+    };
+
+    /** Awaitable Modbus transactions with one TCP device
+     *
+     * The operations are the asynchronous counterparts of the
+     * MasterInterface ones. They go through a TCPReactor, and suspend the
+     * calling coroutine until the reply arrives, so that thousands of
+     * conversations may be written as straight-line code and run on the
+     * reactor thread:
+     *
+     * <code>
+     * Task poll(AsyncMaster& device, uint16_t* values) {
+     *     Result result = co_await device.readRegisters(values, 1, false, 0, 10);
+     *     if (result.ok()) {
+     *         co_await device.writeSingleRegister(1, 0x100, values[0]);
+     *     }
+     * }
+     * </code>
+     *
+     * Reads and multiple writes longer than the protocol's maximum are split
+     * into several requests, sent one after the other. Unlike the masters,
+     * the blocks are always of the protocol's maximum size, as there is no
+     * per-slave block size (MasterInterface::setMaxReadBlockSize). The first
+     * failed request ends the operation.
+     *
+     * Invalid ranges throw std::invalid_argument when the operation is
+     * created or awaited. Output buffers must stay valid until the operation
+     * completes.
+     */
+    class AsyncMaster {
+        TCPReactor& m_reactor;
+        int m_connection;
+
+        /** The payload of a request formatted by one of the TCP functions */
+        static std::vector<uint8_t> payloadOf(uint8_t const* frame, uint8_t const* end) {
+            return std::vector<uint8_t>(frame + TCP::FRAME_OVERHEAD_SIZE, end);
+        }
+
+        static void validateRange(char const* message, int start, int count) {
+            if (count < 1 || start < 0 || count > 65536 - start) {
+                throw std::invalid_argument(message);
+            }
+        }
+
+        /** Send one request per block of at most block_size elements, and
+         * resume the coroutine after the last one or the first that fails
+         *
+         * @param format called with the offset and size of a block, returns
+         *   the payload of its request. It must not throw for the blocks
+         *   after the first, so the range must be validated beforehand
+         * @param process called with the offset and size of a block and its
+         *   reply, returns the result of the block
+         */
+        template<typename Format, typename Process>
+        void submitBlocks(Result& result, std::coroutine_handle<> handle,
+                          int address, int function, int count, int block_size,
+                          Format format, Process process, int offset = 0) {
+            int size = std::min(count - offset, block_size);
+            m_reactor.request(
+                m_connection, address, function, format(offset, size),
+                [this, &result, handle, address, function, count, block_size,
+                 format, process, offset, size](Result const& r, FrameView const& frame) {
+                    Result block = r.ok() ? process(offset, size, frame) : r;
+                    if (block.ok() && offset + size < count) {
+                        submitBlocks(result, handle, address, function, count,
+                                     block_size, format, process, offset + size);
+                    }
+                    else {
+                        result = block;
+                        handle.resume();
+                    }
+                }
+            );
+        }
+
+        /** Operation made of a single request */
+        template<typename Format, typename Process>
+        auto makeSingleOperation(int address, int function,
+                                 Format format, Process process) {
+            return makeOperation(
+                [this, address, function, format, process](
+                    Result& result, std::coroutine_handle<> handle
+                ) {
+                    submitBlocks(
+                        result, handle, address, function, 1, 1,
+                        [format](int, int) { return format(); },
+                        [process](int, int, FrameView const& frame) {
+                            return process(frame);
+                        }
+                    );
+                }
+            );
+        }
+
+    public:
+        /** Awaiter common to all operations */
+        template<typename Submit>
+        class Operation {
+            Submit m_submit;
+            Result m_result;
+
+        public:
+            explicit Operation(Submit submit)
+                : m_submit(submit) {
+            }
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                m_submit(m_result, handle);
+            }
+
+            Result await_resume() const noexcept {
+                return m_result;
+            }
+        };
+
+        template<typename Submit>
+        static Operation<Submit> makeOperation(Submit submit) {
+            return Operation<Submit>(submit);
+        }
+
+        AsyncMaster(TCPReactor& reactor, int connection)
+            : m_reactor(reactor)
+            , m_connection(connection) {
+        }
+
+        /** The reactor the transactions go through */
+        TCPReactor& getReactor() const {
+            return m_reactor;
+        }
+
+        /** The index of the device's connection in the reactor */
+        int getConnection() const {
+            return m_connection;
+        }
+
+        /** Send a request and wait for the reply
+         *
+         * @param reply the reply frame, set only on success
+         */
+        auto request(Frame& reply, int address, int function,
+                     std::vector<uint8_t> const& payload) {
+            return makeOperation(
+                [this, &reply, address, function, payload](
+                    Result& result, std::coroutine_handle<> handle
+                ) {
+                    m_reactor.request(
+                        m_connection, address, function, payload,
+                        [&result, &reply, handle](Result const& r, FrameView const& frame) {
+                            result = r;
+                            if (r.ok()) {
+                                frame.copyTo(reply);
+                            }
+                            handle.resume();
+                        }
+                    );
+                }
+            );
+        }
+
+        /** Read a set of registers
+         *
+         * @see MasterInterface::readRegisters
+         */
+        auto readRegisters(uint16_t* values, int address, bool input_registers,
+                           int start, int length) {
+            validateRange("AsyncMaster::readRegisters: invalid register range",
+                          start, length);
+            int function = input_registers ? FUNCTION_READ_INPUT_REGISTERS :
+                                             FUNCTION_READ_HOLDING_REGISTERS;
+            return makeOperation(
+                [this, values, address, input_registers, start, length, function](
+                    Result& result, std::coroutine_handle<> handle
+                ) {
+                    submitBlocks(
+                        result, handle, address, function, length,
+                        common::READ_REGISTERS_MAX_COUNT,
+                        [address, input_registers, start](int offset, int size) {
+                            uint8_t frame[TCP::FRAME_MAX_SIZE];
+                            uint8_t const* end = TCP::formatReadRegisters(
+                                frame, 0, address, input_registers, start + offset, size
+                            );
+                            return payloadOf(frame, end);
+                        },
+                        [values](int offset, int size, FrameView const& reply) {
+                            return common::tryParseReadRegisters(
+                                values + offset, reply, size
+                            );
+                        }
+                    );
+                }
+            );
+        }
+
+        /** Read coils or digital inputs into packed bits
+         *
+         * @see MasterInterface::readDigitalInputs
+         */
+        auto readDigitalInputs(uint8_t* bits, int address, bool coils,
+                               uint16_t register_id, uint16_t count) {
+            validateRange("AsyncMaster::readDigitalInputs: invalid input range",
+                          register_id, count);
+            int function = coils ? FUNCTION_READ_COILS : FUNCTION_READ_DIGITAL_INPUTS;
+            // The block size is a multiple of 8, so the blocks start on a
+            // byte boundary in the packed bits
+            return makeOperation(
+                [this, bits, address, coils, register_id, count, function](
+                    Result& result, std::coroutine_handle<> handle
+                ) {
+                    submitBlocks(
+                        result, handle, address, function, count,
+                        common::READ_DIGITAL_INPUTS_MAX_COUNT,
+                        [address, coils, register_id](int offset, int size) {
+                            uint8_t frame[TCP::FRAME_MAX_SIZE];
+                            uint8_t const* end = TCP::formatReadDigitalInputs(
+                                frame, 0, address, coils, register_id + offset, size
+                            );
+                            return payloadOf(frame, end);
+                        },
+                        [bits](int offset, int size, FrameView const& reply) {
+                            return common::tryParseReadDigitalInputs(
+                                bits + offset / 8, reply, size
+                            );
+                        }
+                    );
+                }
+            );
+        }
+
+        /** Write a single register
+         *
+         * @see MasterInterface::writeSingleRegister
+         */
+        auto writeSingleRegister(int address, uint16_t register_id, uint16_t value) {
+            return makeSingleOperation(
+                address, FUNCTION_WRITE_SINGLE_REGISTER,
+                [address, register_id, value]() {
+                    uint8_t frame[TCP::FRAME_MAX_SIZE];
+                    uint8_t const* end = TCP::formatWriteRegister(
+                        frame, 0, address, register_id, value
+                    );
+                    return payloadOf(frame, end);
+                },
+                [](FrameView const&) { return Result(); }
+            );
+        }
+
+        /** Write a single coil
+         *
+         * @see MasterInterface::writeSingleCoil
+         */
+        auto writeSingleCoil(int address, uint16_t register_id, bool value) {
+            return makeSingleOperation(
+                address, FUNCTION_WRITE_SINGLE_COIL,
+                [address, register_id, value]() {
+                    uint8_t frame[TCP::FRAME_MAX_SIZE];
+                    uint8_t const* end = TCP::formatWriteSingleCoil(
+                        frame, 0, address, register_id, value
+                    );
+                    return payloadOf(frame, end);
+                },
+                [](FrameView const&) { return Result(); }
+            );
+        }
+
+        /** Write multiple registers
+         *
+         * @see MasterInterface::writeRegisters
+         */
+        auto writeRegisters(int address, uint16_t start,
+                            uint16_t const* values, size_t count) {
+            if (count > 65536u) {
+                throw std::invalid_argument(
+                    "AsyncMaster::writeRegisters: invalid register range"
+                );
+            }
+            validateRange("AsyncMaster::writeRegisters: invalid register range",
+                          start, static_cast<int>(count));
+            return makeOperation(
+                [this, address, start, values, count](
+                    Result& result, std::coroutine_handle<> handle
+                ) {
+                    submitBlocks(
+                        result, handle, address, FUNCTION_WRITE_MULTIPLE_REGISTERS,
+                        static_cast<int>(count), common::WRITE_REGISTERS_MAX_COUNT,
+                        [address, start, values](int offset, int size) {
+                            uint8_t frame[TCP::FRAME_MAX_SIZE];
+                            uint8_t const* end = TCP::formatWriteRegisters(
+                                frame, 0, address, start + offset, values + offset, size
+                            );
+                            return payloadOf(frame, end);
+                        },
+                        [start](int offset, int size, FrameView const& reply) {
+                            return common::checkWriteMultipleReply(
+                                reply, start + offset, size
+                            );
+                        }
+                    );
+                }
+            );
+        }
+
+        /** Write multiple coils from packed bits
+         *
+         * @see MasterInterface::writeCoils
+         */
+        auto writeCoils(int address, uint16_t start, uint8_t const* bits, size_t count) {
+            if (count > 65536u) {
+                throw std::invalid_argument(
+                    "AsyncMaster::writeCoils: invalid coil range"
+                );
+            }
+            validateRange("AsyncMaster::writeCoils: invalid coil range",
+                          start, static_cast<int>(count));
+            // WRITE_COILS_MAX_COUNT is a multiple of 8, so the blocks start
+            // on a byte boundary in the packed bits
+            return makeOperation(
+                [this, address, start, bits, count](
+                    Result& result, std::coroutine_handle<> handle
+                ) {
+                    submitBlocks(
+                        result, handle, address, FUNCTION_WRITE_MULTIPLE_COILS,
+                        static_cast<int>(count), common::WRITE_COILS_MAX_COUNT,
+                        [address, start, bits](int offset, int size) {
+                            uint8_t frame[TCP::FRAME_MAX_SIZE];
+                            uint8_t const* end = TCP::formatWriteCoils(
+                                frame, 0, address, start + offset, bits + offset / 8, size
+                            );
+                            return payloadOf(frame, end);
+                        },
+                        [start](int offset, int size, FrameView const& reply) {
+                            return common::checkWriteMultipleReply(
+                                reply, start + offset, size
+                            );
+                        }
+                    );
+                }
+            );
+        }
+
+        /** Write and read registers in a single request
+         *
+         * @see MasterInterface::readWriteRegisters
+         */
+        auto readWriteRegisters(
+            uint16_t* read_values, int address, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        ) {
+            return makeSingleOperation(
+                address, FUNCTION_READ_WRITE_MULTIPLE_REGISTERS,
+                [address, read_start, read_count, write_start, write_values, write_count]() {
+                    uint8_t frame[TCP::FRAME_MAX_SIZE];
+                    uint8_t const* end = TCP::formatReadWriteRegisters(
+                        frame, 0, address, read_start, read_count,
+                        write_start, write_values, write_count
+                    );
+                    return payloadOf(frame, end);
+                },
+                [read_values, read_count](FrameView const& reply) {
+                    return common::tryParseReadRegisters(read_values, reply, read_count);
+                }
+            );
+        }
+
+        /** Modify a register with AND and OR masks
+         *
+         * @see MasterInterface::maskWriteRegister
+         */
+        auto maskWriteRegister(int address, uint16_t register_id,
+                               uint16_t and_mask, uint16_t or_mask) {
+            return makeSingleOperation(
+                address, FUNCTION_MASK_WRITE_REGISTER,
+                [address, register_id, and_mask, or_mask]() {
+                    uint8_t frame[TCP::FRAME_MAX_SIZE];
+                    uint8_t const* end = TCP::formatMaskWriteRegister(
+                        frame, 0, address, register_id, and_mask, or_mask
+                    );
+                    return payloadOf(frame, end);
+                },
+                [register_id, and_mask, or_mask](FrameView const& reply) {
+                    return common::checkMaskWriteReply(
+                        reply, register_id, and_mask, or_mask
+                    );
+                }
+            );
+        }
+    };
+}
+
+#endif
+
+#endif
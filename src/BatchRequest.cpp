@@ -0,0 +1,77 @@
+#include <modbus/BatchRequest.hpp>
+#include <modbus/Functions.hpp>
+
+using namespace modbus;
+
+BatchRequest BatchRequest::readRegisters(
+    uint16_t* values, int address, bool input_registers, uint16_t start, uint16_t count
+) {
+    BatchRequest request;
+    request.address = address;
+    request.function = input_registers ? FUNCTION_READ_INPUT_REGISTERS :
+                                         FUNCTION_READ_HOLDING_REGISTERS;
+    request.start = start;
+    request.count = count;
+    request.read_registers = values;
+    return request;
+}
+
+BatchRequest BatchRequest::readDigitalInputs(
+    uint8_t* bits, int address, bool coils, uint16_t start, uint16_t count
+) {
+    BatchRequest request;
+    request.address = address;
+    request.function = coils ? FUNCTION_READ_COILS : FUNCTION_READ_DIGITAL_INPUTS;
+    request.start = start;
+    request.count = count;
+    request.read_bits = bits;
+    return request;
+}
+
+BatchRequest BatchRequest::writeSingleRegister(
+    int address, uint16_t register_id, uint16_t value
+) {
+    BatchRequest request;
+    request.address = address;
+    request.function = FUNCTION_WRITE_SINGLE_REGISTER;
+    request.start = register_id;
+    request.count = 1;
+    request.value = value;
+    return request;
+}
+
+BatchRequest BatchRequest::writeSingleCoil(
+    int address, uint16_t register_id, bool value
+) {
+    BatchRequest request;
+    request.address = address;
+    request.function = FUNCTION_WRITE_SINGLE_COIL;
+    request.start = register_id;
+    request.count = 1;
+    request.value = value;
+    return request;
+}
+
+BatchRequest BatchRequest::writeRegisters(
+    int address, uint16_t start, uint16_t const* values, uint16_t count
+) {
+    BatchRequest request;
+    request.address = address;
+    request.function = FUNCTION_WRITE_MULTIPLE_REGISTERS;
+    request.start = start;
+    request.count = count;
+    request.write_registers = values;
+    return request;
+}
+
+BatchRequest BatchRequest::writeCoils(
+    int address, uint16_t start, uint8_t const* bits, uint16_t count
+) {
+    BatchRequest request;
+    request.address = address;
+    request.function = FUNCTION_WRITE_MULTIPLE_COILS;
+    request.start = start;
+    request.count = count;
+    request.write_bits = bits;
+    return request;
+}
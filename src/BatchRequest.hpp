@@ -0,0 +1,68 @@
+#ifndef MODBUS_BATCHREQUEST_HPP
+#define MODBUS_BATCHREQUEST_HPP
+
+#include <cstdint>
+#include <modbus/Result.hpp>
+
+namespace modbus {
+    /** One request of a batch run by MasterInterface::execute
+     *
+     * Create them with the static methods. The buffers are not owned by the
+     * request, and must stay valid until execute returns.
+     */
+    struct BatchRequest {
+        int address = 0;
+        int function = 0;
+        uint16_t start = 0;
+        uint16_t count = 0;
+
+        /** Destination of register reads */
+        uint16_t* read_registers = nullptr;
+        /** Source of multiple register writes */
+        uint16_t const* write_registers = nullptr;
+        /** Destination of coil and digital input reads, as packed bits */
+        uint8_t* read_bits = nullptr;
+        /** Source of multiple coil writes, as packed bits */
+        uint8_t const* write_bits = nullptr;
+        /** Value of single register and single coil writes */
+        uint16_t value = 0;
+
+        /** Outcome of the request, set by execute */
+        Result result;
+
+        static BatchRequest readRegisters(
+            uint16_t* values, int address, bool input_registers,
+            uint16_t start, uint16_t count
+        );
+
+        /** Read coils or digital inputs into packed bits
+         *
+         * @see MasterInterface::readDigitalInputs
+         */
+        static BatchRequest readDigitalInputs(
+            uint8_t* bits, int address, bool coils, uint16_t start, uint16_t count
+        );
+
+        static BatchRequest writeSingleRegister(
+            int address, uint16_t register_id, uint16_t value
+        );
+
+        static BatchRequest writeSingleCoil(
+            int address, uint16_t register_id, bool value
+        );
+
+        static BatchRequest writeRegisters(
+            int address, uint16_t start, uint16_t const* values, uint16_t count
+        );
+
+        /** Write coils given as packed bits
+         *
+         * @see MasterInterface::writeCoils
+         */
+        static BatchRequest writeCoils(
+            int address, uint16_t start, uint8_t const* bits, uint16_t count
+        );
+    };
+}
+
+#endif
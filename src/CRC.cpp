@@ -0,0 +1,265 @@
+#include <modbus/RTU.hpp>
+
+#if defined(__x86_64__)
+#define MODBUS_HAS_CLMUL_KERNEL
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace modbus;
+
+namespace {
+    /** Reflected form of the Modbus CRC polynomial x^16 + x^15 + x^2 + 1 */
+    static const uint16_t CRC_POLYNOMIAL = 0xA001;
+
+    constexpr uint16_t crcShift(uint16_t crc, int bits) {
+        return bits == 0 ? crc :
+               crcShift((crc & 1) ? ((crc >> 1) ^ CRC_POLYNOMIAL) : (crc >> 1),
+                        bits - 1);
+    }
+
+    /** Feeds a zero byte to a CRC register */
+    constexpr uint16_t crcZeroByte(uint16_t crc) {
+        return (crc >> 8) ^ crcShift(crc & 0xFF, 8);
+    }
+
+    /** Entry of the n-th slicing table, i.e. the CRC of a byte followed
+     * by n zero bytes
+     */
+    constexpr uint16_t crcTableEntry(int slice, uint16_t byte) {
+        return slice == 0 ? crcShift(byte, 8) :
+                            crcZeroByte(crcTableEntry(slice - 1, byte));
+    }
+
+    template<int... Is> struct Indices {};
+    template<int N, int... Is>
+    struct MakeIndices : MakeIndices<N - 1, N - 1, Is...> {};
+    template<int... Is>
+    struct MakeIndices<0, Is...> {
+        typedef Indices<Is...> type;
+    };
+
+    struct CRCTables {
+        uint16_t slices[8][256];
+    };
+
+    template<int... Is>
+    constexpr CRCTables makeCRCTables(Indices<Is...>) {
+        return CRCTables { {
+            { crcTableEntry(0, Is)... }, { crcTableEntry(1, Is)... },
+            { crcTableEntry(2, Is)... }, { crcTableEntry(3, Is)... },
+            { crcTableEntry(4, Is)... }, { crcTableEntry(5, Is)... },
+            { crcTableEntry(6, Is)... }, { crcTableEntry(7, Is)... }
+        } };
+    }
+
+    /** Slicing tables, generated at compile time
+     *
+     * The first table is the classic byte-wise CRC table
+     */
+    static constexpr CRCTables CRC_TABLES = makeCRCTables(MakeIndices<256>::type());
+}
+
+uint16_t RTU::updateCRCBitwise(uint16_t crc, uint8_t const* start, uint8_t const* end) {
+    for (uint8_t const* it = start; it != end; ++it) {
+        crc ^= (uint16_t)*it;
+
+        for (int i = 8; i != 0; i--) {
+            if ((crc & 0x0001) != 0) {
+                crc >>= 1;
+                crc ^= CRC_POLYNOMIAL;
+            }
+            else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+uint16_t RTU::updateCRCTable(uint16_t crc, uint8_t const* start, uint8_t const* end) {
+    auto const& table = CRC_TABLES.slices[0];
+    for (uint8_t const* it = start; it != end; ++it) {
+        crc = (crc >> 8) ^ table[(crc ^ *it) & 0xFF];
+    }
+    return crc;
+}
+
+uint16_t RTU::updateCRCSlicingBy8(uint16_t crc, uint8_t const* start,
+                                  uint8_t const* end) {
+    auto const& t = CRC_TABLES.slices;
+    uint8_t const* it = start;
+    for (; end - it >= 8; it += 8) {
+        crc ^= static_cast<uint16_t>(it[0]) | static_cast<uint16_t>(it[1]) << 8;
+        crc = t[7][crc & 0xFF] ^ t[6][crc >> 8] ^
+              t[5][it[2]] ^ t[4][it[3]] ^ t[3][it[4]] ^
+              t[2][it[5]] ^ t[1][it[6]] ^ t[0][it[7]];
+    }
+    return updateCRCTable(crc, it, end);
+}
+
+#ifdef MODBUS_HAS_CLMUL_KERNEL
+namespace {
+    /** Computes x^n modulo the (non-reflected) Modbus CRC polynomial */
+    uint16_t crcPowerOfX(int n) {
+        uint32_t value = 1;
+        for (int i = 0; i < n; ++i) {
+            value <<= 1;
+            if (value & 0x10000) {
+                value ^= 0x18005;
+            }
+        }
+        return value;
+    }
+
+    /** Bit-reflects a polynomial of degree < 16 in a 64 bit word */
+    uint64_t crcReflect64(uint16_t value) {
+        uint64_t result = 0;
+        for (int i = 0; i < 16; ++i) {
+            if (value & (1 << i)) {
+                result |= 1ull << (63 - i);
+            }
+        }
+        return result;
+    }
+
+    /** Folding constants to move a 128 bit block by the given amount of bits
+     *
+     * Loaded little-endian, a block of reflected CRC input holds its
+     * highest-degree half in the low qword. The exponents are reduced by
+     * one to account for the bit that PCLMULQDQ loses when multiplying
+     * reflected operands.
+     */
+    __m128i crcFoldConstants(int distance) {
+        return _mm_set_epi64x(crcReflect64(crcPowerOfX(distance - 1)),
+                              crcReflect64(crcPowerOfX(distance + 64 - 1)));
+    }
+
+    struct CRCFoldConstants {
+        __m128i by1 = crcFoldConstants(128);
+        __m128i by4 = crcFoldConstants(512);
+    };
+
+    __attribute__((target("pclmul,sse2")))
+    inline __m128i crcFold(__m128i accumulator, __m128i constants, __m128i next) {
+        __m128i high = _mm_clmulepi64_si128(accumulator, constants, 0x00);
+        __m128i low = _mm_clmulepi64_si128(accumulator, constants, 0x11);
+        return _mm_xor_si128(_mm_xor_si128(high, low), next);
+    }
+
+    inline __m128i crcLoad(uint8_t const* it) {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const*>(it));
+    }
+
+    __attribute__((target("pclmul,sse2")))
+    uint16_t updateCRCCLMULKernel(uint16_t crc, uint8_t const* start,
+                                  uint8_t const* end) {
+        static const CRCFoldConstants constants;
+
+        // Fold the CRC register into the first two bytes of the input, so that
+        // the folding loop computes a CRC with a zero initial value
+        uint8_t const* it = start;
+        __m128i a0 = _mm_xor_si128(crcLoad(it), _mm_cvtsi32_si128(crc));
+        it += 16;
+
+        if (end - it >= 48) {
+            __m128i a1 = crcLoad(it);
+            __m128i a2 = crcLoad(it + 16);
+            __m128i a3 = crcLoad(it + 32);
+            it += 48;
+            for (; end - it >= 64; it += 64) {
+                a0 = crcFold(a0, constants.by4, crcLoad(it));
+                a1 = crcFold(a1, constants.by4, crcLoad(it + 16));
+                a2 = crcFold(a2, constants.by4, crcLoad(it + 32));
+                a3 = crcFold(a3, constants.by4, crcLoad(it + 48));
+            }
+            a0 = crcFold(a0, constants.by1, a1);
+            a0 = crcFold(a0, constants.by1, a2);
+            a0 = crcFold(a0, constants.by1, a3);
+        }
+        for (; end - it >= 16; it += 16) {
+            a0 = crcFold(a0, constants.by1, crcLoad(it));
+        }
+
+        // The folded block has the same CRC than the folded bytes
+        uint8_t folded[16];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(folded), a0);
+        crc = RTU::updateCRCTable(0, folded, folded + 16);
+        return RTU::updateCRCTable(crc, it, end);
+    }
+
+    bool detectCLMUL() {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ecx & bit_PCLMUL) && (edx & bit_SSE2);
+    }
+}
+
+bool RTU::hasCRCCarrylessMultiply() {
+    static const bool available = detectCLMUL();
+    return available;
+}
+
+uint16_t RTU::updateCRCCarrylessMultiply(uint16_t crc, uint8_t const* start,
+                                         uint8_t const* end) {
+    if (end - start < CRC_CLMUL_MIN_SIZE || !hasCRCCarrylessMultiply()) {
+        return updateCRCSlicingBy8(crc, start, end);
+    }
+    return updateCRCCLMULKernel(crc, start, end);
+}
+#else
+bool RTU::hasCRCCarrylessMultiply() {
+    return false;
+}
+
+uint16_t RTU::updateCRCCarrylessMultiply(uint16_t crc, uint8_t const* start,
+                                         uint8_t const* end) {
+    return updateCRCSlicingBy8(crc, start, end);
+}
+#endif
+
+uint16_t RTU::updateCRC(uint16_t crc, uint8_t const* start, uint8_t const* end) {
+    if (end - start >= CRC_CLMUL_MIN_SIZE && hasCRCCarrylessMultiply()) {
+        return updateCRCCarrylessMultiply(crc, start, end);
+    }
+    return updateCRCSlicingBy8(crc, start, end);
+}
+
+array<uint8_t, 2> RTU::crc(uint8_t const* start, uint8_t const* end) {
+    uint16_t crc = updateCRC(CRC_INITIAL_VALUE, start, end);
+
+    array<uint8_t, 2> result;
+    result[0] = crc & 0xFF;
+    result[1] = (crc >> 8) & 0xFF;
+    return result;
+}
+
+void RTU::CRCState::reset() {
+    m_crc = CRC_INITIAL_VALUE;
+}
+
+void RTU::CRCState::update(uint8_t byte) {
+    m_crc = (m_crc >> 8) ^ CRC_TABLES.slices[0][(m_crc ^ byte) & 0xFF];
+}
+
+void RTU::CRCState::update(uint8_t const* start, uint8_t const* end) {
+    m_crc = updateCRC(m_crc, start, end);
+}
+
+uint16_t RTU::CRCState::value() const {
+    return m_crc;
+}
+
+array<uint8_t, 2> RTU::CRCState::bytes() const {
+    array<uint8_t, 2> result;
+    result[0] = m_crc & 0xFF;
+    result[1] = (m_crc >> 8) & 0xFF;
+    return result;
+}
+
+bool RTU::CRCState::isValid() const {
+    return m_crc == 0;
+}
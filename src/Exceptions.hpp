@@ -5,6 +5,14 @@
 #include <stdexcept>
 
 namespace modbus {
+    /** Exception codes sent by slaves in exception replies */
+    enum ExceptionCodes {
+        EXCEPTION_ILLEGAL_FUNCTION = 0x01,
+        EXCEPTION_ILLEGAL_DATA_ADDRESS = 0x02,
+        EXCEPTION_ILLEGAL_DATA_VALUE = 0x03,
+        EXCEPTION_SLAVE_DEVICE_FAILURE = 0x04
+    };
+
     /** Exception thrown when a slave replies to a request with an exception
      */
     struct RequestException : public std::runtime_error {
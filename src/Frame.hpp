@@ -1,8 +1,12 @@
 #ifndef MODBUS_FRAME_HPP
 #define MODBUS_FRAME_HPP
 
+#include <array>
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
 
 namespace modbus {
     /**
@@ -13,6 +17,87 @@ namespace modbus {
         uint8_t function;
         std::vector<uint8_t> payload;
     };
+
+    template<size_t N> struct StaticFrame;
+
+    /**
+     * A non-owning view on a modbus frame
+     *
+     * The payload points directly into the buffer the frame has been parsed
+     * from. It is valid only as long as this buffer is left untouched, e.g.
+     * until the next read when the view points into a driver's internal
+     * buffer.
+     */
+    struct FrameView {
+        uint8_t address = 0;
+        uint8_t function = 0;
+        uint8_t const* payload = nullptr;
+        size_t payload_size = 0;
+
+        FrameView() {}
+
+        /** Creates a view on a frame object */
+        explicit FrameView(Frame const& frame)
+            : address(frame.address)
+            , function(frame.function)
+            , payload(frame.payload.data())
+            , payload_size(frame.payload.size()) {
+        }
+
+        /** Creates a view on a static frame object */
+        template<size_t N>
+        explicit FrameView(StaticFrame<N> const& frame)
+            : address(frame.address)
+            , function(frame.function)
+            , payload(frame.payload.data())
+            , payload_size(frame.payload_size) {
+        }
+
+        /** Copy the viewed frame into a frame object */
+        void copyTo(Frame& frame) const {
+            frame.address = address;
+            frame.function = function;
+            frame.payload.assign(payload, payload + payload_size);
+        }
+    };
+
+    /**
+     * A modbus frame whose payload is stored inline, with a fixed capacity
+     *
+     * Unlike Frame, it does not use the heap. It can be copied around (e.g.
+     * stored in ring buffers or passed between threads) without ever
+     * touching the allocator.
+     *
+     * @tparam N the payload capacity in bytes
+     */
+    template<size_t N>
+    struct StaticFrame {
+        static const size_t CAPACITY = N;
+
+        uint8_t address = 0;
+        uint8_t function = 0;
+        size_t payload_size = 0;
+        std::array<uint8_t, N> payload;
+
+        /** Copy a frame view into this frame
+         *
+         * @throw std::length_error if the view's payload is bigger than the
+         *   frame capacity
+         */
+        void assign(FrameView const& view) {
+            if (view.payload_size > N) {
+                throw std::length_error(
+                    "StaticFrame::assign: payload bigger than the frame capacity"
+                );
+            }
+            address = view.address;
+            function = view.function;
+            payload_size = view.payload_size;
+            if (payload_size) {
+                std::memcpy(payload.data(), view.payload, payload_size);
+            }
+        }
+    };
 }
 
-#endif
\ No newline at end of file
+#endif
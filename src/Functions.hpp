@@ -8,7 +8,11 @@ namespace modbus {
         FUNCTION_READ_HOLDING_REGISTERS = 0x03,
         FUNCTION_READ_INPUT_REGISTERS = 0x04,
         FUNCTION_WRITE_SINGLE_COIL = 0x05,
-        FUNCTION_WRITE_SINGLE_REGISTER = 0x06
+        FUNCTION_WRITE_SINGLE_REGISTER = 0x06,
+        FUNCTION_WRITE_MULTIPLE_COILS = 0x0F,
+        FUNCTION_WRITE_MULTIPLE_REGISTERS = 0x10,
+        FUNCTION_MASK_WRITE_REGISTER = 0x16,
+        FUNCTION_READ_WRITE_MULTIPLE_REGISTERS = 0x17
     };
 }
 
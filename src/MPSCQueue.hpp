@@ -0,0 +1,93 @@
+#ifndef MODBUS_MPSCQUEUE_HPP
+#define MODBUS_MPSCQUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+namespace modbus {
+    /** Unbounded lock-free multiple-producer single-consumer queue
+     *
+     * This is an intrusive linked list in which producers append with a single
+     * atomic exchange, and the consumer follows the next pointers (Dmitry
+     * Vyukov's MPSC queue). Pushing never blocks nor fails.
+     *
+     * The consumer may briefly see the queue as empty while a producer is
+     * between its exchange and the link to the previous node. This is
+     * harmless for a consumer that polls the queue again later.
+     *
+     * T must be default-constructible and movable
+     */
+    template<typename T>
+    class MPSCQueue {
+        struct Node {
+            std::atomic<Node*> next;
+            T value;
+
+            Node()
+                : next(nullptr) {
+            }
+            explicit Node(T&& value)
+                : next(nullptr)
+                , value(std::move(value)) {
+            }
+        };
+
+        /** Last pushed node, shared between producers */
+        std::atomic<Node*> m_head;
+
+        /** Node before the next node to pop. Only used by the consumer */
+        Node* m_tail;
+
+    public:
+        MPSCQueue() {
+            Node* stub = new Node();
+            m_head.store(stub);
+            m_tail = stub;
+        }
+
+        ~MPSCQueue() {
+            while (m_tail) {
+                Node* next = m_tail->next.load();
+                delete m_tail;
+                m_tail = next;
+            }
+        }
+
+        MPSCQueue(MPSCQueue const&) = delete;
+        MPSCQueue& operator=(MPSCQueue const&) = delete;
+
+        /** Append a value to the queue. This may be called from any thread */
+        void push(T value) {
+            Node* node = new Node(std::move(value));
+            Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+            previous->next.store(node, std::memory_order_release);
+        }
+
+        /** Remove the first value of the queue
+         *
+         * This must only be called from the consumer thread
+         *
+         * @return false if the queue is empty
+         */
+        bool pop(T& value) {
+            Node* next = m_tail->next.load(std::memory_order_acquire);
+            if (!next) {
+                return false;
+            }
+            value = std::move(next->value);
+            delete m_tail;
+            m_tail = next;
+            return true;
+        }
+
+        /** Whether there is nothing to pop
+         *
+         * This must only be called from the consumer thread
+         */
+        bool empty() const {
+            return !m_tail->next.load(std::memory_order_acquire);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,324 @@
+#include <modbus/MasterInterface.hpp>
+#include <algorithm>
+#include <modbus/common.hpp>
+#include <modbus/Exceptions.hpp>
+#include <modbus/Functions.hpp>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+MasterInterface::MasterInterface() {
+    fill(m_max_register_read_block, m_max_register_read_block + 256,
+         common::READ_REGISTERS_MAX_COUNT);
+    fill(m_max_bit_read_block, m_max_bit_read_block + 256,
+         common::READ_DIGITAL_INPUTS_MAX_COUNT);
+}
+
+void MasterInterface::setMaxReadBlockSize(int address, int registers, int bits) {
+    if (registers < 1 || registers > common::READ_REGISTERS_MAX_COUNT) {
+        throw std::invalid_argument(
+            "MasterInterface::setMaxReadBlockSize: invalid register block size"
+        );
+    }
+    else if (bits < 8 || bits > common::READ_DIGITAL_INPUTS_MAX_COUNT || bits % 8) {
+        throw std::invalid_argument(
+            "MasterInterface::setMaxReadBlockSize: invalid bit block size, "
+            "it must be a multiple of 8 between 8 and 2000"
+        );
+    }
+
+    m_max_register_read_block[address & 0xff] = registers;
+    m_max_bit_read_block[address & 0xff] = bits;
+}
+
+int MasterInterface::getMaxRegisterReadBlockSize(int address) const {
+    return m_max_register_read_block[address & 0xff];
+}
+
+int MasterInterface::getMaxBitReadBlockSize(int address) const {
+    return m_max_bit_read_block[address & 0xff];
+}
+
+bool MasterInterface::isMaskWriteSupported(int address) const {
+    return !m_mask_write_unsupported[address & 0xff];
+}
+
+Result MasterInterface::tryWriteRegisterBits(
+    int address, uint16_t register_id, uint16_t mask, uint16_t value
+) {
+    if (isMaskWriteSupported(address)) {
+        Result result = tryMaskWriteRegister(
+            address, register_id, static_cast<uint16_t>(~mask), value & mask
+        );
+        if (result.code != RESULT_REQUEST_EXCEPTION ||
+            result.exception_code != EXCEPTION_ILLEGAL_FUNCTION) {
+            return result;
+        }
+        m_mask_write_unsupported[address & 0xff] = true;
+    }
+
+    uint16_t current;
+    Result result = tryReadRegisters(&current, address, false, register_id, 1);
+    if (!result.ok()) {
+        return result;
+    }
+    return tryWriteSingleRegister(
+        address, register_id, (current & ~mask) | (value & mask)
+    );
+}
+
+Result MasterInterface::tryReadRegisters(
+    uint16_t* values, int address, bool input_registers, int start, int length) {
+    if (length < 1) {
+        throw std::invalid_argument(
+            "MasterInterface::readRegisters: invalid number of registers requested"
+        );
+    }
+    else if (65536 - start < length) {
+        throw std::invalid_argument(
+            "MasterInterface::readRegisters: attempting to read beyond register 65536"
+        );
+    }
+
+    int block_size = getMaxRegisterReadBlockSize(address);
+    for (int offset = 0; offset < length; offset += block_size) {
+        Result result = tryReadRegistersBlock(
+            values + offset, address, input_registers, start + offset,
+            min(length - offset, block_size)
+        );
+        if (!result.ok()) {
+            return result;
+        }
+    }
+    return Result();
+}
+
+Result MasterInterface::tryReadDigitalInputs(uint8_t* bits, int address, bool coils,
+                                             uint16_t register_id, uint16_t count) {
+    if (count == 0) {
+        throw std::invalid_argument(
+            "MasterInterface::readDigitalInputs: invalid number of inputs requested"
+        );
+    }
+    else if (65536 - register_id < count) {
+        throw std::invalid_argument(
+            "MasterInterface::readDigitalInputs: attempting to read beyond input 65536"
+        );
+    }
+
+    // The block size is a multiple of 8, so the blocks start on a byte
+    // boundary in the packed bits
+    int block_size = getMaxBitReadBlockSize(address);
+    for (int offset = 0; offset < count; offset += block_size) {
+        Result result = tryReadDigitalInputsBlock(
+            bits + offset / 8, address, coils, register_id + offset,
+            min(count - offset, block_size)
+        );
+        if (!result.ok()) {
+            return result;
+        }
+    }
+    return Result();
+}
+
+Result MasterInterface::tryWriteRegisters(int address, uint16_t start,
+                                          uint16_t const* values, size_t count) {
+    if (count == 0) {
+        throw std::invalid_argument(
+            "MasterInterface::writeRegisters: invalid number of registers to write"
+        );
+    }
+    else if (count > 65536u - start) {
+        throw std::invalid_argument(
+            "MasterInterface::writeRegisters: attempting to write beyond register 65536"
+        );
+    }
+
+    for (size_t offset = 0; offset < count; offset += common::WRITE_REGISTERS_MAX_COUNT) {
+        int block_size = min<size_t>(count - offset, common::WRITE_REGISTERS_MAX_COUNT);
+        Result result = tryWriteRegistersBlock(
+            address, start + offset, values + offset, block_size
+        );
+        if (!result.ok()) {
+            return result;
+        }
+    }
+    return Result();
+}
+
+Result MasterInterface::tryWriteCoils(int address, uint16_t start,
+                                      uint8_t const* bits, size_t count) {
+    if (count == 0) {
+        throw std::invalid_argument(
+            "MasterInterface::writeCoils: invalid number of coils to write"
+        );
+    }
+    else if (count > 65536u - start) {
+        throw std::invalid_argument(
+            "MasterInterface::writeCoils: attempting to write beyond coil 65536"
+        );
+    }
+
+    // WRITE_COILS_MAX_COUNT is a multiple of 8, so the blocks start on a
+    // byte boundary in the packed bits
+    for (size_t offset = 0; offset < count; offset += common::WRITE_COILS_MAX_COUNT) {
+        int block_size = min<size_t>(count - offset, common::WRITE_COILS_MAX_COUNT);
+        Result result = tryWriteCoilsBlock(
+            address, start + offset, bits + offset / 8, block_size
+        );
+        if (!result.ok()) {
+            return result;
+        }
+    }
+    return Result();
+}
+
+void MasterInterface::validate(BatchRequest const& request) {
+    void const* buffer = nullptr;
+    switch (request.function) {
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS:
+            buffer = request.read_registers;
+            break;
+        case FUNCTION_READ_COILS:
+        case FUNCTION_READ_DIGITAL_INPUTS:
+            buffer = request.read_bits;
+            break;
+        case FUNCTION_WRITE_SINGLE_REGISTER:
+        case FUNCTION_WRITE_SINGLE_COIL:
+            if (request.count != 1) {
+                throw std::invalid_argument(
+                    "MasterInterface::execute: single writes must have a count of 1"
+                );
+            }
+            return;
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS:
+            buffer = request.write_registers;
+            break;
+        case FUNCTION_WRITE_MULTIPLE_COILS:
+            buffer = request.write_bits;
+            break;
+        default:
+            throw std::invalid_argument(
+                "MasterInterface::execute: unsupported function in batch"
+            );
+    }
+
+    if (request.count < 1) {
+        throw std::invalid_argument(
+            "MasterInterface::execute: invalid number of registers requested"
+        );
+    }
+    else if (65536 - request.start < request.count) {
+        throw std::invalid_argument(
+            "MasterInterface::execute: attempting to access beyond register 65536"
+        );
+    }
+    else if (!buffer) {
+        throw std::invalid_argument("MasterInterface::execute: null buffer in batch");
+    }
+}
+
+bool MasterInterface::fitsInOneRequest(BatchRequest const& request) const {
+    switch (request.function) {
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS:
+            return request.count <= getMaxRegisterReadBlockSize(request.address);
+        case FUNCTION_READ_COILS:
+        case FUNCTION_READ_DIGITAL_INPUTS:
+            return request.count <= getMaxBitReadBlockSize(request.address);
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS:
+            return request.count <= common::WRITE_REGISTERS_MAX_COUNT;
+        case FUNCTION_WRITE_MULTIPLE_COILS:
+            return request.count <= common::WRITE_COILS_MAX_COUNT;
+        default:
+            return true;
+    }
+}
+
+Result MasterInterface::executeAlone(BatchRequest& request) {
+    switch (request.function) {
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS:
+            return tryReadRegisters(
+                request.read_registers, request.address,
+                request.function == FUNCTION_READ_INPUT_REGISTERS,
+                request.start, request.count
+            );
+        case FUNCTION_READ_COILS:
+        case FUNCTION_READ_DIGITAL_INPUTS:
+            return tryReadDigitalInputs(
+                request.read_bits, request.address,
+                request.function == FUNCTION_READ_COILS,
+                request.start, request.count
+            );
+        case FUNCTION_WRITE_SINGLE_REGISTER:
+            return tryWriteSingleRegister(request.address, request.start, request.value);
+        case FUNCTION_WRITE_SINGLE_COIL:
+            return tryWriteSingleCoil(request.address, request.start, request.value);
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS:
+            return tryWriteRegisters(
+                request.address, request.start, request.write_registers, request.count
+            );
+        case FUNCTION_WRITE_MULTIPLE_COILS:
+            return tryWriteCoils(
+                request.address, request.start, request.write_bits, request.count
+            );
+        default:
+            return Result();
+    }
+}
+
+size_t MasterInterface::execute(BatchRequest* requests, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        validate(requests[i]);
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        requests[i].result = executeAlone(requests[i]);
+        if (!requests[i].result.ok()) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+void MasterInterface::setAdaptiveTimeouts(bool enable) {
+    m_adaptive_timeouts = enable;
+}
+
+bool MasterInterface::getAdaptiveTimeouts() const {
+    return m_adaptive_timeouts;
+}
+
+TimeoutEstimator& MasterInterface::getTimeoutEstimator() {
+    return m_timeout_estimator;
+}
+
+TimeoutEstimator const& MasterInterface::getTimeoutEstimator() const {
+    return m_timeout_estimator;
+}
+
+Time MasterInterface::getReplyTimeout(int address, int function,
+                                      Time const& read_timeout) const {
+    if (!m_adaptive_timeouts) {
+        return read_timeout;
+    }
+    return min(m_timeout_estimator.getTimeout(address, function), read_timeout);
+}
+
+void MasterInterface::updateReplyTimeout(int address, int function,
+                                         Result const& result,
+                                         Time const& turnaround) {
+    if (!m_adaptive_timeouts) {
+        return;
+    }
+    else if (result.code == RESULT_TIMEOUT) {
+        m_timeout_estimator.addTimeout(address, function);
+    }
+    else {
+        m_timeout_estimator.addTurnaround(address, function, turnaround);
+    }
+}
@@ -1,15 +1,220 @@
 #ifndef MODBUS_MASTERINTERFACE_HPP
 #define MODBUS_MASTERINTERFACE_HPP
 
+#include <bitset>
+#include <modbus/BatchRequest.hpp>
 #include <modbus/Frame.hpp>
+#include <modbus/Result.hpp>
+#include <modbus/TimeoutEstimator.hpp>
 
 namespace modbus {
     /** Common interface between the RTU and TCP implementations
      */
     class MasterInterface {
+        /** Slaves that replied to a mask write request with an illegal
+         * function exception
+         *
+         * writeRegisterBits uses read-modify-write for these
+         */
+        std::bitset<256> m_mask_write_unsupported;
+
+        /** Maximum number of registers per read request, per slave */
+        uint8_t m_max_register_read_block[256];
+
+        /** Maximum number of coils or digital inputs per read request, per
+         * slave
+         */
+        uint16_t m_max_bit_read_block[256];
+
+        /** @see setAdaptiveTimeouts */
+        bool m_adaptive_timeouts = false;
+
+        /** Turnaround statistics used by the adaptive timeouts */
+        TimeoutEstimator m_timeout_estimator;
+
+    protected:
+        /** The time allowed for the reply to a request
+         *
+         * RTUMaster uses it as the first byte timeout, as the end of an RTU
+         * frame is detected by the interframe silence. TCPMaster uses it as
+         * the timeout of the whole reply packet.
+         *
+         * @param read_timeout the timeout used when adaptive timeouts are
+         *   disabled, and the upper bound of the adaptive timeout
+         */
+        base::Time getReplyTimeout(int address, int function,
+                                   base::Time const& read_timeout) const;
+
+        /** Feed the outcome of a transaction to the adaptive timeouts
+         *
+         * The turnaround must cover what the timeout returned by
+         * getReplyTimeout is applied to. RTUMaster measures from the end
+         * of the request to the first byte of the reply, so that the
+         * transmission time of long replies does not inflate the first
+         * byte timeout. TCPMaster measures from the end of the request to
+         * the end of the reply packet, as its timeout covers the whole
+         * packet.
+         *
+         * @param turnaround the time between the end of the request and
+         *   the first byte (RTU) or the end (TCP) of the reply
+         */
+        void updateReplyTimeout(int address, int function, Result const& result,
+                                base::Time const& turnaround);
+
+        /** Check that a batch request can be sent
+         *
+         * This applies the checks of the formatters, so that a batch is
+         * rejected before any of its requests is sent: a supported function,
+         * a non-empty range within the 65536 registers, a count of 1 for
+         * single writes and a buffer for the other functions. Requests
+         * above the per-function maximums are valid, as they are split
+         * (see fitsInOneRequest)
+         *
+         * @throw std::invalid_argument
+         */
+        static void validate(BatchRequest const& request);
+
+        /** Whether a batch request fits in a single Modbus request to its
+         * slave, given the slave's read block sizes
+         */
+        bool fitsInOneRequest(BatchRequest const& request) const;
+
+        /** Run a batch request through the non-throwing API */
+        Result executeAlone(BatchRequest& request);
+
+        /** Read a set of registers in a single request
+         *
+         * tryReadRegisters calls it with at most the slave's register read
+         * block size
+         */
+        virtual Result tryReadRegistersBlock(
+            uint16_t* values,
+            int address, bool input_registers, int start, int length
+        ) = 0;
+
+        /** Read a set of coils or digital inputs in a single request
+         *
+         * tryReadDigitalInputs calls it with at most the slave's bit read
+         * block size
+         */
+        virtual Result tryReadDigitalInputsBlock(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, int count
+        ) = 0;
+
+        /** Write a set of registers in a single request */
+        virtual Result tryWriteRegistersBlock(
+            int address, uint16_t start, uint16_t const* values, int count
+        ) = 0;
+
+        /** Write a set of coils in a single request */
+        virtual Result tryWriteCoilsBlock(
+            int address, uint16_t start, uint8_t const* bits, int count
+        ) = 0;
+
     public:
+        MasterInterface();
         virtual ~MasterInterface() {}
 
+        /** @name Non-throwing API
+         *
+         * These methods report protocol errors and timeouts through their
+         * return value instead of throwing. They do not allocate on errors.
+         * Each of the throwing methods below is a wrapper around its
+         * non-throwing version.
+         *
+         * @{
+         */
+
+        /** Non-throwing version of readFrame(FrameView&) */
+        virtual Result tryReadFrame(FrameView& frame) = 0;
+
+        /** Non-throwing version of readReply(FrameView&, int) */
+        virtual Result tryReadReply(FrameView& frame, int function) = 0;
+
+        /** Non-throwing version of readRegisters
+         *
+         * Reads longer than getMaxRegisterReadBlockSize are split into
+         * multiple requests
+         *
+         * @throw std::invalid_argument if the range is empty or extends
+         *   beyond register 65536
+         */
+        virtual Result tryReadRegisters(
+            uint16_t* values,
+            int address, bool input_registers, int start, int length
+        );
+
+        /** Non-throwing version of writeSingleRegister */
+        virtual Result tryWriteSingleRegister(
+            int address, uint16_t register_id, uint16_t value
+        ) = 0;
+
+        /** Non-throwing version of writeSingleCoil */
+        virtual Result tryWriteSingleCoil(
+            int address, uint16_t register_id, bool value
+        ) = 0;
+
+        /** Non-throwing version of readDigitalInputs into packed bits
+         *
+         * Reads longer than getMaxBitReadBlockSize are split into multiple
+         * requests
+         *
+         * @throw std::invalid_argument if the range is empty or extends
+         *   beyond input 65536
+         */
+        virtual Result tryReadDigitalInputs(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, uint16_t count
+        );
+
+        /** Non-throwing version of writeRegisters
+         *
+         * @throw std::invalid_argument if the range is empty or extends
+         *   beyond register 65536
+         */
+        virtual Result tryWriteRegisters(
+            int address, uint16_t start, uint16_t const* values, size_t count
+        );
+
+        /** Non-throwing version of writeCoils with packed bits
+         *
+         * @throw std::invalid_argument if the range is empty or extends
+         *   beyond coil 65536
+         */
+        virtual Result tryWriteCoils(
+            int address, uint16_t start, uint8_t const* bits, size_t count
+        );
+
+        /** Non-throwing version of maskWriteRegister */
+        virtual Result tryMaskWriteRegister(
+            int address, uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        ) = 0;
+
+        /** Non-throwing version of writeRegisterBits */
+        Result tryWriteRegisterBits(
+            int address, uint16_t register_id, uint16_t mask, uint16_t value
+        );
+
+        /** Non-throwing version of readWriteRegisters */
+        virtual Result tryReadWriteRegisters(
+            uint16_t* read_values, int address, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        ) = 0;
+
+        /** Run a batch of heterogeneous requests
+         *
+         * The outcome of each request is stored in its result field, and a
+         * failed request does not stop the batch. The default implementation
+         * runs the requests one after the other through the methods above.
+         * The masters override it to cut the per-request overhead.
+         *
+         * @return the number of requests that failed
+         * @throw std::invalid_argument if a request has an unsupported
+         *   function or an invalid range
+         */
+        virtual size_t execute(BatchRequest* requests, size_t count);
+
+        /** @} */
+
         /** Wait for one frame on the bus and read it
          */
         virtual Frame readFrame() = 0;
@@ -18,24 +223,126 @@ namespace modbus {
          */
         virtual void readFrame(Frame& frame) = 0;
 
+        /** Wait for one frame on the bus and return a view on it
+         *
+         * The view points into the master's internal buffer, and is valid
+         * only until the next read
+         */
+        virtual void readFrame(FrameView& frame) = 0;
+
+        /** Wait for one frame on the bus and read it into a static frame
+         *
+         * @throw std::length_error if the frame payload does not fit
+         */
+        template<size_t N>
+        void readFrame(StaticFrame<N>& frame) {
+            FrameView view;
+            readFrame(view);
+            frame.assign(view);
+        }
+
         /** Wait for the reply for the given request
          */
         virtual Frame readReply(int function) = 0;
 
+        /** Wait for the reply for the given request and read it into a
+         * static frame
+         *
+         * @throw std::length_error if the frame payload does not fit
+         */
+        template<size_t N>
+        void readReply(StaticFrame<N>& frame, int function) {
+            FrameView view;
+            readReply(view, function);
+            frame.assign(view);
+        }
+
         /** Wait for the reply for the given request
          */
         virtual void readReply(Frame& frame, int function) = 0;
 
+        /** Wait for the reply for the given request and return a view on it
+         *
+         * The view points into the master's internal buffer, and is valid
+         * only until the next read
+         */
+        virtual void readReply(FrameView& frame, int function) = 0;
+
         /** Send a request and wait for the slave's reply */
         virtual Frame const& request(
             int address, int function, std::vector<uint8_t> const& payload
         ) = 0;
 
-        /** Read a set of registers */
+        /** Limit the size of the read requests sent to a slave
+         *
+         * readRegisters and readDigitalInputs split reads that are longer
+         * than these limits into multiple requests. The defaults are the
+         * protocol maximums, common::READ_REGISTERS_MAX_COUNT and
+         * common::READ_DIGITAL_INPUTS_MAX_COUNT
+         *
+         * @param registers the maximum number of registers per request
+         * @param bits the maximum number of coils or digital inputs per
+         *   request. It must be a multiple of 8, so that each request's
+         *   bits start on a byte boundary of the packed bit buffer
+         * @throw std::invalid_argument if one of the sizes is out of range
+         */
+        void setMaxReadBlockSize(int address, int registers, int bits);
+
+        /** Maximum number of registers per read request for this slave
+         *
+         * @see setMaxReadBlockSize
+         */
+        int getMaxRegisterReadBlockSize(int address) const;
+
+        /** Maximum number of coils or digital inputs per read request for
+         * this slave
+         *
+         * @see setMaxReadBlockSize
+         */
+        int getMaxBitReadBlockSize(int address) const;
+
+        /** Derive the reply timeout of each transaction from the turnarounds
+         * measured so far for its slave and function
+         *
+         * A lost frame then costs a few milliseconds over the slave's usual
+         * latency, instead of the whole read timeout. The read timeout stays
+         * the upper bound. Configure the estimation through
+         * getTimeoutEstimator. It is disabled by default.
+         *
+         * On RTU, the timeout and the measured turnaround end at the first
+         * byte of the reply. On TCP, they end with the whole reply packet.
+         *
+         * Only request-reply transactions are measured. Pipelined TCP
+         * requests keep the read timeout.
+         */
+        void setAdaptiveTimeouts(bool enable);
+
+        /** @see setAdaptiveTimeouts */
+        bool getAdaptiveTimeouts() const;
+
+        /** The turnaround statistics behind the adaptive timeouts */
+        TimeoutEstimator& getTimeoutEstimator();
+
+        /** @overload */
+        TimeoutEstimator const& getTimeoutEstimator() const;
+
+        /** Read a set of registers
+         *
+         * Reads longer than getMaxRegisterReadBlockSize are split into
+         * multiple requests
+         */
         virtual std::vector<uint16_t> readRegisters(
             int address, bool input_registers, int start, int length) = 0;
 
-        /** Read a set of registers */
+        /** Read a set of registers
+         *
+         * Reads longer than getMaxRegisterReadBlockSize are split into
+         * multiple requests. Each reply is decoded directly at its place
+         * in values.
+         *
+         * @throw std::invalid_argument if the read would go beyond register
+         *   65535
+         */
         virtual void readRegisters(
             uint16_t* values,
             int address, bool input_registers, int start, int length
@@ -51,9 +358,109 @@ namespace modbus {
 
         virtual void writeSingleCoil(int address, uint16_t register_id, bool value) = 0;
 
+        /** Write a set of contiguous registers
+         *
+         * Writes of more than common::WRITE_REGISTERS_MAX_COUNT registers are
+         * split into multiple requests. If one of them fails, the registers
+         * of the requests before it have already been written.
+         *
+         * @throw std::invalid_argument if the write would go beyond
+         *   register 65535
+         */
+        virtual void writeRegisters(
+            int address, uint16_t start, uint16_t const* values, size_t count
+        ) = 0;
+
+        /** Write a set of contiguous coils
+         *
+         * Writes of more than common::WRITE_COILS_MAX_COUNT coils are split
+         * into multiple requests. If one of them fails, the coils of the
+         * requests before it have already been written.
+         *
+         * @param bits the coil values as packed bits, the coil i being bit
+         *   i % 8 of byte i / 8
+         * @throw std::invalid_argument if the write would go beyond coil 65535
+         */
+        virtual void writeCoils(
+            int address, uint16_t start, uint8_t const* bits, size_t count
+        ) = 0;
+
+        /** Write a set of contiguous coils
+         *
+         * @see writeCoils(int, uint16_t, uint8_t const*, size_t)
+         */
+        virtual void writeCoils(
+            int address, uint16_t start, std::vector<bool> const& values
+        ) = 0;
+
+        /** Modify a holding register through an AND and an OR mask
+         *
+         * The slave sets the register to
+         * (current & and_mask) | (or_mask & ~and_mask)
+         */
+        virtual void maskWriteRegister(
+            int address, uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        ) = 0;
+
+        /** Change some bits of a holding register
+         *
+         * The bits set in mask are set to their value in value, the other
+         * bits are left unchanged.
+         *
+         * This uses a mask write request. Slaves that do not implement it
+         * (i.e. reply with an illegal function exception) are remembered,
+         * and a read-modify-write is used for them instead. Unlike the mask
+         * write, the read-modify-write is not atomic.
+         */
+        virtual void writeRegisterBits(
+            int address, uint16_t register_id, uint16_t mask, uint16_t value
+        ) = 0;
+
+        /** Whether writeRegisterBits uses mask write requests for this slave
+         *
+         * This is true until the slave replied to a mask write request with
+         * an illegal function exception
+         */
+        bool isMaskWriteSupported(int address) const;
+
+        /** Write a set of holding registers and read another in a single
+         * transaction
+         *
+         * The slave does the write before the read. Unlike writeRegisters,
+         * this is never split in multiple requests.
+         *
+         * @param read_values output buffer of at least read_count elements
+         * @throw std::invalid_argument if read_count is above
+         *   common::READ_WRITE_REGISTERS_MAX_READ_COUNT or write_count above
+         *   common::READ_WRITE_REGISTERS_MAX_WRITE_COUNT
+         */
+        virtual void readWriteRegisters(
+            uint16_t* read_values, int address, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        ) = 0;
+
+        /** Read coils or digital inputs
+         *
+         * Reads longer than getMaxBitReadBlockSize are split into multiple
+         * requests
+         */
         virtual std::vector<bool> readDigitalInputs(
             int address, bool coils, uint16_t register_id, uint16_t count
         ) = 0;
+
+        /** Read coils or digital inputs into a packed bit buffer
+         *
+         * The input i is stored in bit i % 8 of byte i / 8, which is how they
+         * are sent on the wire.
+         *
+         * Reads longer than getMaxBitReadBlockSize are split into multiple
+         * requests. Each reply is copied directly at its place in bits.
+         *
+         * @param bits output buffer of at least (count + 7) / 8 bytes
+         */
+        virtual void readDigitalInputs(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, uint16_t count
+        ) = 0;
     };
 }
 
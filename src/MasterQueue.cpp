@@ -0,0 +1,147 @@
+#include <modbus/MasterQueue.hpp>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+
+using namespace std;
+using namespace modbus;
+
+MasterQueue::MasterQueue(MasterInterface& master)
+    : m_master(master)
+    , m_sleeping(false)
+    , m_quit(false) {
+}
+
+MasterQueue::~MasterQueue() {
+    stop();
+}
+
+void MasterQueue::start() {
+    if (m_thread.joinable()) {
+        return;
+    }
+    m_quit = false;
+    m_thread = thread(&MasterQueue::process, this);
+}
+
+void MasterQueue::stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_signal.notify_one();
+    m_thread.join();
+}
+
+void MasterQueue::push(Request&& request) {
+    m_queue.push(move(request));
+    // Pairs with the fence in process(): either this thread sees the I/O
+    // thread sleeping, or the I/O thread sees the pushed request
+    atomic_thread_fence(memory_order_seq_cst);
+    if (m_sleeping.load()) {
+        lock_guard<mutex> lock(m_mutex);
+        m_signal.notify_one();
+    }
+}
+
+void MasterQueue::process() {
+    Request request;
+    while (true) {
+        while (m_queue.pop(request)) {
+            run(request);
+            request = Request();
+        }
+
+        unique_lock<mutex> lock(m_mutex);
+        m_sleeping = true;
+        atomic_thread_fence(memory_order_seq_cst);
+        m_signal.wait(lock, [this]() { return !m_queue.empty() || m_quit; });
+        m_sleeping = false;
+        if (m_quit && m_queue.empty()) {
+            return;
+        }
+    }
+}
+
+void MasterQueue::run(Request& request) {
+    Result result;
+    try {
+        result = request.operation(m_master);
+    }
+    catch(...) {
+        if (request.error_callback) {
+            request.error_callback(current_exception());
+        }
+        else if (request.callback) {
+            request.callback(
+                Result(RESULT_EXCEPTION, "MasterQueue: the operation threw an exception")
+            );
+        }
+        return;
+    }
+
+    if (request.callback) {
+        request.callback(result);
+    }
+}
+
+void MasterQueue::submit(Operation const& operation, Callback const& callback) {
+    Request request = { operation, callback, ErrorCallback() };
+    push(move(request));
+}
+
+future<Result> MasterQueue::submit(Operation const& operation) {
+    // std::function needs a copyable callable, hence the shared_ptr
+    auto promise = make_shared<std::promise<Result>>();
+    future<Result> result = promise->get_future();
+    Request request = {
+        operation,
+        [promise](Result const& result) { promise->set_value(result); },
+        [promise](exception_ptr error) { promise->set_exception(error); }
+    };
+    push(move(request));
+    return result;
+}
+
+future<Result> MasterQueue::readRegisters(
+    uint16_t* values, int address, bool input_registers, int start, int length
+) {
+    return submit([=](MasterInterface& master) {
+        return master.tryReadRegisters(values, address, input_registers, start, length);
+    });
+}
+
+future<Result> MasterQueue::readDigitalInputs(
+    uint8_t* bits, int address, bool coils, uint16_t register_id, uint16_t count
+) {
+    return submit([=](MasterInterface& master) {
+        return master.tryReadDigitalInputs(bits, address, coils, register_id, count);
+    });
+}
+
+future<Result> MasterQueue::writeSingleRegister(
+    int address, uint16_t register_id, uint16_t value
+) {
+    return submit([=](MasterInterface& master) {
+        return master.tryWriteSingleRegister(address, register_id, value);
+    });
+}
+
+future<Result> MasterQueue::writeSingleCoil(int address, uint16_t register_id,
+                                            bool value) {
+    return submit([=](MasterInterface& master) {
+        return master.tryWriteSingleCoil(address, register_id, value);
+    });
+}
+
+future<Result> MasterQueue::writeRegisters(
+    int address, uint16_t start, uint16_t const* values, size_t count
+) {
+    return submit([=](MasterInterface& master) {
+        return master.tryWriteRegisters(address, start, values, count);
+    });
+}
@@ -0,0 +1,125 @@
+#ifndef MODBUS_MASTERQUEUE_HPP
+#define MODBUS_MASTERQUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <modbus/MasterInterface.hpp>
+#include <modbus/MPSCQueue.hpp>
+
+namespace modbus {
+    /** Thread-safe front-end to a master
+     *
+     * The masters are not thread-safe, as they share their internal buffers
+     * between all calls. MasterQueue makes them usable from several threads
+     * without a lock around each transaction: any thread submits operations
+     * to a lock-free queue, and a single I/O thread owned by the queue runs
+     * them on the master, in submission order.
+     *
+     * The completion of an operation is reported through a future or a
+     * callback. Callbacks are called from the I/O thread, and must not
+     * throw. An exception thrown by an operation is passed to its future,
+     * or reported to its callback as RESULT_EXCEPTION.
+     *
+     * Once the queue is started, the master must not be accessed directly
+     * anymore.
+     */
+    class MasterQueue {
+    public:
+        /** An operation is one or more transactions on the master */
+        typedef std::function<Result (MasterInterface&)> Operation;
+
+        /** Callback called with the result of an operation */
+        typedef std::function<void (Result const&)> Callback;
+
+    private:
+        /** Called instead of the callback if the operation threw */
+        typedef std::function<void (std::exception_ptr)> ErrorCallback;
+
+        struct Request {
+            Operation operation;
+            Callback callback;
+            ErrorCallback error_callback;
+        };
+
+        MasterInterface& m_master;
+        MPSCQueue<Request> m_queue;
+        std::thread m_thread;
+
+        /** Set by the I/O thread while it waits for requests, so that
+         * producers only take the mutex when it needs to be woken up
+         */
+        std::atomic<bool> m_sleeping;
+        std::atomic<bool> m_quit;
+        std::mutex m_mutex;
+        std::condition_variable m_signal;
+
+        void push(Request&& request);
+        void process();
+        void run(Request& request);
+
+    public:
+        explicit MasterQueue(MasterInterface& master);
+
+        /** Stops the I/O thread, after it processed the queued operations */
+        ~MasterQueue();
+
+        MasterQueue(MasterQueue const&) = delete;
+        MasterQueue& operator=(MasterQueue const&) = delete;
+
+        /** Start the I/O thread */
+        void start();
+
+        /** Stop the I/O thread, after it processed the queued operations */
+        void stop();
+
+        /** Queue an operation and call the callback with its result */
+        void submit(Operation const& operation, Callback const& callback);
+
+        /** Queue an operation
+         *
+         * @return a future that becomes ready once the operation is done
+         */
+        std::future<Result> submit(Operation const& operation);
+
+        /** Queue a read of registers
+         *
+         * @param values output buffer, which must stay valid until the
+         *   returned future is ready
+         */
+        std::future<Result> readRegisters(
+            uint16_t* values, int address, bool input_registers, int start, int length
+        );
+
+        /** Queue a read of coils or digital inputs into a packed bit buffer
+         *
+         * @param bits output buffer, which must stay valid until the
+         *   returned future is ready
+         */
+        std::future<Result> readDigitalInputs(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, uint16_t count
+        );
+
+        /** Queue a write of a single register */
+        std::future<Result> writeSingleRegister(
+            int address, uint16_t register_id, uint16_t value
+        );
+
+        /** Queue a write of a single coil */
+        std::future<Result> writeSingleCoil(int address, uint16_t register_id, bool value);
+
+        /** Queue a write of multiple registers
+         *
+         * @param values the values, which must stay valid until the returned
+         *   future is ready
+         */
+        std::future<Result> writeRegisters(
+            int address, uint16_t start, uint16_t const* values, size_t count
+        );
+    };
+}
+
+#endif
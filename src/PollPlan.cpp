@@ -0,0 +1,250 @@
+#include <modbus/PollPlan.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <modbus/RTU.hpp>
+#include <modbus/TCP.hpp>
+
+using namespace std;
+using namespace base;
+using namespace modbus;
+
+/** Size of a read request frame on RTU, CRC included */
+static const int RTU_READ_REQUEST_SIZE = 8;
+/** Size of the header and CRC of a read reply frame on RTU */
+static const int RTU_READ_REPLY_OVERHEAD = 5;
+/** Size of the MBAP header and the PDU of a read request on TCP */
+static const int TCP_READ_REQUEST_SIZE = 12;
+/** Size of the MBAP header and the PDU header of a read reply on TCP */
+static const int TCP_READ_REPLY_OVERHEAD = 9;
+
+PollCost::PollCost(Time const& request_overhead, double bytes_per_second)
+    : request_overhead(request_overhead)
+    , bytes_per_second(bytes_per_second) {
+}
+
+PollCost PollCost::forRTU(int bitrate, Time const& turnaround) {
+    PollCost cost;
+    cost.bytes_per_second = static_cast<double>(bitrate) / RTU::SERIAL_BITS_PER_CHAR;
+    cost.request_overhead =
+        RTU::interframeDuration(bitrate) * 2 + turnaround +
+        cost.transmissionDuration(RTU_READ_REQUEST_SIZE + RTU_READ_REPLY_OVERHEAD);
+    return cost;
+}
+
+PollCost PollCost::forTCP(Time const& round_trip, double bytes_per_second) {
+    PollCost cost;
+    cost.bytes_per_second = bytes_per_second;
+    cost.request_overhead =
+        round_trip +
+        cost.transmissionDuration(TCP_READ_REQUEST_SIZE + TCP_READ_REPLY_OVERHEAD);
+    return cost;
+}
+
+Time PollCost::transmissionDuration(size_t bytes) const {
+    if (bytes_per_second <= 0) {
+        return Time();
+    }
+    return Time::fromSeconds(static_cast<double>(bytes) / bytes_per_second);
+}
+
+Time PollCost::requestDuration(size_t reply_bytes) const {
+    return request_overhead + transmissionDuration(reply_bytes);
+}
+
+static bool isBitTable(Table table) {
+    return table == TABLE_COILS || table == TABLE_DIGITAL_INPUTS;
+}
+
+/** Number of data bytes in a read reply */
+static size_t replyDataSize(Table table, size_t count) {
+    return isBitTable(table) ? (count + 7) / 8 : count * 2;
+}
+
+PollPlan::PollPlan(MasterInterface& master, PollCost const& cost)
+    : m_master(master)
+    , m_cost(cost) {
+}
+
+size_t PollPlan::addPoint(int slave, Table table, uint16_t address, int width) {
+    if (width < 1) {
+        throw std::invalid_argument("PollPlan::addPoint: empty point");
+    }
+    else if (65536 - address < width) {
+        throw std::invalid_argument(
+            "PollPlan::addPoint: point extends beyond register 65536"
+        );
+    }
+
+    Point point = { slave, table, address, width, 0 };
+    m_points.push_back(point);
+    m_compiled = false;
+    return m_points.size() - 1;
+}
+
+void PollPlan::compile() {
+    vector<size_t> order(m_points.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        Point const& pa = m_points[a];
+        Point const& pb = m_points[b];
+        if (pa.slave != pb.slave) {
+            return pa.slave < pb.slave;
+        }
+        else if (pa.table != pb.table) {
+            return pa.table < pb.table;
+        }
+        return pa.address < pb.address;
+    });
+
+    m_requests.clear();
+    auto group_start = order.begin();
+    while (group_start != order.end()) {
+        Point const& first = m_points[*group_start];
+        auto group_end = find_if(group_start, order.end(), [&](size_t i) {
+            return m_points[i].slave != first.slave || m_points[i].table != first.table;
+        });
+        compileTable(vector<size_t>(group_start, group_end));
+        group_start = group_end;
+    }
+
+    size_t register_count = 0;
+    size_t bit_bytes = 0;
+    for (auto& request : m_requests) {
+        if (isBitTable(request.table)) {
+            request.image_offset = bit_bytes;
+            bit_bytes += replyDataSize(request.table, request.count);
+        }
+        else {
+            request.image_offset = register_count;
+            register_count += request.count;
+        }
+    }
+    m_register_image.assign(register_count, 0);
+    m_bit_image.assign(bit_bytes, 0);
+    m_compiled = true;
+}
+
+void PollPlan::compileTable(vector<size_t> const& points) {
+    Point const& first = m_points[points.front()];
+    bool bits = isBitTable(first.table);
+    uint32_t max_block = bits ? m_master.getMaxBitReadBlockSize(first.slave) :
+                                m_master.getMaxRegisterReadBlockSize(first.slave);
+
+    bool open = false;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    for (size_t id : points) {
+        Point& point = m_points[id];
+        uint32_t point_start = point.address;
+        uint32_t point_end = point_start + point.width;
+
+        if (open) {
+            uint32_t gap = point_start > end ? point_start - end : 0;
+            uint32_t merged_end = max(end, point_end);
+            bool fits = merged_end - start <= max_block;
+            bool cheap = gap == 0 ||
+                m_cost.transmissionDuration(replyDataSize(first.table, gap)) <
+                m_cost.request_overhead;
+            if (fits && cheap) {
+                end = merged_end;
+                point.request = m_requests.size();
+                continue;
+            }
+
+            Request request = { first.slave, first.table, static_cast<uint16_t>(start),
+                                static_cast<int>(end - start), 0, Result() };
+            m_requests.push_back(request);
+        }
+
+        open = true;
+        start = point_start;
+        end = point_end;
+        point.request = m_requests.size();
+    }
+
+    Request request = { first.slave, first.table, static_cast<uint16_t>(start),
+                        static_cast<int>(end - start), 0, Result() };
+    m_requests.push_back(request);
+}
+
+vector<PollPlan::Request> const& PollPlan::getRequests() const {
+    return m_requests;
+}
+
+vector<PollPlan::Point> const& PollPlan::getPoints() const {
+    return m_points;
+}
+
+Time PollPlan::getEstimatedCycleDuration() const {
+    validateCompiled();
+
+    Time duration;
+    for (auto const& request : m_requests) {
+        duration += m_cost.requestDuration(replyDataSize(request.table, request.count));
+    }
+    return duration;
+}
+
+void PollPlan::validateCompiled() const {
+    if (!m_compiled) {
+        throw std::logic_error("PollPlan: the plan must be compiled first");
+    }
+}
+
+Result PollPlan::poll() {
+    validateCompiled();
+
+    Result first_error;
+    for (auto& request : m_requests) {
+        switch (request.table) {
+            case TABLE_COILS:
+            case TABLE_DIGITAL_INPUTS:
+                request.result = m_master.tryReadDigitalInputs(
+                    &m_bit_image[request.image_offset], request.slave,
+                    request.table == TABLE_COILS, request.start, request.count
+                );
+                break;
+            case TABLE_HOLDING_REGISTERS:
+            case TABLE_INPUT_REGISTERS:
+                request.result = m_master.tryReadRegisters(
+                    &m_register_image[request.image_offset], request.slave,
+                    request.table == TABLE_INPUT_REGISTERS, request.start, request.count
+                );
+                break;
+        }
+
+        if (!request.result.ok() && first_error.ok()) {
+            first_error = request.result;
+        }
+    }
+    return first_error;
+}
+
+uint16_t const* PollPlan::getRegisters(size_t point) const {
+    validateCompiled();
+
+    Point const& p = m_points.at(point);
+    if (isBitTable(p.table)) {
+        throw std::invalid_argument("PollPlan::getRegisters: point is not on a register table");
+    }
+    Request const& request = m_requests[p.request];
+    return &m_register_image[request.image_offset + p.address - request.start];
+}
+
+bool PollPlan::getBit(size_t point, int index) const {
+    validateCompiled();
+
+    Point const& p = m_points.at(point);
+    if (!isBitTable(p.table)) {
+        throw std::invalid_argument("PollPlan::getBit: point is not on a bit table");
+    }
+    else if (index < 0 || index >= p.width) {
+        throw std::out_of_range("PollPlan::getBit: index out of the point's range");
+    }
+    Request const& request = m_requests[p.request];
+    size_t bit = p.address - request.start + index;
+    return (m_bit_image[request.image_offset + bit / 8] >> (bit % 8)) & 1;
+}
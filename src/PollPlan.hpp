@@ -0,0 +1,181 @@
+#ifndef MODBUS_POLLPLAN_HPP
+#define MODBUS_POLLPLAN_HPP
+
+#include <base/Time.hpp>
+#include <modbus/MasterInterface.hpp>
+
+namespace modbus {
+    /** The four Modbus data tables */
+    enum Table {
+        TABLE_COILS,
+        TABLE_DIGITAL_INPUTS,
+        TABLE_HOLDING_REGISTERS,
+        TABLE_INPUT_REGISTERS
+    };
+
+    /** Cost model used by PollPlan to decide whether to read unused
+     * registers instead of sending one more request
+     */
+    struct PollCost {
+        /** Time spent on a request regardless of the amount of data read,
+         * i.e. round trip, turnaround, interframe delays and frame overhead
+         */
+        base::Time request_overhead;
+
+        /** Throughput of the link, used to estimate the time spent on the
+         * reply data
+         *
+         * Zero means that the transmission time is ignored
+         */
+        double bytes_per_second = 0;
+
+        PollCost() {}
+        PollCost(base::Time const& request_overhead, double bytes_per_second);
+
+        /** Cost model of a RTU serial line
+         *
+         * The request overhead is the transmission time of the request
+         * frame and of the reply's header and CRC, the interframe delay
+         * (RTU::interframeDuration) before each frame and the slave's
+         * turnaround time.
+         */
+        static PollCost forRTU(
+            int bitrate, base::Time const& turnaround = base::Time()
+        );
+
+        /** Cost model of a TCP link
+         *
+         * The request overhead is the round trip time. Reading a few more
+         * registers is almost free on a TCP link, so the plans are a lot more
+         * aggressive at bridging gaps than on RTU.
+         */
+        static PollCost forTCP(
+            base::Time const& round_trip, double bytes_per_second = 12.5e6
+        );
+
+        /** Estimated duration of a request whose reply contains the given
+         * number of data bytes
+         */
+        base::Time requestDuration(size_t reply_bytes) const;
+
+        /** Estimated time spent transmitting the given number of bytes */
+        base::Time transmissionDuration(size_t bytes) const;
+    };
+
+    /** Compiles a scattered list of registers and bits into a minimal set
+     * of read requests, and runs them into a flat image
+     *
+     * Points (slave, table, address, width) are declared with addPoint.
+     * compile() then sorts and merges them into requests. Gaps between
+     * points are read along when that is cheaper than a separate request,
+     * according to the PollCost, and requests are cut at the slave's
+     * maximum read block size (MasterInterface::setMaxReadBlockSize).
+     * Points wider than the block size get a request of their own, which
+     * the master splits.
+     *
+     * Some slaves reply with an exception when reading unmapped registers.
+     * Use a cost model with a null request overhead for these, so that only
+     * adjacent points get merged.
+     *
+     * Each call to poll() executes all the requests once, decoding the
+     * replies directly in the register and bit images. The values of a point
+     * are then accessed with getRegisters() or getBit().
+     */
+    class PollPlan {
+    public:
+        /** A register or bit range declared with addPoint */
+        struct Point {
+            int slave;
+            Table table;
+            uint16_t address;
+            int width;
+
+            /** Index of the request that reads the point, set by compile() */
+            size_t request;
+        };
+
+        /** A read request of the compiled plan */
+        struct Request {
+            int slave;
+            Table table;
+            uint16_t start;
+            int count;
+
+            /** Offset of the request's data in the register image (for
+             * register tables) or in the bit image, in bytes (for bit tables)
+             */
+            size_t image_offset;
+
+            /** Result of the last execution of the request */
+            Result result;
+        };
+
+    private:
+        MasterInterface& m_master;
+        PollCost m_cost;
+        std::vector<Point> m_points;
+        std::vector<Request> m_requests;
+        std::vector<uint16_t> m_register_image;
+        std::vector<uint8_t> m_bit_image;
+        bool m_compiled = false;
+
+        void compileTable(std::vector<size_t> const& points);
+        void validateCompiled() const;
+
+    public:
+        PollPlan(MasterInterface& master, PollCost const& cost);
+
+        /** Declare a range of registers or bits that should be polled
+         *
+         * Adding a point invalidates the compiled plan
+         *
+         * @param width the number of registers or bits
+         * @return the point ID, to be used to access its values
+         * @throw std::invalid_argument if the width is not positive, or if
+         *   the point extends beyond register 65536
+         */
+        size_t addPoint(int slave, Table table, uint16_t address, int width = 1);
+
+        /** Compute the requests from the declared points */
+        void compile();
+
+        /** The compiled requests */
+        std::vector<Request> const& getRequests() const;
+
+        /** The declared points */
+        std::vector<Point> const& getPoints() const;
+
+        /** Estimated duration of one poll() according to the cost model */
+        base::Time getEstimatedCycleDuration() const;
+
+        /** Execute all the requests of the plan once
+         *
+         * A failing request does not stop the cycle. The values read by a
+         * failed request are left unchanged, and its result is available
+         * in getRequests()
+         *
+         * @return the result of the first request that failed, or RESULT_OK
+         * @throw std::logic_error if the plan is not compiled
+         */
+        Result poll();
+
+        /** The register values of a point on a register table
+         *
+         * The returned pointer points to the plan's image, and has
+         * the point's width elements.
+         *
+         * @throw std::logic_error if the plan is not compiled
+         */
+        uint16_t const* getRegisters(size_t point) const;
+
+        /** The value of a bit of a point on a bit table
+         *
+         * @throw std::logic_error if the plan is not compiled
+         * @throw std::out_of_range if the index is not within the point's
+         *   width
+         */
+        bool getBit(size_t point, int index = 0) const;
+    };
+}
+
+#endif
@@ -0,0 +1,220 @@
+#include <modbus/PollScheduler.hpp>
+
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+using namespace base;
+using namespace modbus;
+
+PollScheduler::PollScheduler(MasterInterface& master)
+    : m_master(master)
+    , m_stats_start(Time::now())
+    , m_stop(false) {
+}
+
+size_t PollScheduler::addPeriodicJob(Job const& job, Time const& period,
+                                     Time const& deadline) {
+    if (period <= Time()) {
+        throw std::invalid_argument("PollScheduler::addPeriodicJob: invalid period");
+    }
+
+    PeriodicJob periodic;
+    periodic.job = job;
+    periodic.period = period;
+    periodic.deadline = deadline.isNull() ? period : deadline;
+    periodic.release = Time::now();
+    m_jobs.push_back(periodic);
+    return m_jobs.size() - 1;
+}
+
+void PollScheduler::enqueueUrgent(Job const& job) {
+    UrgentJob urgent = { job, Time::now() };
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_urgent.push_back(urgent);
+    }
+    m_signal.notify_one();
+}
+
+bool PollScheduler::runUrgent() {
+    UrgentJob urgent;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_urgent.empty()) {
+            return false;
+        }
+        urgent = m_urgent.front();
+        m_urgent.pop_front();
+    }
+
+    Time start = Time::now();
+    Result result;
+    try {
+        result = urgent.job(m_master);
+    }
+    catch(...) {
+        completeUrgent(urgent, start, false);
+        throw;
+    }
+    completeUrgent(urgent, start, result.ok());
+    return true;
+}
+
+void PollScheduler::completeUrgent(UrgentJob const& urgent, Time const& start,
+                                   bool success) {
+    Time duration = Time::now() - start;
+
+    m_busy += duration;
+    m_urgent_stats.runs++;
+    if (!success) {
+        m_urgent_stats.errors++;
+    }
+    m_urgent_stats.total_duration += duration;
+    if (start - urgent.queued > m_urgent_stats.max_latency) {
+        m_urgent_stats.max_latency = start - urgent.queued;
+    }
+}
+
+PollScheduler::PeriodicJob* PollScheduler::nextReleasedJob(Time const& now) {
+    PeriodicJob* next = nullptr;
+    for (auto& job : m_jobs) {
+        if (job.release > now) {
+            continue;
+        }
+        if (!next || job.release + job.deadline < next->release + next->deadline) {
+            next = &job;
+        }
+    }
+    return next;
+}
+
+bool PollScheduler::runOnce() {
+    if (runUrgent()) {
+        return true;
+    }
+
+    Time start = Time::now();
+    PeriodicJob* job = nextReleasedJob(start);
+    if (!job) {
+        return false;
+    }
+
+    Result result;
+    try {
+        result = job->job(m_master);
+    }
+    catch(...) {
+        completePeriodic(*job, start, false, false);
+        throw;
+    }
+    completePeriodic(*job, start, true, result.ok());
+    return true;
+}
+
+void PollScheduler::completePeriodic(PeriodicJob& job, Time const& start,
+                                     bool completed, bool success) {
+    Time end = Time::now();
+    Time duration = end - start;
+
+    m_busy += duration;
+    JobStats& stats = job.stats;
+    stats.runs++;
+    if (!success) {
+        stats.errors++;
+    }
+    stats.total_duration += duration;
+    if (duration > stats.max_duration) {
+        stats.max_duration = duration;
+    }
+    if (!completed || end > job.release + job.deadline) {
+        stats.deadline_misses++;
+    }
+
+    job.release += job.period;
+    while (job.release + job.deadline < end) {
+        stats.deadline_misses++;
+        job.release += job.period;
+    }
+}
+
+Time PollScheduler::nextRelease() const {
+    Time next;
+    for (auto const& job : m_jobs) {
+        if (next.isNull() || job.release < next) {
+            next = job.release;
+        }
+    }
+    return next;
+}
+
+void PollScheduler::waitForWork(Time const& limit) {
+    Time wakeup = nextRelease();
+    if (wakeup.isNull() || (!limit.isNull() && limit < wakeup)) {
+        wakeup = limit;
+    }
+
+    unique_lock<mutex> lock(m_mutex);
+    auto predicate = [this]() { return !m_urgent.empty() || m_stop; };
+    if (wakeup.isNull()) {
+        m_signal.wait(lock, predicate);
+    }
+    else {
+        Time timeout = wakeup - Time::now();
+        m_signal.wait_for(lock, chrono::microseconds(timeout.toMicroseconds()),
+                          predicate);
+    }
+}
+
+void PollScheduler::runUntil(Time const& end) {
+    while (!m_stop && Time::now() < end) {
+        if (!runOnce()) {
+            waitForWork(end);
+        }
+    }
+}
+
+void PollScheduler::run() {
+    while (!m_stop) {
+        if (!runOnce()) {
+            waitForWork(Time());
+        }
+    }
+}
+
+void PollScheduler::stop() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_signal.notify_one();
+}
+
+void PollScheduler::restart() {
+    m_stop = false;
+}
+
+PollScheduler::JobStats const& PollScheduler::getJobStats(size_t job) const {
+    return m_jobs.at(job).stats;
+}
+
+PollScheduler::UrgentStats const& PollScheduler::getUrgentStats() const {
+    return m_urgent_stats;
+}
+
+double PollScheduler::getBusUtilization() const {
+    Time elapsed = Time::now() - m_stats_start;
+    if (elapsed.isNull()) {
+        return 0;
+    }
+    return m_busy.toSeconds() / elapsed.toSeconds();
+}
+
+void PollScheduler::resetStatistics() {
+    for (auto& job : m_jobs) {
+        job.stats = JobStats();
+    }
+    m_urgent_stats = UrgentStats();
+    m_busy = Time();
+    m_stats_start = Time::now();
+}
@@ -0,0 +1,170 @@
+#ifndef MODBUS_POLLSCHEDULER_HPP
+#define MODBUS_POLLSCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <base/Time.hpp>
+#include <modbus/MasterInterface.hpp>
+
+namespace modbus {
+    /** Earliest-deadline-first scheduler for the transactions of a master
+     *
+     * The scheduler owns the access to the master: all transactions are
+     * done by jobs, which the scheduler runs one at a time in the thread
+     * that calls run(), runUntil() or runOnce().
+     *
+     * Periodic jobs are released every period, and must be done within
+     * their deadline relative to the release. Among the released jobs, the
+     * one with the earliest absolute deadline runs first. A job that
+     * completes after its deadline counts as a deadline miss. If the
+     * scheduler is so late that the deadline of a job's next release has
+     * already passed, that release is skipped and counted as a miss, instead
+     * of running the job back to back.
+     *
+     * Urgent jobs (e.g. writes triggered by the application) can be queued
+     * from any thread with enqueueUrgent. They run before any periodic job,
+     * as soon as the running job is finished. Keep periodic jobs short (e.g.
+     * one request each) to keep the latency of urgent jobs low.
+     */
+    class PollScheduler {
+    public:
+        /** A job is one or more transactions on the master */
+        typedef std::function<Result (MasterInterface&)> Job;
+
+        /** Statistics of a periodic job */
+        struct JobStats {
+            /** Number of times the job ran */
+            uint64_t runs = 0;
+            /** Number of runs that returned an error */
+            uint64_t errors = 0;
+            /** Number of releases that completed after their deadline, or
+             * that were skipped
+             */
+            uint64_t deadline_misses = 0;
+            /** Time spent running the job */
+            base::Time total_duration;
+            /** Longest run of the job */
+            base::Time max_duration;
+        };
+
+        /** Statistics of the urgent jobs */
+        struct UrgentStats {
+            uint64_t runs = 0;
+            uint64_t errors = 0;
+            /** Time spent running urgent jobs */
+            base::Time total_duration;
+            /** Longest time between the queueing of a job and its start */
+            base::Time max_latency;
+        };
+
+    private:
+        struct PeriodicJob {
+            Job job;
+            base::Time period;
+            base::Time deadline;
+            base::Time release;
+            JobStats stats;
+        };
+
+        struct UrgentJob {
+            Job job;
+            base::Time queued;
+        };
+
+        MasterInterface& m_master;
+        std::vector<PeriodicJob> m_jobs;
+        UrgentStats m_urgent_stats;
+        base::Time m_stats_start;
+        base::Time m_busy;
+
+        std::mutex m_mutex;
+        std::condition_variable m_signal;
+        std::deque<UrgentJob> m_urgent;
+        std::atomic<bool> m_stop;
+
+        bool runUrgent();
+        void completeUrgent(UrgentJob const& urgent, base::Time const& start,
+                            bool success);
+        PeriodicJob* nextReleasedJob(base::Time const& now);
+        void completePeriodic(PeriodicJob& job, base::Time const& start,
+                              bool completed, bool success);
+        base::Time nextRelease() const;
+        void waitForWork(base::Time const& limit);
+
+    public:
+        explicit PollScheduler(MasterInterface& master);
+
+        /** Add a periodic job
+         *
+         * The job is first released immediately
+         *
+         * @param period the job period
+         * @param deadline the deadline relative to each release. It
+         *   defaults to the period.
+         * @return the job ID, to be used with getJobStats
+         */
+        size_t addPeriodicJob(Job const& job, base::Time const& period,
+                              base::Time const& deadline = base::Time());
+
+        /** Queue a one-shot job that runs before any periodic job
+         *
+         * This is thread-safe
+         */
+        void enqueueUrgent(Job const& job);
+
+        /** Run the next job, if one is ready
+         *
+         * A job that throws counts as an error, and as a deadline miss for
+         * periodic jobs. Its next release is scheduled before the exception
+         * is passed on to the caller.
+         *
+         * @return false if there was no job to run
+         */
+        bool runOnce();
+
+        /** Run jobs until the given time, or until stop() is called */
+        void runUntil(base::Time const& end);
+
+        /** Run jobs until stop() is called */
+        void run();
+
+        /** Make run() and runUntil() return after the current job
+         *
+         * A stop() issued before run() or runUntil() is called makes them
+         * return immediately. It stays in effect until restart() is called.
+         *
+         * This is thread-safe
+         */
+        void stop();
+
+        /** Cancel a previous stop(), so that run() and runUntil() run jobs
+         * again
+         *
+         * This is thread-safe
+         */
+        void restart();
+
+        /** Statistics of a periodic job
+         *
+         * The statistics are updated by the thread that runs the jobs, and
+         * must be read from it or while it is not running
+         */
+        JobStats const& getJobStats(size_t job) const;
+
+        /** Statistics of the urgent jobs */
+        UrgentStats const& getUrgentStats() const;
+
+        /** Ratio of the time spent in jobs since the creation of the
+         * scheduler or the last call to resetStatistics
+         */
+        double getBusUtilization() const;
+
+        /** Reset the job statistics and the bus utilization */
+        void resetStatistics();
+    };
+}
+
+#endif
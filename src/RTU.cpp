@@ -15,6 +15,31 @@ base::Time RTU::interframeDuration(int bitrate) {
     return base::Time::fromMicroseconds(max(duration_us, 1750));
 }
 
+int RTU::predictReplyLength(uint8_t const* buffer) {
+    int function = buffer[1];
+    if (function & 0x80) {
+        return FRAME_OVERHEAD_SIZE + 1;
+    }
+
+    switch (function) {
+        case FUNCTION_READ_COILS:
+        case FUNCTION_READ_DIGITAL_INPUTS:
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS:
+        case FUNCTION_READ_WRITE_MULTIPLE_REGISTERS:
+            return FRAME_OVERHEAD_SIZE + 1 + buffer[2];
+        case FUNCTION_WRITE_SINGLE_COIL:
+        case FUNCTION_WRITE_SINGLE_REGISTER:
+        case FUNCTION_WRITE_MULTIPLE_COILS:
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS:
+            return FRAME_OVERHEAD_SIZE + 4;
+        case FUNCTION_MASK_WRITE_REGISTER:
+            return FRAME_OVERHEAD_SIZE + 6;
+        default:
+            return 0;
+    }
+}
+
 uint8_t* RTU::formatFrame(uint8_t* buffer, int address, int functionID,
                      std::vector<uint8_t> const& payload) {
 
@@ -58,37 +83,57 @@ Frame RTU::parseFrame(uint8_t const* start, uint8_t const* end) {
 }
 
 void RTU::parseFrame(Frame& frame, uint8_t const* start, uint8_t const* end) {
-    validateBufferSize(start, end, "RTU::parseFrame");
-    if (!isCRCValid(start, end)) {
-        throw InvalidCRC("RTU::parseFrame: CRC check failed");
-    }
+    FrameView view;
+    parseFrame(view, start, end);
+    view.copyTo(frame);
+}
 
-    frame.address  = start[0];
-    frame.function = start[1];
-    frame.payload.resize((end - start) - FRAME_OVERHEAD_SIZE);
-    std::copy(start + FRAME_HEADER_SIZE, end - 2, frame.payload.begin());
+void RTU::parseFrame(Frame& frame, uint8_t const* start, uint8_t const* end,
+                     CRCState const& crc) {
+    FrameView view;
+    parseFrame(view, start, end, crc);
+    view.copyTo(frame);
 }
 
-array<uint8_t, 2> RTU::crc(uint8_t const* start, uint8_t const* end) {
-    uint16_t crc = 0xFFFF;
-    for (uint8_t const* it = start; it != end; ++it) {
-        crc ^= (uint16_t)*it;
+void RTU::parseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end) {
+    CRCState crc;
+    crc.update(start, end);
+    parseFrame(frame, start, end, crc);
+}
 
-        for (int i = 8; i != 0; i--) {
-            if ((crc & 0x0001) != 0) {
-                crc >>= 1;
-                crc ^= 0xA001;
-            }
-            else {
-                crc >>= 1;
-            }
-        }
+void RTU::parseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end,
+                     CRCState const& crc) {
+    Result result = tryParseFrame(frame, start, end, crc);
+    if (result.code == RESULT_TOO_SMALL) {
+        // Generate the detailed error message
+        validateBufferSize(start, end, "RTU::parseFrame");
+    }
+    else if (!result.ok()) {
+        throw InvalidCRC(result.message);
     }
+}
 
-    array<uint8_t, 2> result;
-    result[0] = crc & 0xFF;
-    result[1] = (crc >> 8) & 0xFF;
-    return result;
+Result RTU::tryParseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end) {
+    CRCState crc;
+    crc.update(start, end);
+    return tryParseFrame(frame, start, end, crc);
+}
+
+Result RTU::tryParseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end,
+                          CRCState const& crc) {
+    if (end - start < FRAME_OVERHEAD_SIZE) {
+        return Result(RESULT_TOO_SMALL,
+                      "RTU::parseFrame: buffer too small to contain a RTU frame");
+    }
+    if (!crc.isValid()) {
+        return Result(RESULT_INVALID_CRC, "RTU::parseFrame: CRC check failed");
+    }
+
+    frame.address  = start[0];
+    frame.function = start[1];
+    frame.payload = start + FRAME_HEADER_SIZE;
+    frame.payload_size = (end - start) - FRAME_OVERHEAD_SIZE;
+    return Result();
 }
 
 bool RTU::isCRCValid(uint8_t const* start, uint8_t const* end) {
@@ -99,13 +144,13 @@ bool RTU::isCRCValid(uint8_t const* start, uint8_t const* end) {
 
 uint8_t* RTU::formatReadRegisters(
     uint8_t* buffer, uint8_t address,
-    bool input_registers, uint16_t start, uint8_t length) {
-    if (length > 128) {
+    bool input_registers, uint16_t start, int length) {
+    if (length < 1 || length > READ_REGISTERS_MAX_COUNT) {
         throw std::invalid_argument(
-            "RTU::formatReadRegisters: too many registers requested"
+            "RTU::formatReadRegisters: invalid number of registers requested"
         );
     }
-    else if (65535 - start < length) {
+    else if (65536 - start < length) {
         throw std::invalid_argument(
             "RTU::formatReadRegisters: attempting to read beyond register 65536"
         );
@@ -123,6 +168,17 @@ uint8_t* RTU::formatReadRegisters(
 uint8_t* RTU::formatReadDigitalInputs(
     uint8_t* buffer, uint8_t address, bool coils, uint16_t register_id, int count
 ) {
+    if (count < 1 || count > READ_DIGITAL_INPUTS_MAX_COUNT) {
+        throw std::invalid_argument(
+            "RTU::formatReadDigitalInputs: invalid number of inputs requested"
+        );
+    }
+    else if (65536 - register_id < count) {
+        throw std::invalid_argument(
+            "RTU::formatReadDigitalInputs: attempting to read beyond input 65536"
+        );
+    }
+
     uint8_t payload[4];
     format16(payload, register_id);
     format16(payload + 2, count);
@@ -147,4 +203,137 @@ uint8_t* RTU::formatWriteSingleCoil(uint8_t* buffer, uint8_t address,
     payload[3] = 0;
     return formatFrame(buffer, address, FUNCTION_WRITE_SINGLE_COIL,
                        payload, payload + 4);
-}
\ No newline at end of file
+}
+
+uint8_t* RTU::formatWriteRegisters(uint8_t* buffer, uint8_t address,
+                                   uint16_t start, uint16_t const* values,
+                                   int count) {
+    if (count < 1 || count > WRITE_REGISTERS_MAX_COUNT) {
+        throw std::invalid_argument(
+            "RTU::formatWriteRegisters: invalid number of registers"
+        );
+    }
+    else if (65536 - start < count) {
+        throw std::invalid_argument(
+            "RTU::formatWriteRegisters: attempting to write beyond register 65536"
+        );
+    }
+
+    uint8_t payload[5 + WRITE_REGISTERS_MAX_COUNT * 2];
+    uint8_t const* payload_end = formatWriteRegistersPayload(payload, start, values, count);
+    return formatFrame(buffer, address, FUNCTION_WRITE_MULTIPLE_REGISTERS,
+                       payload, payload_end);
+}
+
+uint8_t* RTU::formatWriteCoils(uint8_t* buffer, uint8_t address,
+                               uint16_t start, uint8_t const* bits, int count) {
+    if (count < 1 || count > WRITE_COILS_MAX_COUNT) {
+        throw std::invalid_argument(
+            "RTU::formatWriteCoils: invalid number of coils"
+        );
+    }
+    else if (65536 - start < count) {
+        throw std::invalid_argument(
+            "RTU::formatWriteCoils: attempting to write beyond coil 65536"
+        );
+    }
+
+    uint8_t payload[5 + WRITE_COILS_MAX_COUNT / 8];
+    uint8_t const* payload_end = formatWriteCoilsPayload(payload, start, bits, count);
+    return formatFrame(buffer, address, FUNCTION_WRITE_MULTIPLE_COILS,
+                       payload, payload_end);
+}
+
+uint8_t* RTU::formatWriteCoils(uint8_t* buffer, uint8_t address,
+                               uint16_t start, vector<bool> const& values) {
+    if (values.size() > static_cast<size_t>(WRITE_COILS_MAX_COUNT)) {
+        throw std::invalid_argument(
+            "RTU::formatWriteCoils: invalid number of coils"
+        );
+    }
+
+    uint8_t bits[WRITE_COILS_MAX_COUNT / 8];
+    packBits(bits, values, 0, values.size());
+    return formatWriteCoils(buffer, address, start, bits, values.size());
+}
+
+uint8_t* RTU::formatReadWriteRegisters(
+    uint8_t* buffer, uint8_t address, uint16_t read_start, int read_count,
+    uint16_t write_start, uint16_t const* write_values, int write_count
+) {
+    if (read_count < 1 || read_count > READ_WRITE_REGISTERS_MAX_READ_COUNT) {
+        throw std::invalid_argument(
+            "RTU::formatReadWriteRegisters: invalid number of registers to read"
+        );
+    }
+    else if (write_count < 1 || write_count > READ_WRITE_REGISTERS_MAX_WRITE_COUNT) {
+        throw std::invalid_argument(
+            "RTU::formatReadWriteRegisters: invalid number of registers to write"
+        );
+    }
+    else if (65536 - read_start < read_count || 65536 - write_start < write_count) {
+        throw std::invalid_argument(
+            "RTU::formatReadWriteRegisters: attempting to access beyond register 65536"
+        );
+    }
+
+    uint8_t payload[9 + READ_WRITE_REGISTERS_MAX_WRITE_COUNT * 2];
+    uint8_t const* payload_end = formatReadWriteRegistersPayload(
+        payload, read_start, read_count, write_start, write_values, write_count
+    );
+    return formatFrame(buffer, address, FUNCTION_READ_WRITE_MULTIPLE_REGISTERS,
+                       payload, payload_end);
+}
+
+uint8_t* RTU::formatMaskWriteRegister(uint8_t* buffer, uint8_t address,
+                                      uint16_t register_id,
+                                      uint16_t and_mask, uint16_t or_mask) {
+    uint8_t payload[6];
+    format16(payload, register_id);
+    format16(payload + 2, and_mask);
+    format16(payload + 4, or_mask);
+    return formatFrame(buffer, address, FUNCTION_MASK_WRITE_REGISTER,
+                       payload, payload + 6);
+}
+
+uint8_t* RTU::formatBatchRequest(uint8_t* buffer,
+                                 BatchRequest const& request) {
+    switch (request.function) {
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS:
+            return formatReadRegisters(
+                buffer, request.address,
+                request.function == FUNCTION_READ_INPUT_REGISTERS,
+                request.start, request.count
+            );
+        case FUNCTION_READ_COILS:
+        case FUNCTION_READ_DIGITAL_INPUTS:
+            return formatReadDigitalInputs(
+                buffer, request.address,
+                request.function == FUNCTION_READ_COILS,
+                request.start, request.count
+            );
+        case FUNCTION_WRITE_SINGLE_REGISTER:
+            return formatWriteRegister(
+                buffer, request.address, request.start, request.value
+            );
+        case FUNCTION_WRITE_SINGLE_COIL:
+            return formatWriteSingleCoil(
+                buffer, request.address, request.start, request.value != 0
+            );
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS:
+            return formatWriteRegisters(
+                buffer, request.address, request.start,
+                request.write_registers, request.count
+            );
+        case FUNCTION_WRITE_MULTIPLE_COILS:
+            return formatWriteCoils(
+                buffer, request.address, request.start,
+                request.write_bits, request.count
+            );
+        default:
+            throw std::invalid_argument(
+                "RTU::formatBatchRequest: unsupported function"
+            );
+    }
+}
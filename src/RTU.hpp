@@ -4,9 +4,10 @@
 #include <array>
 
 #include <base/Time.hpp>
+#include <modbus/BatchRequest.hpp>
 #include <modbus/Frame.hpp>
 #include <modbus/Functions.hpp>
-#include <modbus/RTU.hpp>
+#include <modbus/Result.hpp>
 
 namespace modbus {
     /**
@@ -35,11 +36,31 @@ namespace modbus {
         /** Number of bytes in a RTU frame header */
         static const int FRAME_HEADER_SIZE = 2;
 
+        /** RTU maximum payload size */
+        static const int FRAME_MAX_PAYLOAD_SIZE = FRAME_MAX_SIZE - FRAME_OVERHEAD_SIZE;
+
+        /** A static frame that can hold any RTU frame */
+        typedef modbus::StaticFrame<FRAME_MAX_PAYLOAD_SIZE> StaticFrame;
+
         /** Computes the interframe duration specified by the Modbus-on-serial
          * specification
          */
         base::Time interframeDuration(int bitrate);
 
+        /** Number of bytes predictReplyLength needs */
+        static const int REPLY_PREFIX_SIZE = 3;
+
+        /** Predict the length of a reply frame from its first bytes
+         *
+         * The length is known from the function code, or from the byte count
+         * of read replies. Exception replies are 5 bytes long.
+         *
+         * @arg buffer the first REPLY_PREFIX_SIZE bytes of the frame
+         * @return the frame length including the CRC, or 0 if the function
+         *   is not known
+         */
+        int predictReplyLength(uint8_t const* buffer);
+
         /** @overload
          */
         uint8_t* formatFrame(uint8_t* buffer, int address, int functionID,
@@ -76,9 +97,149 @@ namespace modbus {
          */
         void parseFrame(Frame& frame, uint8_t const* start, uint8_t const* end);
 
+        /** @overload parseFrame version that does not copy the payload
+         *
+         * The view's payload points into [start, end)
+         */
+        void parseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end);
+
+        /** @overload parseFrame version that parses into a static frame
+         *
+         * @throw std::length_error if the frame payload does not fit
+         */
+        template<size_t N>
+        void parseFrame(modbus::StaticFrame<N>& frame,
+                        uint8_t const* start, uint8_t const* end) {
+            FrameView view;
+            parseFrame(view, start, end);
+            frame.assign(view);
+        }
+
+        /** Value of the CRC register at the start of a frame */
+        static const uint16_t CRC_INITIAL_VALUE = 0xFFFF;
+
+        /** Feeds a string of bytes to a running Modbus CRC
+         *
+         * Start from CRC_INITIAL_VALUE. The CRC register holds the CRC's first
+         * byte on the wire (its LSB) in its low byte.
+         *
+         * This uses the fastest of the implementations below that is
+         * supported by the CPU
+         */
+        uint16_t updateCRC(uint16_t crc, uint8_t const* start, uint8_t const* end);
+
+        /** Bit-by-bit implementation of updateCRC
+         *
+         * This is the algorithm as described in the Modbus over serial line
+         * specification. It is kept as a reference for tests and benchmarks
+         */
+        uint16_t updateCRCBitwise(uint16_t crc, uint8_t const* start, uint8_t const* end);
+
+        /** Byte-wise table-driven implementation of updateCRC */
+        uint16_t updateCRCTable(uint16_t crc, uint8_t const* start, uint8_t const* end);
+
+        /** Slicing-by-8 implementation of updateCRC
+         *
+         * Processes 8 bytes per iteration using 8 lookup tables, falling back
+         * to updateCRCTable for the remaining bytes
+         */
+        uint16_t updateCRCSlicingBy8(uint16_t crc, uint8_t const* start, uint8_t const* end);
+
+        /** Minimum amount of bytes from which updateCRC uses the
+         * carry-less multiplication implementation
+         *
+         * Below this, the setup of the SIMD registers costs more than what
+         * it saves
+         */
+        static const int CRC_CLMUL_MIN_SIZE = 128;
+
+        /** Whether the CPU supports the carry-less multiplication (PCLMULQDQ)
+         * implementation of updateCRC
+         *
+         * The check is done once at runtime
+         */
+        bool hasCRCCarrylessMultiply();
+
+        /** Carry-less multiplication implementation of updateCRC
+         *
+         * It folds the input 64 bytes at a time using PCLMULQDQ, and finishes
+         * with updateCRCTable. It transparently falls back to
+         * updateCRCSlicingBy8 if the CPU does not support it (see
+         * hasCRCCarrylessMultiply) or for inputs smaller than
+         * CRC_CLMUL_MIN_SIZE.
+         */
+        uint16_t updateCRCCarrylessMultiply(
+            uint16_t crc, uint8_t const* start, uint8_t const* end
+        );
+
         /** Computes the Modbus CRC of a string of bytes */
         std::array<uint8_t, 2> crc(uint8_t const* start, uint8_t const* end);
 
+        /** Incremental computation of the Modbus CRC
+         *
+         * It allows to feed bytes as they are received. Once a whole frame,
+         * including its CRC, has been fed to the state, isValid() tells
+         * whether the frame's CRC was valid without having to go through
+         * the frame again.
+         */
+        class CRCState {
+            uint16_t m_crc = CRC_INITIAL_VALUE;
+
+        public:
+            /** Restart the computation for a new frame */
+            void reset();
+
+            /** Feed a single byte */
+            void update(uint8_t byte);
+
+            /** Feed a string of bytes */
+            void update(uint8_t const* start, uint8_t const* end);
+
+            /** The current value of the CRC register, in the format of
+             * updateCRC
+             */
+            uint16_t value() const;
+
+            /** The CRC of the bytes fed so far, as it should be appended
+             * to the frame
+             */
+            std::array<uint8_t, 2> bytes() const;
+
+            /** Whether the bytes fed so far are terminated by their valid
+             * CRC
+             *
+             * It relies on the property that the CRC of a string of bytes
+             * followed by its own CRC is zero. It does not check that enough
+             * bytes have been fed to form a frame.
+             */
+            bool isValid() const;
+        };
+
+        /** @overload parseFrame version that uses a CRC state that has already
+         *      been fed with the whole buffer, to avoid going through the
+         *      frame bytes a second time
+         */
+        void parseFrame(Frame& frame, uint8_t const* start, uint8_t const* end,
+                        CRCState const& crc);
+
+        /** @overload zero-copy parseFrame version that uses a CRC state that
+         *      has already been fed with the whole buffer
+         */
+        void parseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end,
+                        CRCState const& crc);
+
+        /** Non-throwing version of parseFrame
+         *
+         * @return RESULT_TOO_SMALL, RESULT_INVALID_CRC or RESULT_OK
+         */
+        Result tryParseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end);
+
+        /** @overload non-throwing parseFrame version that uses a CRC state
+         *      that has already been fed with the whole buffer
+         */
+        Result tryParseFrame(FrameView& frame, uint8_t const* start, uint8_t const* end,
+                             CRCState const& crc);
+
         /** Validates the CRC contained at the end of a string of bytes
          *
          * The CRC is expected to be formatted as specified by the Modbus RTU
@@ -90,14 +251,19 @@ namespace modbus {
          *
          * @arg whether input registers or holding registers should be read
          * @arg the start register
-         * @arg length the number of registers to read
+         * @arg length the number of registers to read, at most
+         *   common::READ_REGISTERS_MAX_COUNT
          */
         uint8_t* formatReadRegisters(
             uint8_t* buffer,
-            uint8_t address, bool input_registers, uint16_t start, uint8_t length
+            uint8_t address, bool input_registers, uint16_t start, int length
         );
 
-        /** Fill a byte buffer with a request to read multiple coils or digital inputs */
+        /** Fill a byte buffer with a request to read multiple coils or digital inputs
+         *
+         * @arg count the number of inputs to read, at most
+         *   common::READ_DIGITAL_INPUTS_MAX_COUNT
+         */
         uint8_t* formatReadDigitalInputs(
             uint8_t* buffer, uint8_t address,
             bool coils, uint16_t register_id, int count
@@ -120,6 +286,84 @@ namespace modbus {
         uint8_t* formatWriteSingleCoil(
             uint8_t* buffer, uint8_t address, uint16_t register_id, bool value
         );
+
+        /** Fill a byte buffer with a request to write multiple registers
+         *
+         * @arg the first register
+         * @arg the register values
+         * @arg count the number of registers to write, at most
+         *   common::WRITE_REGISTERS_MAX_COUNT
+         */
+        uint8_t* formatWriteRegisters(
+            uint8_t* buffer, uint8_t address,
+            uint16_t start, uint16_t const* values, int count
+        );
+
+        /** Fill a byte buffer with a request to write multiple coils
+         *
+         * @arg the first coil
+         * @arg the coil values as packed bits, in the format of
+         *   common::parseReadDigitalInputs
+         * @arg count the number of coils to write, at most
+         *   common::WRITE_COILS_MAX_COUNT
+         */
+        uint8_t* formatWriteCoils(
+            uint8_t* buffer, uint8_t address,
+            uint16_t start, uint8_t const* bits, int count
+        );
+
+        /** Fill a byte buffer with a request to write multiple coils
+         *
+         * @arg the first coil
+         * @arg the coil values, at most common::WRITE_COILS_MAX_COUNT
+         */
+        uint8_t* formatWriteCoils(
+            uint8_t* buffer, uint8_t address,
+            uint16_t start, std::vector<bool> const& values
+        );
+
+        /** Fill a byte buffer with a request to write and then read multiple
+         * holding registers in a single transaction
+         *
+         * @arg read_start the first register to read
+         * @arg read_count the number of registers to read, at most
+         *   common::READ_WRITE_REGISTERS_MAX_READ_COUNT
+         * @arg write_start the first register to write
+         * @arg write_values the values to write
+         * @arg write_count the number of registers to write, at most
+         *   common::READ_WRITE_REGISTERS_MAX_WRITE_COUNT
+         */
+        uint8_t* formatReadWriteRegisters(
+            uint8_t* buffer, uint8_t address,
+            uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        );
+
+        /** Fill a byte buffer with a request to modify a holding register
+         * through an AND and an OR mask
+         *
+         * The slave sets the register to
+         * (current & and_mask) | (or_mask & ~and_mask)
+         *
+         * @arg the register
+         * @arg the AND mask
+         * @arg the OR mask
+         */
+        uint8_t* formatMaskWriteRegister(
+            uint8_t* buffer, uint8_t address,
+            uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        );
+
+        /** Fill a byte buffer with the request described by a batch request
+         *
+         * The request must fit in a single Modbus request
+         *
+         * @throw std::invalid_argument if the request's function is not
+         *   supported in batches
+         */
+        uint8_t* formatBatchRequest(
+            uint8_t* buffer, BatchRequest const& request
+        );
     }
 }
 
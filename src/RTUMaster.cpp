@@ -1,13 +1,23 @@
 #include <modbus/RTUMaster.hpp>
 
+#include <iodrivers_base/Exceptions.hpp>
 #include <modbus/common.hpp>
 #include <modbus/Exceptions.hpp>
 #include <modbus/RTU.hpp>
+#include <chrono>
+#include <thread>
 
 using namespace std;
 using namespace base;
 using namespace modbus;
 
+/** Maximum number of bytes read at a time once a frame started
+ *
+ * readRaw returns as soon as the buffer it is given is full, so the CRC of
+ * a chunk is computed while the next bytes are being received
+ */
+static const int READ_CHUNK_SIZE = 16;
+
 int RTUMaster::extractPacket(uint8_t const* buffer, size_t bufferSize) const {
     throw std::logic_error("modbus::RTUMaster should be read only using readRaw");
 }
@@ -28,38 +38,165 @@ base::Time RTUMaster::getInterframeDelay() const {
     return m_interframe_delay;
 }
 
+void RTUMaster::throwOnError(Result const& result) {
+    switch (result.code) {
+        case RESULT_OK:
+            return;
+        case RESULT_TOO_SMALL:
+            throw RTU::TooSmall(result.message);
+        case RESULT_INVALID_CRC:
+            throw RTU::InvalidCRC(result.message);
+        case RESULT_REQUEST_EXCEPTION:
+            throw RequestException(result.function_code, result.exception_code,
+                                   result.message);
+        case RESULT_TIMEOUT:
+            throw iodrivers_base::TimeoutError(
+                static_cast<iodrivers_base::TimeoutError::TIMEOUT_TYPE>(
+                    result.timeout_type
+                ),
+                result.message
+            );
+        default:
+            throw UnexpectedReply(result.message);
+    }
+}
+
 Frame RTUMaster::readFrame() {
     Frame result;
     readFrame(result);
     return result;
 }
 
+void RTUMaster::setReplyLengthPrediction(bool enable) {
+    m_reply_length_prediction = enable;
+}
+
+bool RTUMaster::getReplyLengthPrediction() const {
+    return m_reply_length_prediction;
+}
+
+void RTUMaster::setInterframeSilence(base::Time const& silence) {
+    m_interframe_silence = silence;
+}
+
+base::Time RTUMaster::getInterframeSilence() const {
+    return m_interframe_silence;
+}
+
+void RTUMaster::waitInterframeSilence() {
+    Time elapsed = Time::now() - m_last_byte_time;
+    if (elapsed < m_interframe_silence) {
+        this_thread::sleep_for(chrono::microseconds(
+            (m_interframe_silence - elapsed).toMicroseconds()
+        ));
+    }
+}
+
+int RTUMaster::readFrameBytes(RTU::CRCState& crc, Time const& first_byte_timeout) {
+    uint8_t* buffer = &m_read_buffer[0];
+    int size = m_read_buffer.size();
+
+    int c = readRaw(buffer, 1, getReadTimeout(), first_byte_timeout, m_interframe_delay);
+    m_first_byte_time = Time::now();
+    crc.update(buffer, buffer + c);
+    if (!m_reply_length_prediction) {
+        return c + readFrameBytesUntil(crc, buffer + c, size - c);
+    }
+
+    // readRaw returns as soon as the buffer it is given is full, so reading
+    // exactly the predicted length does not wait for the interframe silence
+    c += readFrameBytesUntil(crc, buffer + c, RTU::REPLY_PREFIX_SIZE - c);
+    if (c < RTU::REPLY_PREFIX_SIZE) {
+        return c;
+    }
+
+    int expected = min(RTU::predictReplyLength(buffer), size);
+    if (expected > c) {
+        c += readFrameBytesUntil(crc, buffer + c, expected - c);
+        if (c < expected || crc.isValid()) {
+            return c;
+        }
+    }
+    return c + readFrameBytesUntil(crc, buffer + c, size - c);
+}
+
+int RTUMaster::readFrameBytesUntil(RTU::CRCState& crc, uint8_t* buffer, int size) {
+    int c = 0;
+    bool silence = false;
+    while (c < size) {
+        int chunk = min(size - c, READ_CHUNK_SIZE);
+        int read;
+        try {
+            read = readRaw(buffer + c, chunk,
+                           getReadTimeout(), m_interframe_delay, m_interframe_delay);
+        }
+        catch(iodrivers_base::TimeoutError const&) {
+            silence = true;
+            break;
+        }
+        crc.update(buffer + c, buffer + c + read);
+        c += read;
+        if (read < chunk) {
+            silence = true;
+            break;
+        }
+    }
+
+    // When the read stopped at the requested size, the bus might not have
+    // been silent yet
+    m_last_byte_time = silence ? Time::now() - m_interframe_delay : Time::now();
+    return c;
+}
+
 void RTUMaster::readFrame(Frame& frame) {
-    int c = readRaw(&m_read_buffer[0], m_read_buffer.size(),
-                    getReadTimeout(), getReadTimeout(), m_interframe_delay);
+    FrameView view;
+    readFrame(view);
+    view.copyTo(frame);
+}
+
+void RTUMaster::readFrame(FrameView& frame) {
+    throwOnError(tryReadFrame(frame));
+}
 
+Result RTUMaster::tryReadFrame(FrameView& frame) {
+    return tryReadFrame(frame, getReadTimeout());
+}
+
+Result RTUMaster::tryReadFrame(FrameView& frame, Time const& first_byte_timeout) {
+    RTU::CRCState crc;
+    int c;
     try {
-        RTU::parseFrame(frame, &m_read_buffer[0], &m_read_buffer[c]);
+        c = readFrameBytes(crc, first_byte_timeout);
     }
-    catch(...) {
+    catch(iodrivers_base::TimeoutError const& e) {
+        return Result::timeout(e.type, "RTUMaster: timed out waiting for a frame");
+    }
+
+    Result result = RTU::tryParseFrame(
+        frame, &m_read_buffer[0], &m_read_buffer[c], crc
+    );
+    if (!result.ok()) {
         m_stats.bad_rx += c;
-        throw;
     }
+    return result;
 }
 
 Frame const& RTUMaster::request(int address, int function, vector<uint8_t> const& payload) {
     uint8_t* start = &m_write_buffer[0];
     uint8_t const* end = RTU::formatFrame(start, address, function, payload);
-    writePacketAndReadReply(
+    FrameView reply;
+    throwOnError(writePacketAndReadReply(
         &m_write_buffer[0], end - start,
-        m_frame, function
-    );
+        reply, function
+    ));
+    reply.copyTo(m_frame);
     return m_frame;
 }
 
 void RTUMaster::broadcast(int function, vector<uint8_t> const& payload) {
     uint8_t* start = &m_write_buffer[0];
     uint8_t const* end = RTU::formatFrame(start, RTU::BROADCAST, function, payload);
+    waitInterframeSilence();
     writePacket(&m_write_buffer[0], end - start);
 }
 
@@ -70,21 +207,21 @@ Frame RTUMaster::readReply(int function) {
 }
 
 void RTUMaster::readReply(Frame& frame, int function) {
-    readFrame(frame);
-    if (frame.function == function) {
-        return;
-    }
+    FrameView view;
+    readReply(view, function);
+    view.copyTo(frame);
+}
 
-    if (frame.function == FUNCTION_CODE_EXCEPTION + function) {
-        int exception_code = 0;
-        if (frame.payload.size()) {
-            exception_code = frame.payload[0];
-        }
-        throw RequestException(function, exception_code, "request failed");
-    }
-    else {
-        throw UnexpectedReply("received reply's function does not match request");
+void RTUMaster::readReply(FrameView& frame, int function) {
+    throwOnError(tryReadReply(frame, function));
+}
+
+Result RTUMaster::tryReadReply(FrameView& frame, int function) {
+    Result result = tryReadFrame(frame);
+    if (!result.ok()) {
+        return result;
     }
+    return common::checkReply(frame, function);
 }
 
 vector<uint16_t> RTUMaster::readRegisters(int address, bool input_registers,
@@ -95,41 +232,86 @@ vector<uint16_t> RTUMaster::readRegisters(int address, bool input_registers,
     return registers;
 }
 
-void RTUMaster::writePacketAndReadReply(
+Result RTUMaster::writePacketAndReadReply(
     uint8_t const* buffer, int bufsize,
-    Frame& frame, int function
+    FrameView& frame, int function
 ) {
+    int address = buffer[0];
+    Time timeout = getReplyTimeout(address, function, getReadTimeout());
     Time deadline = Time::now() + getReadTimeout();
     do
     {
-        try {
-            writePacket(buffer, bufsize);
-            readReply(m_frame, function);
-            return;
+        waitInterframeSilence();
+        writePacket(buffer, bufsize);
+        Time sent = Time::now();
+        Result result = tryReadFrame(frame, timeout);
+        // The reply timeout is a first byte timeout, so the turnaround is
+        // measured up to the first byte (see updateReplyTimeout)
+        updateReplyTimeout(address, function, result, m_first_byte_time - sent);
+        if (result.ok()) {
+            result = common::checkReply(frame, function);
         }
-        catch(modbus::RTU::InvalidCRC const&) {
-            if (Time::now() > deadline) {
-                throw;
-            }
+        if (result.code != RESULT_INVALID_CRC || Time::now() >= deadline) {
+            return result;
         }
     }
     while(true);
 }
 
+size_t RTUMaster::execute(BatchRequest* requests, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        validate(requests[i]);
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        BatchRequest& request = requests[i];
+        if (fitsInOneRequest(request)) {
+            uint8_t* buffer_start = &m_write_buffer[0];
+            uint8_t const* buffer_end = RTU::formatBatchRequest(buffer_start, request);
+
+            FrameView reply;
+            request.result = writePacketAndReadReply(
+                buffer_start, buffer_end - buffer_start,
+                reply, request.function
+            );
+            if (request.result.ok()) {
+                request.result = common::tryParseBatchReply(request, reply);
+            }
+        }
+        else {
+            request.result = executeAlone(request);
+        }
+
+        if (!request.result.ok()) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
 void RTUMaster::readRegisters(uint16_t* values, int address,
                            bool input_registers, int start, int length) {
+    throwOnError(tryReadRegisters(values, address, input_registers, start, length));
+}
+
+Result RTUMaster::tryReadRegistersBlock(uint16_t* values, int address,
+                                        bool input_registers, int start, int length) {
     uint8_t* buffer_start = &m_write_buffer[0];
     uint8_t const* buffer_end = RTU::formatReadRegisters(
         buffer_start, address, input_registers, start, length
     );
 
-    writePacketAndReadReply(
+    FrameView reply;
+    Result result = writePacketAndReadReply(
         buffer_start, buffer_end - buffer_start,
-        m_frame, input_registers ? FUNCTION_READ_INPUT_REGISTERS :
-                                   FUNCTION_READ_HOLDING_REGISTERS
+        reply, input_registers ? FUNCTION_READ_INPUT_REGISTERS :
+                                 FUNCTION_READ_HOLDING_REGISTERS
     );
-
-    common::parseReadRegisters(values, m_frame, length);
+    if (!result.ok()) {
+        return result;
+    }
+    return common::tryParseReadRegisters(values, reply, length);
 }
 
 uint16_t RTUMaster::readSingleRegister(int address, bool input_registers,
@@ -140,40 +322,178 @@ uint16_t RTUMaster::readSingleRegister(int address, bool input_registers,
 }
 
 void RTUMaster::writeSingleRegister(int address, uint16_t register_id, uint16_t value) {
+    throwOnError(tryWriteSingleRegister(address, register_id, value));
+}
+
+Result RTUMaster::tryWriteSingleRegister(int address, uint16_t register_id,
+                                         uint16_t value) {
     uint8_t* buffer_start = &m_write_buffer[0];
     uint8_t const* buffer_end = RTU::formatWriteRegister(
         buffer_start, address, register_id, value
     );
-    writePacketAndReadReply(
+    FrameView reply;
+    return writePacketAndReadReply(
         buffer_start, buffer_end - buffer_start,
-        m_frame, FUNCTION_WRITE_SINGLE_REGISTER
+        reply, FUNCTION_WRITE_SINGLE_REGISTER
     );
 }
 
 void RTUMaster::writeSingleCoil(int address, uint16_t register_id, bool value) {
+    throwOnError(tryWriteSingleCoil(address, register_id, value));
+}
+
+Result RTUMaster::tryWriteSingleCoil(int address, uint16_t register_id, bool value) {
     uint8_t* buffer_start = &m_write_buffer[0];
     uint8_t const* buffer_end = RTU::formatWriteSingleCoil(
         buffer_start, address, register_id, value
     );
-    writePacketAndReadReply(
+    FrameView reply;
+    return writePacketAndReadReply(
         buffer_start, buffer_end - buffer_start,
-        m_frame, FUNCTION_WRITE_SINGLE_COIL
+        reply, FUNCTION_WRITE_SINGLE_COIL
     );
 }
 
 std::vector<bool> RTUMaster::readDigitalInputs(int address, bool coils, uint16_t register_id, uint16_t count) {
+    std::vector<uint8_t> bits((count + 7) / 8);
+    readDigitalInputs(bits.data(), address, coils, register_id, count);
+
+    std::vector<bool> values;
+    common::unpackBits(values, bits.data(), count);
+    return values;
+}
+
+void RTUMaster::readDigitalInputs(uint8_t* bits, int address, bool coils,
+                                  uint16_t register_id, uint16_t count) {
+    throwOnError(tryReadDigitalInputs(bits, address, coils, register_id, count));
+}
+
+Result RTUMaster::tryReadDigitalInputsBlock(uint8_t* bits, int address, bool coils,
+                                            uint16_t register_id, int count) {
     uint8_t* buffer_start = &m_write_buffer[0];
     uint8_t const* buffer_end = RTU::formatReadDigitalInputs(
         buffer_start, address, coils, register_id, count
     );
     auto function = coils ? FUNCTION_READ_COILS : FUNCTION_READ_DIGITAL_INPUTS;
 
-    writePacketAndReadReply(
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, function
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::tryParseReadDigitalInputs(bits, reply, count);
+}
+
+void RTUMaster::writeRegisters(int address, uint16_t start,
+                               uint16_t const* values, size_t count) {
+    throwOnError(tryWriteRegisters(address, start, values, count));
+}
+
+Result RTUMaster::tryWriteRegistersBlock(int address, uint16_t start,
+                                         uint16_t const* values, int count) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    uint8_t const* buffer_end = RTU::formatWriteRegisters(
+        buffer_start, address, start, values, count
+    );
+
+    FrameView reply;
+    Result result = writePacketAndReadReply(
         buffer_start, buffer_end - buffer_start,
-        m_frame, function
+        reply, FUNCTION_WRITE_MULTIPLE_REGISTERS
     );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkWriteMultipleReply(reply, start, count);
+}
 
-    std::vector<bool> values;
-    common::parseReadDigitalInputs(values, m_frame, count);
-    return values;
+void RTUMaster::writeCoils(int address, uint16_t start,
+                           uint8_t const* bits, size_t count) {
+    throwOnError(tryWriteCoils(address, start, bits, count));
+}
+
+void RTUMaster::writeCoils(int address, uint16_t start, vector<bool> const& values) {
+    vector<uint8_t> bits((values.size() + 7) / 8);
+    common::packBits(bits.data(), values, 0, values.size());
+    writeCoils(address, start, bits.data(), values.size());
+}
+
+Result RTUMaster::tryWriteCoilsBlock(int address, uint16_t start,
+                                     uint8_t const* bits, int count) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    uint8_t const* buffer_end = RTU::formatWriteCoils(
+        buffer_start, address, start, bits, count
+    );
+
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_WRITE_MULTIPLE_COILS
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkWriteMultipleReply(reply, start, count);
+}
+
+void RTUMaster::readWriteRegisters(
+    uint16_t* read_values, int address, uint16_t read_start, int read_count,
+    uint16_t write_start, uint16_t const* write_values, int write_count
+) {
+    throwOnError(tryReadWriteRegisters(
+        read_values, address, read_start, read_count,
+        write_start, write_values, write_count
+    ));
+}
+
+Result RTUMaster::tryReadWriteRegisters(
+    uint16_t* read_values, int address, uint16_t read_start, int read_count,
+    uint16_t write_start, uint16_t const* write_values, int write_count
+) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    uint8_t const* buffer_end = RTU::formatReadWriteRegisters(
+        buffer_start, address, read_start, read_count,
+        write_start, write_values, write_count
+    );
+
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_READ_WRITE_MULTIPLE_REGISTERS
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::tryParseReadRegisters(read_values, reply, read_count);
+}
+
+void RTUMaster::maskWriteRegister(int address, uint16_t register_id,
+                                 uint16_t and_mask, uint16_t or_mask) {
+    throwOnError(tryMaskWriteRegister(address, register_id, and_mask, or_mask));
+}
+
+Result RTUMaster::tryMaskWriteRegister(int address, uint16_t register_id,
+                                      uint16_t and_mask, uint16_t or_mask) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    uint8_t const* buffer_end = RTU::formatMaskWriteRegister(
+        buffer_start, address, register_id, and_mask, or_mask
+    );
+
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_MASK_WRITE_REGISTER
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkMaskWriteReply(reply, register_id, and_mask, or_mask);
+}
+
+void RTUMaster::writeRegisterBits(int address, uint16_t register_id,
+                                 uint16_t mask, uint16_t value) {
+    throwOnError(tryWriteRegisterBits(address, register_id, mask, value));
 }
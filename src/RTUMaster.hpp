@@ -5,6 +5,7 @@
 #include <modbus/Frame.hpp>
 #include <modbus/Exceptions.hpp>
 #include <modbus/MasterInterface.hpp>
+#include <modbus/RTU.hpp>
 
 namespace modbus {
     /**
@@ -40,6 +41,28 @@ namespace modbus {
          */
         base::Time m_interframe_delay = base::Time::fromMilliseconds(7);
 
+        /** @see setReplyLengthPrediction */
+        bool m_reply_length_prediction = false;
+
+        /** @see setInterframeSilence
+         *
+         * Default is the spec'd silence for bitrates above 19200 (1.750ms)
+         */
+        base::Time m_interframe_silence = base::Time::fromMicroseconds(1750);
+
+        /** Time at which the last byte of the last frame was received
+         *
+         * Used to leave the interframe silence before the next request
+         */
+        base::Time m_last_byte_time;
+
+        /** Time at which the first byte of the last frame was received
+         *
+         * This is the end of the slave's turnaround, used by the adaptive
+         * timeouts
+         */
+        base::Time m_first_byte_time;
+
         /** Internal read buffer */
         std::vector<uint8_t> m_read_buffer;
 
@@ -52,11 +75,70 @@ namespace modbus {
          */
         Frame m_frame;
 
-        static const int FUNCTION_CODE_EXCEPTION = 0x80;
+        /** Throws the exception that corresponds to a non-OK result */
+        static void throwOnError(Result const& result);
+
+        /** Read the bytes of one frame into m_read_buffer
+         *
+         * The bytes are fed to the CRC state as soon as the underlying driver
+         * returns them, so that the frame does not have to be processed
+         * a second time to validate it. The first byte is read on its own
+         * to timestamp it in m_first_byte_time
+         *
+         * @return the frame size in bytes
+         */
+        int readFrameBytes(RTU::CRCState& crc, base::Time const& first_byte_timeout);
+
+        /** Read the bytes that follow the first bytes of a frame, up to the
+         * given size or the interframe silence
+         *
+         * The bytes are read in small chunks, each fed to the CRC state as
+         * soon as it is received
+         *
+         * @return the number of bytes read, which may be zero
+         */
+        int readFrameBytesUntil(RTU::CRCState& crc, uint8_t* buffer, int size);
+
+        /** Wait until the interframe silence elapsed since the last frame
+         *
+         * This is a no-op unless the last frame was read without waiting
+         * for the silence that followed it
+         */
+        void waitInterframeSilence();
+
+        /** Read a frame, waiting at most the given time for its first byte */
+        Result tryReadFrame(FrameView& frame, base::Time const& first_byte_timeout);
 
-        void writePacketAndReadReply(
+        /** Send a request and read its reply
+         *
+         * The request is re-sent as long as the replies have an invalid CRC,
+         * until the read timeout is reached. The time allowed for the first
+         * byte of the reply is adaptive if adaptive timeouts are enabled.
+         */
+        Result writePacketAndReadReply(
             uint8_t const* buffer, int bufsize,
-            Frame& frame, int function
+            FrameView& frame, int function
+        );
+
+        /** Read a set of registers in a single request */
+        Result tryReadRegistersBlock(
+            uint16_t* values,
+            int address, bool input_registers, int start, int length
+        );
+
+        /** Read a set of coils or digital inputs in a single request */
+        Result tryReadDigitalInputsBlock(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, int count
+        );
+
+        /** Write a set of registers in a single request */
+        Result tryWriteRegistersBlock(
+            int address, uint16_t start, uint16_t const* values, int count
+        );
+
+        /** Write a set of coils in a single request */
+        Result tryWriteCoilsBlock(
+            int address, uint16_t start, uint8_t const* bits, int count
         );
 
     public:
@@ -77,6 +159,60 @@ namespace modbus {
          */
         base::Time getInterframeDelay() const;
 
+        /** Finish reading a frame as soon as it has the length predicted by
+         * its first bytes and a valid CRC
+         *
+         * Without it, reads end only after the interframe delay elapsed
+         * without data, which is most of the transaction time on fast
+         * buses. Frames whose length cannot be predicted, or that do not
+         * have a valid CRC at the predicted length, are read until the
+         * interframe silence as usual.
+         *
+         * The next request is then delayed until the interframe silence
+         * (setInterframeSilence) elapsed since the end of the reply. It is
+         * disabled by default.
+         */
+        void setReplyLengthPrediction(bool enable);
+
+        /** @see setReplyLengthPrediction */
+        bool getReplyLengthPrediction() const;
+
+        /** Change the minimum silence between the end of a frame and the
+         * next request
+         *
+         * Modbus requires 3.5 characters of silence between frames
+         * (RTU::interframeDuration). This is enforced only when the end of
+         * the last frame was not detected by waiting for the interframe
+         * delay, i.e. with reply length prediction. Defaults to 1.750ms,
+         * the spec'd value for bitrates above 19200 bauds.
+         */
+        void setInterframeSilence(base::Time const& silence);
+
+        /** @see setInterframeSilence */
+        base::Time getInterframeSilence() const;
+
+        using MasterInterface::readFrame;
+        using MasterInterface::readReply;
+
+        Result tryReadFrame(FrameView& frame);
+        Result tryReadReply(FrameView& frame, int function);
+        Result tryWriteSingleRegister(int address, uint16_t register_id, uint16_t value);
+        Result tryWriteSingleCoil(int address, uint16_t register_id, bool value);
+        Result tryMaskWriteRegister(
+            int address, uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        );
+        Result tryReadWriteRegisters(
+            uint16_t* read_values, int address, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        );
+
+        /** Run a batch of requests back to back
+         *
+         * Requests that fit in a single Modbus request are formatted and sent
+         * directly. The others are split as the corresponding methods do.
+         */
+        size_t execute(BatchRequest* requests, size_t count);
+
         /** Wait for one frame on the bus and read it
          */
         Frame readFrame();
@@ -85,6 +221,13 @@ namespace modbus {
          */
         void readFrame(Frame& frame);
 
+        /** Wait for one frame on the bus and return a view on it
+         *
+         * The view points into the master's internal buffer, and is valid
+         * only until the next read
+         */
+        void readFrame(FrameView& frame);
+
         /** Wait for the reply for the given request
          */
         Frame readReply(int function);
@@ -93,6 +236,13 @@ namespace modbus {
          */
         void readReply(Frame& frame, int function);
 
+        /** Wait for the reply for the given request and return a view on it
+         *
+         * The view points into the master's internal buffer, and is valid
+         * only until the next read
+         */
+        void readReply(FrameView& frame, int function);
+
         /** Send a request and wait for the slave's reply */
         Frame const& request(int address, int function,
                              std::vector<uint8_t> const& payload);
@@ -119,7 +269,60 @@ namespace modbus {
 
         void writeSingleCoil(int address, uint16_t register_id, bool value);
 
+        /** Write a set of contiguous registers
+         *
+         * Writes of more than common::WRITE_REGISTERS_MAX_COUNT registers are
+         * split into multiple requests
+         */
+        void writeRegisters(
+            int address, uint16_t start, uint16_t const* values, size_t count
+        );
+
+        /** Write a set of contiguous coils given as packed bits
+         *
+         * Writes of more than common::WRITE_COILS_MAX_COUNT coils are split
+         * into multiple requests
+         */
+        void writeCoils(
+            int address, uint16_t start, uint8_t const* bits, size_t count
+        );
+
+        /** Write a set of contiguous coils */
+        void writeCoils(int address, uint16_t start, std::vector<bool> const& values);
+
+        /** Modify a holding register through an AND and an OR mask */
+        void maskWriteRegister(
+            int address, uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        );
+
+        /** Change some bits of a holding register
+         *
+         * @see MasterInterface::writeRegisterBits
+         */
+        void writeRegisterBits(
+            int address, uint16_t register_id, uint16_t mask, uint16_t value
+        );
+
+        /** Write a set of holding registers and read another in a single
+         * transaction
+         */
+        void readWriteRegisters(
+            uint16_t* read_values, int address, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        );
+
         std::vector<bool> readDigitalInputs(int address, bool coils, uint16_t register_id, uint16_t count);
+
+        /** Read coils or digital inputs into a packed bit buffer
+         *
+         * The input i is stored in bit i % 8 of byte i / 8, which is how they
+         * are sent on the wire.
+         *
+         * @param bits output buffer of at least (count + 7) / 8 bytes
+         */
+        void readDigitalInputs(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, uint16_t count
+        );
     };
 }
 
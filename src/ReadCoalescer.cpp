@@ -0,0 +1,183 @@
+#include <modbus/ReadCoalescer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+using namespace modbus;
+
+ReadCoalescer::ReadCoalescer(MasterInterface& master)
+    : m_master(master) {
+}
+
+static bool isRegisterTable(Table table) {
+    return table == TABLE_HOLDING_REGISTERS || table == TABLE_INPUT_REGISTERS;
+}
+
+int ReadCoalescer::getMaxLength(Table table, int address) const {
+    if (isRegisterTable(table)) {
+        return m_master.getMaxRegisterReadBlockSize(address);
+    }
+    else {
+        return m_master.getMaxBitReadBlockSize(address);
+    }
+}
+
+shared_ptr<ReadCoalescer::Flight> ReadCoalescer::join(
+    Table table, int address, int start, int length
+) {
+    int end = start + length;
+    for (auto const& flight : m_flights) {
+        if (flight->table != table || flight->address != address) {
+            continue;
+        }
+
+        int flight_end = flight->start + flight->length;
+        if (flight->start <= start && end <= flight_end) {
+            m_coalesced_count++;
+            return flight;
+        }
+        else if (flight->started || end < flight->start || flight_end < start) {
+            continue;
+        }
+
+        int merged_start = min(start, flight->start);
+        int merged_end = max(end, flight_end);
+        if (merged_end - merged_start <= getMaxLength(table, address)) {
+            flight->start = merged_start;
+            flight->length = merged_end - merged_start;
+            m_coalesced_count++;
+            return flight;
+        }
+    }
+
+    shared_ptr<Flight> flight(new Flight());
+    flight->table = table;
+    flight->address = address;
+    flight->start = start;
+    flight->length = length;
+    m_flights.push_back(flight);
+    return flight;
+}
+
+Result ReadCoalescer::wait(unique_lock<mutex>& lock, Flight& flight) {
+    while (!flight.done) {
+        auto next = find_if(
+            m_flights.begin(), m_flights.end(),
+            [](shared_ptr<Flight> const& f) { return !f->started; }
+        );
+        if (m_bus_busy || next == m_flights.end()) {
+            m_signal.wait(lock);
+            continue;
+        }
+
+        // The bus is free. Run the oldest queued read, whoever it belongs
+        // to, so that reads get the bus in order
+        shared_ptr<Flight> running = *next;
+        running->started = true;
+        m_bus_busy = true;
+        m_transaction_count++;
+
+        lock.unlock();
+        Result result;
+        exception_ptr error;
+        try {
+            result = execute(*running);
+        }
+        catch(...) {
+            error = current_exception();
+        }
+        lock.lock();
+
+        m_bus_busy = false;
+        running->done = true;
+        running->result = result;
+        running->error = error;
+        m_flights.remove(running);
+        m_signal.notify_all();
+    }
+
+    if (flight.error) {
+        rethrow_exception(flight.error);
+    }
+    return flight.result;
+}
+
+Result ReadCoalescer::execute(Flight& flight) {
+    if (isRegisterTable(flight.table)) {
+        flight.registers.resize(flight.length);
+        return m_master.tryReadRegisters(
+            flight.registers.data(), flight.address,
+            flight.table == TABLE_INPUT_REGISTERS, flight.start, flight.length
+        );
+    }
+    else {
+        flight.bits.resize((flight.length + 7) / 8);
+        return m_master.tryReadDigitalInputs(
+            flight.bits.data(), flight.address,
+            flight.table == TABLE_COILS, flight.start, flight.length
+        );
+    }
+}
+
+Result ReadCoalescer::readRegisters(
+    uint16_t* values, int address, bool input_registers, int start, int length
+) {
+    if (length < 1 || start < 0 || length > 65536 - start) {
+        throw invalid_argument(
+            "ReadCoalescer::readRegisters: register range out of bounds"
+        );
+    }
+
+    Table table = input_registers ? TABLE_INPUT_REGISTERS : TABLE_HOLDING_REGISTERS;
+    unique_lock<mutex> lock(m_mutex);
+    shared_ptr<Flight> flight = join(table, address, start, length);
+    Result result = wait(lock, *flight);
+    if (result.ok()) {
+        auto begin = flight->registers.begin() + (start - flight->start);
+        copy(begin, begin + length, values);
+    }
+    return result;
+}
+
+Result ReadCoalescer::readDigitalInputs(
+    uint8_t* bits, int address, bool coils, int start, int count
+) {
+    if (count < 1 || start < 0 || count > 65536 - start) {
+        throw invalid_argument(
+            "ReadCoalescer::readDigitalInputs: bit range out of bounds"
+        );
+    }
+
+    Table table = coils ? TABLE_COILS : TABLE_DIGITAL_INPUTS;
+    unique_lock<mutex> lock(m_mutex);
+    shared_ptr<Flight> flight = join(table, address, start, count);
+    Result result = wait(lock, *flight);
+    if (result.ok()) {
+        memset(bits, 0, (count + 7) / 8);
+        int offset = start - flight->start;
+        for (int i = 0; i < count; ++i) {
+            int bit = offset + i;
+            if (flight->bits[bit / 8] & (1 << (bit % 8))) {
+                bits[i / 8] |= 1 << (i % 8);
+            }
+        }
+    }
+    return result;
+}
+
+size_t ReadCoalescer::getPendingReadCount() {
+    lock_guard<mutex> lock(m_mutex);
+    return m_flights.size();
+}
+
+size_t ReadCoalescer::getTransactionCount() {
+    lock_guard<mutex> lock(m_mutex);
+    return m_transaction_count;
+}
+
+size_t ReadCoalescer::getCoalescedReadCount() {
+    lock_guard<mutex> lock(m_mutex);
+    return m_coalesced_count;
+}
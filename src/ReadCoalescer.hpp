@@ -0,0 +1,99 @@
+#ifndef MODBUS_READCOALESCER_HPP
+#define MODBUS_READCOALESCER_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <modbus/MasterInterface.hpp>
+#include <modbus/PollPlan.hpp>
+
+namespace modbus {
+    /** Thread-safe read front-end that merges concurrent reads of the same
+     * registers into a single transaction
+     *
+     * Threads that read from the same slave table at the same time share
+     * their transactions:
+     *
+     * - a read that is fully contained in a pending read, queued or on the
+     *   bus, waits for it and is served from its reply
+     * - a read that overlaps or touches a read still waiting for the bus
+     *   widens it, as long as the merged read fits in the slave's maximum
+     *   read block size (MasterInterface::setMaxReadBlockSize)
+     *
+     * All the waiters get the result of the shared transaction, errors
+     * included. Exceptions thrown by the master are rethrown in every
+     * waiter.
+     *
+     * The coalescer serializes the accesses to the master. The master must
+     * not be used through other means while reads are in progress.
+     */
+    class ReadCoalescer {
+        struct Flight {
+            Table table;
+            int address;
+            int start;
+            int length;
+
+            /** Whether the transaction has been sent, i.e. the range is final */
+            bool started = false;
+            bool done = false;
+            Result result;
+            std::exception_ptr error;
+
+            std::vector<uint16_t> registers;
+            std::vector<uint8_t> bits;
+        };
+
+        MasterInterface& m_master;
+
+        std::mutex m_mutex;
+        std::condition_variable m_signal;
+        std::list<std::shared_ptr<Flight>> m_flights;
+        bool m_bus_busy = false;
+
+        size_t m_transaction_count = 0;
+        size_t m_coalesced_count = 0;
+
+        int getMaxLength(Table table, int address) const;
+        std::shared_ptr<Flight> join(
+            Table table, int address, int start, int length
+        );
+        Result wait(std::unique_lock<std::mutex>& lock, Flight& flight);
+        Result execute(Flight& flight);
+
+    public:
+        explicit ReadCoalescer(MasterInterface& master);
+
+        /** Read registers, sharing the transaction with concurrent reads
+         *
+         * @see MasterInterface::tryReadRegisters
+         */
+        Result readRegisters(
+            uint16_t* values,
+            int address, bool input_registers, int start, int length
+        );
+
+        /** Read coils or digital inputs into packed bits, sharing the
+         * transaction with concurrent reads
+         *
+         * @see MasterInterface::tryReadDigitalInputs
+         */
+        Result readDigitalInputs(
+            uint8_t* bits, int address, bool coils, int start, int count
+        );
+
+        /** Number of reads that are waiting for the bus or are on the bus */
+        size_t getPendingReadCount();
+
+        /** Number of transactions sent to the master */
+        size_t getTransactionCount();
+
+        /** Number of reads that were served by another read's transaction */
+        size_t getCoalescedReadCount();
+    };
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef MODBUS_RESULT_HPP
+#define MODBUS_RESULT_HPP
+
+namespace modbus {
+    /** Error codes of the non-throwing API
+     *
+     * Each code corresponds to an exception of the throwing API
+     */
+    enum ResultCode {
+        RESULT_OK = 0,
+        /** The received bytes are too small to contain a frame (TooSmall) */
+        RESULT_TOO_SMALL,
+        /** The frame's CRC is invalid (RTU::InvalidCRC) */
+        RESULT_INVALID_CRC,
+        /** The frame's transaction ID does not match the request's
+         * (TCP::TransactionIDMismatch)
+         */
+        RESULT_TRANSACTION_ID_MISMATCH,
+        /** The reply does not match the request (UnexpectedReply) */
+        RESULT_UNEXPECTED_REPLY,
+        /** The slave replied with an exception (RequestException) */
+        RESULT_REQUEST_EXCEPTION,
+        /** No reply was received in time (iodrivers_base::TimeoutError) */
+        RESULT_TIMEOUT,
+        /** The connection failed or was closed (iodrivers_base::UnixError)
+         *
+         * Only reported by the asynchronous TCPReactor. The masters throw
+         * instead
+         */
+        RESULT_IO_ERROR,
+        /** The operation threw an exception, e.g. std::invalid_argument for
+         * an invalid range
+         *
+         * Only reported by MasterQueue to the callbacks. Its futures get the
+         * exception itself
+         */
+        RESULT_EXCEPTION
+    };
+
+    /** Outcome of an operation of the non-throwing API
+     *
+     * The non-throwing API neither throws nor allocates on errors. It is
+     * meant for hot paths where errors are frequent, e.g. on a noisy bus.
+     */
+    struct Result {
+        ResultCode code = RESULT_OK;
+
+        /** Static description of the error, or nullptr on success */
+        char const* message = nullptr;
+
+        /** Function and exception codes of a RESULT_REQUEST_EXCEPTION
+         */
+        int function_code = 0;
+        int exception_code = 0;
+
+        /** The iodrivers_base::TimeoutError::TIMEOUT_TYPE of a RESULT_TIMEOUT
+         * reported by the masters, so that the throwing API raises the same
+         * error as the underlying driver
+         */
+        int timeout_type = 0;
+
+        Result() {}
+        Result(ResultCode code, char const* message)
+            : code(code)
+            , message(message) {
+        }
+
+        static Result requestException(int function_code, int exception_code) {
+            Result result(RESULT_REQUEST_EXCEPTION, "request failed");
+            result.function_code = function_code;
+            result.exception_code = exception_code;
+            return result;
+        }
+
+        static Result timeout(int timeout_type, char const* message) {
+            Result result(RESULT_TIMEOUT, message);
+            result.timeout_type = timeout_type;
+            return result;
+        }
+
+        bool ok() const {
+            return code == RESULT_OK;
+        }
+    };
+}
+
+#endif
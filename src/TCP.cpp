@@ -45,7 +45,7 @@ uint8_t* TCP::formatFrame(uint8_t* buffer,
     return buffer + 8 + payloadSize;
 }
 
-static uint16_t validateBufferSize(uint8_t const* start, uint8_t const* end,
+static void validateBufferSize(uint8_t const* start, uint8_t const* end,
                                    char const* context) {
     uint32_t size = end - start;
     if (end - start < TCP::FRAME_OVERHEAD_SIZE) {
@@ -66,8 +66,6 @@ static uint16_t validateBufferSize(uint8_t const* start, uint8_t const* end,
             " bytes but got " + to_string(size)
         );
     }
-
-    return lengthField - 2;
 }
 
 Frame TCP::parseFrame(uint16_t transactionID, uint8_t const* start, uint8_t const* end) {
@@ -78,31 +76,62 @@ Frame TCP::parseFrame(uint16_t transactionID, uint8_t const* start, uint8_t cons
 
 void TCP::parseFrame(Frame& frame, uint16_t transactionID,
                      uint8_t const* start, uint8_t const* end) {
-    uint16_t payloadLength = validateBufferSize(start, end, "TCP::parseFrame");
+    FrameView view;
+    parseFrame(view, transactionID, start, end);
+    view.copyTo(frame);
+}
+
+void TCP::parseFrame(FrameView& frame, uint16_t transactionID,
+                     uint8_t const* start, uint8_t const* end) {
+    Result result = tryParseFrame(frame, transactionID, start, end);
+    if (result.code == RESULT_TOO_SMALL) {
+        // Generate the detailed error message
+        validateBufferSize(start, end, "TCP::parseFrame");
+    }
+    else if (!result.ok()) {
+        throw TransactionIDMismatch(result.message);
+    }
+}
+
+Result TCP::tryParseFrame(FrameView& frame, uint16_t transactionID,
+                          uint8_t const* start, uint8_t const* end) {
+    if (end - start < FRAME_OVERHEAD_SIZE) {
+        return Result(RESULT_TOO_SMALL,
+                      "TCP::parseFrame: buffer too small to contain a TCP frame");
+    }
+
+    uint16_t lengthField;
+    parse16(start + 4, lengthField);
+    if (end - start != lengthField + 6) {
+        return Result(RESULT_TOO_SMALL,
+                      "TCP::parseFrame: length field does not match the buffer size");
+    }
 
     uint16_t msbTransactionID = start[0];
     uint16_t lsbTransactionID = start[1];
     uint16_t receivedTransactionID = msbTransactionID << 8 | lsbTransactionID;
     if (receivedTransactionID != transactionID) {
-        throw TransactionIDMismatch("received and expected transaction IDs mismatch");
+        return Result(RESULT_TRANSACTION_ID_MISMATCH,
+                      "received and expected transaction IDs mismatch");
     }
 
     frame.address  = start[6];
     frame.function = start[7];
-    frame.payload.resize(payloadLength);
-    std::copy(start + 8, end, frame.payload.begin());
+    frame.payload = start + 8;
+    frame.payload_size = lengthField - 2;
+    return Result();
 }
 
 uint8_t* TCP::formatReadRegisters(
     uint8_t* buffer,
     uint16_t transactionID, uint8_t address,
-    bool input_registers, uint16_t start, uint8_t length) {
-    if (length > 128) {
+    bool input_registers, uint16_t start, int length) {
+    if (length < 1 || length > READ_REGISTERS_MAX_COUNT) {
         throw std::invalid_argument(
-            "TCP::formatReadRegisters: too many registers requested"
+            "TCP::formatReadRegisters: invalid number of registers requested"
         );
     }
-    else if (65535 - start < length) {
+    else if (65536 - start < length) {
         throw std::invalid_argument(
             "TCP::formatReadRegisters: attempting to read beyond register 65536"
         );
@@ -130,6 +159,17 @@ uint8_t* TCP::formatReadDigitalInputs(
     uint8_t* buffer, uint16_t transactionID, uint8_t address,
     bool coils, uint16_t register_id, int count
 ) {
+    if (count < 1 || count > READ_DIGITAL_INPUTS_MAX_COUNT) {
+        throw std::invalid_argument(
+            "TCP::formatReadDigitalInputs: invalid number of inputs requested"
+        );
+    }
+    else if (65536 - register_id < count) {
+        throw std::invalid_argument(
+            "TCP::formatReadDigitalInputs: attempting to read beyond input 65536"
+        );
+    }
+
     uint8_t payload[4];
     format16(payload, register_id);
     format16(payload + 2, count);
@@ -145,4 +185,140 @@ uint8_t* TCP::formatWriteSingleCoil(uint8_t* buffer, uint16_t transactionID, uin
     payload[3] = 0;
     return formatFrame(buffer, transactionID, address, FUNCTION_WRITE_SINGLE_COIL,
                        payload, payload + 4);
-}
\ No newline at end of file
+}
+
+uint8_t* TCP::formatWriteRegisters(uint8_t* buffer, uint16_t transactionID,
+                                   uint8_t address, uint16_t start,
+                                   uint16_t const* values, int count) {
+    if (count < 1 || count > WRITE_REGISTERS_MAX_COUNT) {
+        throw std::invalid_argument(
+            "TCP::formatWriteRegisters: invalid number of registers"
+        );
+    }
+    else if (65536 - start < count) {
+        throw std::invalid_argument(
+            "TCP::formatWriteRegisters: attempting to write beyond register 65536"
+        );
+    }
+
+    uint8_t payload[5 + WRITE_REGISTERS_MAX_COUNT * 2];
+    uint8_t const* payload_end = formatWriteRegistersPayload(payload, start, values, count);
+    return formatFrame(buffer, transactionID, address,
+                       FUNCTION_WRITE_MULTIPLE_REGISTERS, payload, payload_end);
+}
+
+uint8_t* TCP::formatWriteCoils(uint8_t* buffer, uint16_t transactionID,
+                               uint8_t address, uint16_t start,
+                               uint8_t const* bits, int count) {
+    if (count < 1 || count > WRITE_COILS_MAX_COUNT) {
+        throw std::invalid_argument(
+            "TCP::formatWriteCoils: invalid number of coils"
+        );
+    }
+    else if (65536 - start < count) {
+        throw std::invalid_argument(
+            "TCP::formatWriteCoils: attempting to write beyond coil 65536"
+        );
+    }
+
+    uint8_t payload[5 + WRITE_COILS_MAX_COUNT / 8];
+    uint8_t const* payload_end = formatWriteCoilsPayload(payload, start, bits, count);
+    return formatFrame(buffer, transactionID, address,
+                       FUNCTION_WRITE_MULTIPLE_COILS, payload, payload_end);
+}
+
+uint8_t* TCP::formatWriteCoils(uint8_t* buffer, uint16_t transactionID,
+                               uint8_t address, uint16_t start,
+                               vector<bool> const& values) {
+    if (values.size() > static_cast<size_t>(WRITE_COILS_MAX_COUNT)) {
+        throw std::invalid_argument(
+            "TCP::formatWriteCoils: invalid number of coils"
+        );
+    }
+
+    uint8_t bits[WRITE_COILS_MAX_COUNT / 8];
+    packBits(bits, values, 0, values.size());
+    return formatWriteCoils(buffer, transactionID, address, start, bits, values.size());
+}
+
+uint8_t* TCP::formatReadWriteRegisters(
+    uint8_t* buffer, uint16_t transactionID, uint8_t address,
+    uint16_t read_start, int read_count,
+    uint16_t write_start, uint16_t const* write_values, int write_count
+) {
+    if (read_count < 1 || read_count > READ_WRITE_REGISTERS_MAX_READ_COUNT) {
+        throw std::invalid_argument(
+            "TCP::formatReadWriteRegisters: invalid number of registers to read"
+        );
+    }
+    else if (write_count < 1 || write_count > READ_WRITE_REGISTERS_MAX_WRITE_COUNT) {
+        throw std::invalid_argument(
+            "TCP::formatReadWriteRegisters: invalid number of registers to write"
+        );
+    }
+    else if (65536 - read_start < read_count || 65536 - write_start < write_count) {
+        throw std::invalid_argument(
+            "TCP::formatReadWriteRegisters: attempting to access beyond register 65536"
+        );
+    }
+
+    uint8_t payload[9 + READ_WRITE_REGISTERS_MAX_WRITE_COUNT * 2];
+    uint8_t const* payload_end = formatReadWriteRegistersPayload(
+        payload, read_start, read_count, write_start, write_values, write_count
+    );
+    return formatFrame(buffer, transactionID, address,
+                       FUNCTION_READ_WRITE_MULTIPLE_REGISTERS, payload, payload_end);
+}
+
+uint8_t* TCP::formatMaskWriteRegister(uint8_t* buffer, uint16_t transactionID,
+                                      uint8_t address, uint16_t register_id,
+                                      uint16_t and_mask, uint16_t or_mask) {
+    uint8_t payload[6];
+    format16(payload, register_id);
+    format16(payload + 2, and_mask);
+    format16(payload + 4, or_mask);
+    return formatFrame(buffer, transactionID, address, FUNCTION_MASK_WRITE_REGISTER,
+                       payload, payload + 6);
+}
+
+uint8_t* TCP::formatBatchRequest(uint8_t* buffer, uint16_t transactionID,
+                                 BatchRequest const& request) {
+    switch (request.function) {
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS:
+            return formatReadRegisters(
+                buffer, transactionID, request.address,
+                request.function == FUNCTION_READ_INPUT_REGISTERS,
+                request.start, request.count
+            );
+        case FUNCTION_READ_COILS:
+        case FUNCTION_READ_DIGITAL_INPUTS:
+            return formatReadDigitalInputs(
+                buffer, transactionID, request.address,
+                request.function == FUNCTION_READ_COILS,
+                request.start, request.count
+            );
+        case FUNCTION_WRITE_SINGLE_REGISTER:
+            return formatWriteRegister(
+                buffer, transactionID, request.address, request.start, request.value
+            );
+        case FUNCTION_WRITE_SINGLE_COIL:
+            return formatWriteSingleCoil(
+                buffer, transactionID, request.address, request.start, request.value != 0
+            );
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS:
+            return formatWriteRegisters(
+                buffer, transactionID, request.address, request.start,
+                request.write_registers, request.count
+            );
+        case FUNCTION_WRITE_MULTIPLE_COILS:
+            return formatWriteCoils(
+                buffer, transactionID, request.address, request.start,
+                request.write_bits, request.count
+            );
+        default:
+            throw std::invalid_argument(
+                "TCP::formatBatchRequest: unsupported function"
+            );
+    }
+}
@@ -5,8 +5,10 @@
 #include <stdexcept>
 #include <vector>
 
+#include <modbus/BatchRequest.hpp>
 #include <modbus/Frame.hpp>
 #include <modbus/Functions.hpp>
+#include <modbus/Result.hpp>
 
 namespace modbus {
     namespace TCP {
@@ -18,6 +20,11 @@ namespace modbus {
          */
         static const int FRAME_OVERHEAD_SIZE = 8;
 
+        /** Maximum size of a Modbus TCP frame, i.e. MBAP header and 253
+         * bytes PDU
+         */
+        static const int FRAME_MAX_SIZE = 260;
+
         /** Return the frame length encoded in the (frame-aligned) given buffer */
         uint16_t frameLength(uint8_t const* buffer);
 
@@ -62,16 +69,43 @@ namespace modbus {
         void parseFrame(Frame& frame,
                         uint16_t transactionID, uint8_t const* start, uint8_t const* end);
 
+        /** @overload parseFrame version that does not copy the payload
+         *
+         * The view's payload points into [start, end)
+         */
+        void parseFrame(FrameView& frame,
+                        uint16_t transactionID, uint8_t const* start, uint8_t const* end);
+
+        /** Non-throwing version of parseFrame
+         *
+         * @return RESULT_TOO_SMALL, RESULT_TRANSACTION_ID_MISMATCH or RESULT_OK
+         */
+        Result tryParseFrame(FrameView& frame,
+                             uint16_t transactionID, uint8_t const* start, uint8_t const* end);
+
+        /** @overload parseFrame version that parses into a static frame
+         *
+         * @throw std::length_error if the frame payload does not fit
+         */
+        template<size_t N>
+        void parseFrame(StaticFrame<N>& frame,
+                        uint16_t transactionID, uint8_t const* start, uint8_t const* end) {
+            FrameView view;
+            parseFrame(view, transactionID, start, end);
+            frame.assign(view);
+        }
+
         /** Fill a byte buffer with a request to read registers
          *
          * @arg whether input registers or holding registers should be read
          * @arg the start register
-         * @arg length the number of registers to read
+         * @arg length the number of registers to read, at most
+         *   common::READ_REGISTERS_MAX_COUNT
          */
         uint8_t* formatReadRegisters(
             uint8_t* buffer,
             uint16_t transactionID, uint8_t address,
-            bool input_registers, uint16_t start, uint8_t length
+            bool input_registers, uint16_t start, int length
         );
 
         /** Fill a byte buffer with a request to write a single register
@@ -84,7 +118,11 @@ namespace modbus {
             uint16_t register_id, uint16_t value
         );
 
-        /** Fill a byte buffer with a request to read multiple coils or digital inputs */
+        /** Fill a byte buffer with a request to read multiple coils or digital inputs
+         *
+         * @arg count the number of inputs to read, at most
+         *   common::READ_DIGITAL_INPUTS_MAX_COUNT
+         */
         uint8_t* formatReadDigitalInputs(
             uint8_t* buffer, uint16_t transactionID, uint8_t address,
             bool coils, uint16_t register_id, int count
@@ -99,6 +137,84 @@ namespace modbus {
             uint8_t* buffer, uint16_t transactionID, uint8_t address,
             uint16_t register_id, bool value
         );
+
+        /** Fill a byte buffer with a request to write multiple registers
+         *
+         * @arg the first register
+         * @arg the register values
+         * @arg count the number of registers to write, at most
+         *   common::WRITE_REGISTERS_MAX_COUNT
+         */
+        uint8_t* formatWriteRegisters(
+            uint8_t* buffer, uint16_t transactionID, uint8_t address,
+            uint16_t start, uint16_t const* values, int count
+        );
+
+        /** Fill a byte buffer with a request to write multiple coils
+         *
+         * @arg the first coil
+         * @arg the coil values as packed bits, in the format of
+         *   common::parseReadDigitalInputs
+         * @arg count the number of coils to write, at most
+         *   common::WRITE_COILS_MAX_COUNT
+         */
+        uint8_t* formatWriteCoils(
+            uint8_t* buffer, uint16_t transactionID, uint8_t address,
+            uint16_t start, uint8_t const* bits, int count
+        );
+
+        /** Fill a byte buffer with a request to write multiple coils
+         *
+         * @arg the first coil
+         * @arg the coil values, at most common::WRITE_COILS_MAX_COUNT
+         */
+        uint8_t* formatWriteCoils(
+            uint8_t* buffer, uint16_t transactionID, uint8_t address,
+            uint16_t start, std::vector<bool> const& values
+        );
+
+        /** Fill a byte buffer with a request to write and then read multiple
+         * holding registers in a single transaction
+         *
+         * @arg read_start the first register to read
+         * @arg read_count the number of registers to read, at most
+         *   common::READ_WRITE_REGISTERS_MAX_READ_COUNT
+         * @arg write_start the first register to write
+         * @arg write_values the values to write
+         * @arg write_count the number of registers to write, at most
+         *   common::READ_WRITE_REGISTERS_MAX_WRITE_COUNT
+         */
+        uint8_t* formatReadWriteRegisters(
+            uint8_t* buffer, uint16_t transactionID, uint8_t address,
+            uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        );
+
+        /** Fill a byte buffer with a request to modify a holding register
+         * through an AND and an OR mask
+         *
+         * The slave sets the register to
+         * (current & and_mask) | (or_mask & ~and_mask)
+         *
+         * @arg the register
+         * @arg the AND mask
+         * @arg the OR mask
+         */
+        uint8_t* formatMaskWriteRegister(
+            uint8_t* buffer, uint16_t transactionID, uint8_t address,
+            uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        );
+
+        /** Fill a byte buffer with the request described by a batch request
+         *
+         * The request must fit in a single Modbus request
+         *
+         * @throw std::invalid_argument if the request's function is not
+         *   supported in batches
+         */
+        uint8_t* formatBatchRequest(
+            uint8_t* buffer, uint16_t transactionID, BatchRequest const& request
+        );
     }
 }
 
@@ -1,5 +1,6 @@
 #include <modbus/TCPMaster.hpp>
 
+#include <iodrivers_base/Exceptions.hpp>
 #include <modbus/common.hpp>
 #include <modbus/Exceptions.hpp>
 #include <modbus/TCP.hpp>
@@ -8,30 +9,49 @@ using namespace std;
 using namespace base;
 using namespace modbus;
 
-int TCPMaster::extractPacket(uint8_t const* buffer, size_t bufferSize) const {
-    if (bufferSize < 4) {
-        return 0;
-    }
-    if (buffer[0] != m_transaction_id >> 8) {
-        return -1;
+/** Whether the given bytes may be the beginning of a MBAP header
+ *
+ * Only the available bytes are checked: the protocol ID must be zero, and the
+ * length field must cover at least the unit ID and the function code
+ */
+static bool isHeaderPrefix(uint8_t const* buffer, size_t size) {
+    if (size > 2 && buffer[2] != 0) {
+        return false;
     }
-    if (buffer[1] != (m_transaction_id & 0xff)) {
-        return -1;
+    if (size > 3 && buffer[3] != 0) {
+        return false;
     }
-    if (buffer[2] != 0) {
-        return -1;
+    if (size > 5) {
+        size_t length = TCP::frameLength(buffer);
+        return TCP::FRAME_OVERHEAD_SIZE <= length && length <= TCP::FRAME_MAX_SIZE;
     }
-    if (buffer[3] != 0) {
-        return -1;
+    return true;
+}
+
+int TCPMaster::extractPacket(uint8_t const* buffer, size_t bufferSize) const {
+    if (!isHeaderPrefix(buffer, bufferSize)) {
+        // Skip to the next possible header in one go. There always is
+        // one, as the checks need the bytes after the transaction ID
+        size_t skip = 1;
+        while (!isHeaderPrefix(buffer + skip, bufferSize - skip)) {
+            ++skip;
+        }
+        m_resync_count++;
+        return -static_cast<int>(skip);
     }
     if (bufferSize < TCP::FRAME_OVERHEAD_SIZE) {
         return 0;
     }
-    uint16_t length = TCP::frameLength(buffer);
-    if (length < bufferSize) {
+    size_t length = TCP::frameLength(buffer);
+    if (length > bufferSize) {
         return 0;
     }
 
+    uint16_t transaction_id = static_cast<uint16_t>(buffer[0]) << 8 | buffer[1];
+    if (transaction_id != m_transaction_id && !isPending(transaction_id)) {
+        m_stale_reply_count++;
+        return -static_cast<int>(length);
+    }
     return length;
 }
 
@@ -44,9 +64,42 @@ TCPMaster::TCPMaster(uint16_t max_payload_size)
 }
 
 uint16_t TCPMaster::allocateTransactionID() {
-    uint8_t lsb = m_transaction_id;
-    ++lsb;
-    return 0xAA00 | lsb;
+    while (isPending(m_next_transaction_id)) {
+        ++m_next_transaction_id;
+    }
+    return m_next_transaction_id++;
+}
+
+bool TCPMaster::isPending(uint16_t transaction_id) const {
+    for (auto const& pending : m_pending) {
+        if (pending.transaction_id == transaction_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TCPMaster::throwOnError(Result const& result) {
+    switch (result.code) {
+        case RESULT_OK:
+            return;
+        case RESULT_TOO_SMALL:
+            throw TCP::TooSmall(result.message);
+        case RESULT_TRANSACTION_ID_MISMATCH:
+            throw TCP::TransactionIDMismatch(result.message);
+        case RESULT_REQUEST_EXCEPTION:
+            throw RequestException(result.function_code, result.exception_code,
+                                   result.message);
+        case RESULT_TIMEOUT:
+            throw iodrivers_base::TimeoutError(
+                static_cast<iodrivers_base::TimeoutError::TIMEOUT_TYPE>(
+                    result.timeout_type
+                ),
+                result.message
+            );
+        default:
+            throw UnexpectedReply(result.message);
+    }
 }
 
 Frame TCPMaster::readFrame() {
@@ -56,8 +109,53 @@ Frame TCPMaster::readFrame() {
 }
 
 void TCPMaster::readFrame(Frame& frame) {
-    int c = readPacket(&m_read_buffer[0], m_read_buffer.size());
-    TCP::parseFrame(frame, m_transaction_id, &m_read_buffer[0], &m_read_buffer[c]);
+    FrameView view;
+    readFrame(view);
+    view.copyTo(frame);
+}
+
+void TCPMaster::readFrame(FrameView& frame) {
+    throwOnError(tryReadFrame(frame));
+}
+
+Result TCPMaster::tryReadFrame(FrameView& frame) {
+    return tryReadFrame(frame, getReadTimeout());
+}
+
+Result TCPMaster::tryReadFrame(FrameView& frame, Time const& timeout) {
+    int c;
+    try {
+        c = readPacket(&m_read_buffer[0], m_read_buffer.size(), timeout);
+    }
+    catch(iodrivers_base::TimeoutError const& e) {
+        return Result::timeout(e.type, "TCPMaster: timed out waiting for a frame");
+    }
+    return TCP::tryParseFrame(frame, m_transaction_id,
+                              &m_read_buffer[0], &m_read_buffer[c]);
+}
+
+Result TCPMaster::writePacketAndReadReply(
+    uint8_t const* buffer, int bufsize,
+    FrameView& frame, int function
+) {
+    if (!m_pending.empty()) {
+        throw std::logic_error(
+            "TCPMaster: request-reply transaction while pipelined requests "
+            "are waiting for their reply"
+        );
+    }
+
+    int address = buffer[6];
+    writePacket(buffer, bufsize);
+    Time sent = Time::now();
+    Result result = tryReadFrame(frame, getReplyTimeout(address, function, getReadTimeout()));
+    // The reply timeout is a packet timeout, so the turnaround is measured
+    // up to the end of the reply (see updateReplyTimeout)
+    updateReplyTimeout(address, function, result, Time::now() - sent);
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkReply(frame, function);
 }
 
 Frame const& TCPMaster::request(int address, int function, vector<uint8_t> const& payload) {
@@ -66,11 +164,223 @@ Frame const& TCPMaster::request(int address, int function, vector<uint8_t> const
     uint8_t const* end = TCP::formatFrame(
         start, m_transaction_id, address, function, payload
     );
-    writePacket(&m_write_buffer[0], end - start);
-    readReply(m_frame, function);
+    FrameView reply;
+    throwOnError(writePacketAndReadReply(start, end - start, reply, function));
+    reply.copyTo(m_frame);
     return m_frame;
 }
 
+size_t TCPMaster::getStaleReplyCount() const {
+    return m_stale_reply_count;
+}
+
+size_t TCPMaster::getResyncCount() const {
+    return m_resync_count;
+}
+
+void TCPMaster::resetSynchronizationCounters() {
+    m_stale_reply_count = 0;
+    m_resync_count = 0;
+}
+
+void TCPMaster::setMaxPendingRequests(size_t count) {
+    if (count < 1 || count > 256) {
+        throw std::invalid_argument(
+            "TCPMaster::setMaxPendingRequests: count must be between 1 and 256"
+        );
+    }
+    m_max_pending = count;
+}
+
+size_t TCPMaster::getMaxPendingRequests() const {
+    return m_max_pending;
+}
+
+size_t TCPMaster::getPendingRequestCount() const {
+    return m_pending.size();
+}
+
+void TCPMaster::clearPendingRequests() {
+    m_pending.clear();
+    m_send_queue.clear();
+    m_queued_count = 0;
+}
+
+uint16_t TCPMaster::sendRequest(int address, int function,
+                                vector<uint8_t> const& payload) {
+    uint16_t transaction_id = queueRequest(address, function, payload);
+    flushRequests();
+    return transaction_id;
+}
+
+uint16_t TCPMaster::queueRequest(int address, int function,
+                                 vector<uint8_t> const& payload) {
+    if (m_pending.size() >= m_max_pending) {
+        throw std::logic_error(
+            "TCPMaster::queueRequest: too many requests waiting for their reply"
+        );
+    }
+
+    size_t offset = m_send_queue.size();
+    m_send_queue.resize(offset + TCP::FRAME_OVERHEAD_SIZE + payload.size());
+    m_transaction_id = allocateTransactionID();
+    TCP::formatFrame(&m_send_queue[offset], m_transaction_id, address, function, payload);
+    m_pending.push_back(PendingRequest { m_transaction_id, function });
+    m_queued_count++;
+    return m_transaction_id;
+}
+
+void TCPMaster::queueBatchRequest(BatchRequest const& request) {
+    // Format out of the send queue, so that nothing is queued if the
+    // formatting throws
+    uint8_t frame[TCP::FRAME_MAX_SIZE];
+    uint16_t transaction_id = allocateTransactionID();
+    uint8_t* end = TCP::formatBatchRequest(frame, transaction_id, request);
+    m_send_queue.insert(m_send_queue.end(), frame, end);
+    m_pending.push_back(PendingRequest { transaction_id, request.function });
+    m_queued_count++;
+}
+
+void TCPMaster::flushRequests() {
+    if (m_send_queue.empty()) {
+        return;
+    }
+    writePacket(&m_send_queue[0], m_send_queue.size());
+    m_send_queue.clear();
+    m_queued_count = 0;
+}
+
+size_t TCPMaster::getQueuedRequestCount() const {
+    return m_queued_count;
+}
+
+uint16_t TCPMaster::readNextReply(Frame& frame) {
+    FrameView view;
+    uint16_t transaction_id = readNextReply(view);
+    view.copyTo(frame);
+    return transaction_id;
+}
+
+uint16_t TCPMaster::readNextReply(FrameView& frame) {
+    uint16_t transaction_id = 0;
+    throwOnError(tryReadNextReply(frame, transaction_id));
+    return transaction_id;
+}
+
+Result TCPMaster::tryReadNextReply(FrameView& frame, uint16_t& transaction_id) {
+    if (m_pending.empty()) {
+        throw std::logic_error(
+            "TCPMaster::readNextReply: no request waiting for its reply"
+        );
+    }
+    flushRequests();
+
+    int c;
+    try {
+        c = readPacket(&m_read_buffer[0], m_read_buffer.size());
+    }
+    catch(iodrivers_base::TimeoutError const& e) {
+        return Result::timeout(e.type, "TCPMaster: timed out waiting for a reply");
+    }
+
+    transaction_id = static_cast<uint16_t>(m_read_buffer[0]) << 8 | m_read_buffer[1];
+    auto pending = m_pending.begin();
+    while (pending != m_pending.end() && pending->transaction_id != transaction_id) {
+        ++pending;
+    }
+    if (pending == m_pending.end()) {
+        // Reply to the last request-reply transaction, which shares the
+        // extraction logic
+        return Result(RESULT_TRANSACTION_ID_MISMATCH,
+                      "TCPMaster: reply does not match any pending request");
+    }
+    int function = pending->function;
+    m_pending.erase(pending);
+
+    Result result = TCP::tryParseFrame(frame, transaction_id,
+                                       &m_read_buffer[0], &m_read_buffer[c]);
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkReply(frame, function);
+}
+
+size_t TCPMaster::execute(BatchRequest* requests, size_t count) {
+    if (!m_pending.empty()) {
+        throw std::logic_error(
+            "TCPMaster::execute: pipelined requests are waiting for their reply"
+        );
+    }
+    for (size_t i = 0; i < count; ++i) {
+        validate(requests[i]);
+    }
+
+    size_t i = 0;
+    while (i < count) {
+        if (fitsInOneRequest(requests[i])) {
+            try {
+                i += executeWindow(requests + i, count - i);
+            }
+            catch(...) {
+                // Do not leave the master waiting for replies that belong
+                // to a batch the caller will not see the end of
+                clearPendingRequests();
+                throw;
+            }
+        }
+        else {
+            requests[i].result = executeAlone(requests[i]);
+            ++i;
+        }
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!requests[i].result.ok()) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+size_t TCPMaster::executeWindow(BatchRequest* requests, size_t count) {
+    // The IDs are sequential, as there are no other pending requests
+    uint16_t first_id = m_next_transaction_id;
+    size_t window = 0;
+    while (window < count && window < m_max_pending &&
+           fitsInOneRequest(requests[window])) {
+        queueBatchRequest(requests[window]);
+        ++window;
+    }
+    flushRequests();
+
+    size_t remaining = window;
+    while (remaining > 0) {
+        FrameView reply;
+        uint16_t transaction_id;
+        Result result = tryReadNextReply(reply, transaction_id);
+        if (result.code == RESULT_TIMEOUT) {
+            for (auto const& pending : m_pending) {
+                requests[static_cast<uint16_t>(pending.transaction_id - first_id)].result =
+                    result;
+            }
+            clearPendingRequests();
+            break;
+        }
+        else if (result.code == RESULT_TRANSACTION_ID_MISMATCH) {
+            continue;
+        }
+
+        BatchRequest& request = requests[static_cast<uint16_t>(transaction_id - first_id)];
+        if (result.ok()) {
+            result = common::tryParseBatchReply(request, reply);
+        }
+        request.result = result;
+        --remaining;
+    }
+    return window;
+}
+
 Frame TCPMaster::readReply(int function) {
     Frame frame;
     readReply(frame, function);
@@ -78,21 +388,21 @@ Frame TCPMaster::readReply(int function) {
 }
 
 void TCPMaster::readReply(Frame& frame, int function) {
-    readFrame(frame);
-    if (frame.function == function) {
-        return;
-    }
+    FrameView view;
+    readReply(view, function);
+    view.copyTo(frame);
+}
 
-    if (frame.function == FUNCTION_CODE_EXCEPTION + function) {
-        int exception_code = 0;
-        if (frame.payload.size()) {
-            exception_code = frame.payload[0];
-        }
-        throw RequestException(function, exception_code, "request failed");
-    }
-    else {
-        throw UnexpectedReply("received reply's function does not match request");
+void TCPMaster::readReply(FrameView& frame, int function) {
+    throwOnError(tryReadReply(frame, function));
+}
+
+Result TCPMaster::tryReadReply(FrameView& frame, int function) {
+    Result result = tryReadFrame(frame);
+    if (!result.ok()) {
+        return result;
     }
+    return common::checkReply(frame, function);
 }
 
 vector<uint16_t> TCPMaster::readRegisters(
@@ -104,17 +414,27 @@ vector<uint16_t> TCPMaster::readRegisters(
 }
 
 void TCPMaster::readRegisters(
+    uint16_t* values, int address, bool input_registers, int start, int length) {
+    throwOnError(tryReadRegisters(values, address, input_registers, start, length));
+}
+
+Result TCPMaster::tryReadRegistersBlock(
     uint16_t* values, int address, bool input_registers, int start, int length) {
     uint8_t* buffer_start = &m_write_buffer[0];
     m_transaction_id = allocateTransactionID();
     uint8_t const* buffer_end = TCP::formatReadRegisters(
         buffer_start, m_transaction_id, address, input_registers, start, length
     );
-    writePacket(buffer_start, buffer_end - buffer_start);
-    readReply(m_frame, input_registers ? FUNCTION_READ_INPUT_REGISTERS :
-                                         FUNCTION_READ_HOLDING_REGISTERS);
-
-    common::parseReadRegisters(values, m_frame, length);
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, input_registers ? FUNCTION_READ_INPUT_REGISTERS :
+                                 FUNCTION_READ_HOLDING_REGISTERS
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::tryParseReadRegisters(values, reply, length);
 }
 
 uint16_t TCPMaster::readSingleRegister(int address, bool input_registers, int register_id) {
@@ -124,37 +444,180 @@ uint16_t TCPMaster::readSingleRegister(int address, bool input_registers, int re
 }
 
 void TCPMaster::writeSingleRegister(int address, uint16_t register_id, uint16_t value) {
+    throwOnError(tryWriteSingleRegister(address, register_id, value));
+}
+
+Result TCPMaster::tryWriteSingleRegister(int address, uint16_t register_id,
+                                         uint16_t value) {
     uint8_t* buffer_start = &m_write_buffer[0];
     m_transaction_id = allocateTransactionID();
     uint8_t const* buffer_end = TCP::formatWriteRegister(
         buffer_start, m_transaction_id, address, register_id, value
     );
-    writePacket(buffer_start, buffer_end - buffer_start);
-    readReply(m_frame, FUNCTION_WRITE_SINGLE_REGISTER);
+    FrameView reply;
+    return writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_WRITE_SINGLE_REGISTER
+    );
 }
 
 void TCPMaster::writeSingleCoil(int address, uint16_t register_id, bool value) {
+    throwOnError(tryWriteSingleCoil(address, register_id, value));
+}
+
+Result TCPMaster::tryWriteSingleCoil(int address, uint16_t register_id, bool value) {
     uint8_t* buffer_start = &m_write_buffer[0];
     m_transaction_id = allocateTransactionID();
     uint8_t const* buffer_end = TCP::formatWriteSingleCoil(
         buffer_start, m_transaction_id, address, register_id, value
     );
-    writePacket(buffer_start, buffer_end - buffer_start);
-    readReply(m_frame, FUNCTION_WRITE_SINGLE_COIL);
+    FrameView reply;
+    return writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_WRITE_SINGLE_COIL
+    );
 }
 
 std::vector<bool> TCPMaster::readDigitalInputs(int address, bool coils, uint16_t register_id, uint16_t count) {
+    std::vector<uint8_t> bits((count + 7) / 8);
+    readDigitalInputs(bits.data(), address, coils, register_id, count);
+
+    std::vector<bool> values;
+    common::unpackBits(values, bits.data(), count);
+    return values;
+}
+
+void TCPMaster::readDigitalInputs(uint8_t* bits, int address, bool coils,
+                                  uint16_t register_id, uint16_t count) {
+    throwOnError(tryReadDigitalInputs(bits, address, coils, register_id, count));
+}
+
+Result TCPMaster::tryReadDigitalInputsBlock(uint8_t* bits, int address, bool coils,
+                                            uint16_t register_id, int count) {
     uint8_t* buffer_start = &m_write_buffer[0];
     m_transaction_id = allocateTransactionID();
     uint8_t const* buffer_end = TCP::formatReadDigitalInputs(
         buffer_start, m_transaction_id, address, coils, register_id, count
     );
-    writePacket(buffer_start, buffer_end - buffer_start);
-
     auto function = coils ? FUNCTION_READ_COILS : FUNCTION_READ_DIGITAL_INPUTS;
-    readReply(m_frame, function);
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, function
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::tryParseReadDigitalInputs(bits, reply, count);
+}
 
-    std::vector<bool> values;
-    common::parseReadDigitalInputs(values, m_frame, count);
-    return values;
+void TCPMaster::writeRegisters(int address, uint16_t start,
+                               uint16_t const* values, size_t count) {
+    throwOnError(tryWriteRegisters(address, start, values, count));
+}
+
+Result TCPMaster::tryWriteRegistersBlock(int address, uint16_t start,
+                                         uint16_t const* values, int count) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    m_transaction_id = allocateTransactionID();
+    uint8_t const* buffer_end = TCP::formatWriteRegisters(
+        buffer_start, m_transaction_id, address, start, values, count
+    );
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_WRITE_MULTIPLE_REGISTERS
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkWriteMultipleReply(reply, start, count);
+}
+
+void TCPMaster::writeCoils(int address, uint16_t start,
+                           uint8_t const* bits, size_t count) {
+    throwOnError(tryWriteCoils(address, start, bits, count));
+}
+
+void TCPMaster::writeCoils(int address, uint16_t start, vector<bool> const& values) {
+    vector<uint8_t> bits((values.size() + 7) / 8);
+    common::packBits(bits.data(), values, 0, values.size());
+    writeCoils(address, start, bits.data(), values.size());
+}
+
+Result TCPMaster::tryWriteCoilsBlock(int address, uint16_t start,
+                                     uint8_t const* bits, int count) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    m_transaction_id = allocateTransactionID();
+    uint8_t const* buffer_end = TCP::formatWriteCoils(
+        buffer_start, m_transaction_id, address, start, bits, count
+    );
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_WRITE_MULTIPLE_COILS
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkWriteMultipleReply(reply, start, count);
+}
+
+void TCPMaster::readWriteRegisters(
+    uint16_t* read_values, int address, uint16_t read_start, int read_count,
+    uint16_t write_start, uint16_t const* write_values, int write_count
+) {
+    throwOnError(tryReadWriteRegisters(
+        read_values, address, read_start, read_count,
+        write_start, write_values, write_count
+    ));
+}
+
+Result TCPMaster::tryReadWriteRegisters(
+    uint16_t* read_values, int address, uint16_t read_start, int read_count,
+    uint16_t write_start, uint16_t const* write_values, int write_count
+) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    m_transaction_id = allocateTransactionID();
+    uint8_t const* buffer_end = TCP::formatReadWriteRegisters(
+        buffer_start, m_transaction_id, address, read_start, read_count,
+        write_start, write_values, write_count
+    );
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_READ_WRITE_MULTIPLE_REGISTERS
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::tryParseReadRegisters(read_values, reply, read_count);
+}
+
+void TCPMaster::maskWriteRegister(int address, uint16_t register_id,
+                                 uint16_t and_mask, uint16_t or_mask) {
+    throwOnError(tryMaskWriteRegister(address, register_id, and_mask, or_mask));
+}
+
+Result TCPMaster::tryMaskWriteRegister(int address, uint16_t register_id,
+                                      uint16_t and_mask, uint16_t or_mask) {
+    uint8_t* buffer_start = &m_write_buffer[0];
+    m_transaction_id = allocateTransactionID();
+    uint8_t const* buffer_end = TCP::formatMaskWriteRegister(
+        buffer_start, m_transaction_id, address, register_id, and_mask, or_mask
+    );
+    FrameView reply;
+    Result result = writePacketAndReadReply(
+        buffer_start, buffer_end - buffer_start,
+        reply, FUNCTION_MASK_WRITE_REGISTER
+    );
+    if (!result.ok()) {
+        return result;
+    }
+    return common::checkMaskWriteReply(reply, register_id, and_mask, or_mask);
+}
+
+void TCPMaster::writeRegisterBits(int address, uint16_t register_id,
+                                 uint16_t mask, uint16_t value) {
+    throwOnError(tryWriteRegisterBits(address, register_id, mask, value));
 }
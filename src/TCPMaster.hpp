@@ -9,20 +9,84 @@
 namespace modbus {
     /**
      * Driver implementing a Modbus TCP master
+     *
+     * Besides the request-reply methods, the master has a pipelined mode in
+     * which up to getMaxPendingRequests() requests are sent with sendRequest
+     * before their replies are read with readNextReply. Replies are matched
+     * to their request by transaction ID, in the order the slave sends them.
+     * The request-reply methods must not be used while pipelined requests
+     * are pending. They throw std::logic_error if they are.
      */
     class TCPMaster : public iodrivers_base::Driver, public MasterInterface {
-        /** Modbus packet extraction is time-based
+        /** Extracts the frames that have the transaction ID of the last
+         * request or of a pending pipelined request
          *
-         * This method just throws
+         * Other well-formed frames, e.g. late replies to requests that timed
+         * out, are discarded whole. Bytes that cannot start a MBAP header are
+         * skipped up to the next possible header.
          */
         int extractPacket(uint8_t const* buffer, size_t bufferSize) const;
 
+        /** Number of frames discarded by extractPacket because of their
+         * transaction ID
+         */
+        mutable size_t m_stale_reply_count = 0;
+
+        /** Number of times extractPacket skipped bytes to find a header */
+        mutable size_t m_resync_count = 0;
+
         /** Transaction ID of the last sent request */
         uint16_t m_transaction_id = 0;
 
-        /** Allocate a new transaction ID */
+        /** Next transaction ID to allocate
+         *
+         * IDs are allocated sequentially in the whole 16 bit range, the
+         * first one being 0xAA01
+         */
+        uint16_t m_next_transaction_id = 0xAA01;
+
+        /** Allocate a new transaction ID, skipping the IDs of pending
+         * requests
+         */
         uint16_t allocateTransactionID();
 
+        /** A request sent by sendRequest whose reply has not been read */
+        struct PendingRequest {
+            uint16_t transaction_id;
+            int function;
+        };
+
+        /** Pipelined requests waiting for their reply */
+        std::vector<PendingRequest> m_pending;
+
+        /** Maximum number of pipelined requests waiting for their reply */
+        size_t m_max_pending = 1;
+
+        /** Whether a pipelined request with this ID waits for its reply */
+        bool isPending(uint16_t transaction_id) const;
+
+        /** Requests formatted by queueRequest and not yet written
+         *
+         * They are written with a single write by flushRequests
+         */
+        std::vector<uint8_t> m_send_queue;
+
+        /** Number of requests in m_send_queue */
+        size_t m_queued_count = 0;
+
+        /** Format a batch request at the end of the send queue
+         *
+         * The request must fit in a single Modbus request
+         */
+        void queueBatchRequest(BatchRequest const& request);
+
+        /** Queue consecutive batch requests, flush them, and wait for
+         * their replies
+         *
+         * @return the number of requests that were sent, at least one
+         */
+        size_t executeWindow(BatchRequest* requests, size_t count);
+
         /** Internal read buffer */
         std::vector<uint8_t> m_read_buffer;
 
@@ -35,11 +99,77 @@ namespace modbus {
          */
         Frame m_frame;
 
-        static const int FUNCTION_CODE_EXCEPTION = 0x80;
+        /** Throws the exception that corresponds to a non-OK result */
+        static void throwOnError(Result const& result);
+
+        /** Read a frame, waiting at most the given time */
+        Result tryReadFrame(FrameView& frame, base::Time const& timeout);
+
+        /** Send a request and read its reply
+         *
+         * The time allowed for the reply is adaptive if adaptive timeouts
+         * are enabled
+         */
+        Result writePacketAndReadReply(
+            uint8_t const* buffer, int bufsize,
+            FrameView& frame, int function
+        );
+
+        /** Read a set of registers in a single request */
+        Result tryReadRegistersBlock(
+            uint16_t* values,
+            int address, bool input_registers, int start, int length
+        );
+
+        /** Read a set of coils or digital inputs in a single request */
+        Result tryReadDigitalInputsBlock(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, int count
+        );
+
+        /** Write a set of registers in a single request */
+        Result tryWriteRegistersBlock(
+            int address, uint16_t start, uint16_t const* values, int count
+        );
+
+        /** Write a set of coils in a single request */
+        Result tryWriteCoilsBlock(
+            int address, uint16_t start, uint8_t const* bits, int count
+        );
 
     public:
         TCPMaster(uint16_t max_payload_size);
 
+        using MasterInterface::readFrame;
+        using MasterInterface::readReply;
+
+        Result tryReadFrame(FrameView& frame);
+        Result tryReadReply(FrameView& frame, int function);
+        Result tryWriteSingleRegister(int address, uint16_t register_id, uint16_t value);
+        Result tryWriteSingleCoil(int address, uint16_t register_id, bool value);
+        Result tryMaskWriteRegister(
+            int address, uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        );
+        Result tryReadWriteRegisters(
+            uint16_t* read_values, int address, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        );
+
+        /** Run a batch of requests, pipelining them
+         *
+         * Up to getMaxPendingRequests() consecutive requests are sent with a
+         * single write, and their replies are matched by transaction ID,
+         * whatever their order. With the default of 1, the requests run one
+         * after the other. Requests that do not fit in a single Modbus request
+         * are split as the corresponding methods do.
+         *
+         * On timeout, the requests of the window whose reply is missing fail
+         * with RESULT_TIMEOUT, and the batch goes on with the next window.
+         *
+         * @throw std::logic_error if pipelined requests sent by sendRequest
+         *   are waiting for their reply
+         */
+        size_t execute(BatchRequest* requests, size_t count);
+
         /** Wait for one frame on the bus and read it
          */
         Frame readFrame();
@@ -48,6 +178,13 @@ namespace modbus {
          */
         void readFrame(Frame& frame);
 
+        /** Wait for one frame on the bus and return a view on it
+         *
+         * The view points into the master's internal buffer, and is valid
+         * only until the next read
+         */
+        void readFrame(FrameView& frame);
+
         /** Wait for the reply for the given request
          */
         Frame readReply(int function);
@@ -56,11 +193,115 @@ namespace modbus {
          */
         void readReply(Frame& frame, int function);
 
+        /** Wait for the reply for the given request and return a view on it
+         *
+         * The view points into the master's internal buffer, and is valid
+         * only until the next read
+         */
+        void readReply(FrameView& frame, int function);
+
         /** Send a request and wait for the slave's reply */
         Frame const& request(
             int address, int function, std::vector<uint8_t> const& payload
         );
 
+        /** Number of replies that were discarded because they did not match
+         * the last request nor a pending one
+         *
+         * These are most often late replies to requests that timed out
+         */
+        size_t getStaleReplyCount() const;
+
+        /** Number of times bytes that are not part of a frame were skipped
+         * to find the next frame
+         */
+        size_t getResyncCount() const;
+
+        /** Reset the stale reply and resync counters */
+        void resetSynchronizationCounters();
+
+        /** Set how many pipelined requests may wait for their reply
+         *
+         * The default is 1. Not all slaves and gateways process more than one
+         * request at a time, check before raising it.
+         */
+        void setMaxPendingRequests(size_t count);
+
+        /** @see setMaxPendingRequests */
+        size_t getMaxPendingRequests() const;
+
+        /** Number of pipelined requests waiting for their reply */
+        size_t getPendingRequestCount() const;
+
+        /** Forget about the pending pipelined requests
+         *
+         * Use this after a timeout, to give up on the missing replies. Replies
+         * that arrive later are discarded. Queued requests that were not
+         * flushed yet are dropped.
+         */
+        void clearPendingRequests();
+
+        /** Send a request without waiting for its reply
+         *
+         * This is queueRequest followed by flushRequests
+         *
+         * @return the request's transaction ID, to match it with the reply
+         *   returned by readNextReply
+         * @throw std::logic_error if getMaxPendingRequests() requests are
+         *   already waiting for their reply
+         */
+        uint16_t sendRequest(
+            int address, int function, std::vector<uint8_t> const& payload
+        );
+
+        /** Queue a pipelined request, to be sent by the next flushRequests
+         *
+         * Queuing several requests and flushing them costs a single write,
+         * and lets the kernel send them in as few segments as possible. The
+         * request counts as pending from the moment it is queued.
+         *
+         * @return the request's transaction ID, to match it with the reply
+         *   returned by readNextReply
+         * @throw std::logic_error if getMaxPendingRequests() requests are
+         *   already waiting for their reply
+         */
+        uint16_t queueRequest(
+            int address, int function, std::vector<uint8_t> const& payload
+        );
+
+        /** Send the queued requests with a single write
+         *
+         * readNextReply calls it, so that a reply is never waited for while
+         * its request is still queued
+         */
+        void flushRequests();
+
+        /** Number of requests queued by queueRequest and not flushed yet */
+        size_t getQueuedRequestCount() const;
+
+        /** Non-throwing version of readNextReply
+         *
+         * @param transaction_id set to the ID of the request the reply
+         *   belongs to, unless the result is a timeout
+         */
+        Result tryReadNextReply(FrameView& frame, uint16_t& transaction_id);
+
+        /** Wait for the reply of any of the pending pipelined requests
+         *
+         * The request is not pending anymore once its reply has been read,
+         * even if the reply is an exception.
+         *
+         * The view points into the master's internal buffer, and is valid
+         * only until the next read
+         *
+         * @return the transaction ID of the request the reply belongs to
+         * @throw std::logic_error if there are no pending requests
+         */
+        uint16_t readNextReply(FrameView& frame);
+
+        /** @overload */
+        uint16_t readNextReply(Frame& frame);
+
         /** Read a set of registers */
         std::vector<uint16_t> readRegisters(
             int address, bool input_registers, int start, int length
@@ -78,7 +319,60 @@ namespace modbus {
 
         void writeSingleCoil(int address, uint16_t register_id, bool value);
 
+        /** Write a set of contiguous registers
+         *
+         * Writes of more than common::WRITE_REGISTERS_MAX_COUNT registers are
+         * split into multiple requests
+         */
+        void writeRegisters(
+            int address, uint16_t start, uint16_t const* values, size_t count
+        );
+
+        /** Write a set of contiguous coils given as packed bits
+         *
+         * Writes of more than common::WRITE_COILS_MAX_COUNT coils are split
+         * into multiple requests
+         */
+        void writeCoils(
+            int address, uint16_t start, uint8_t const* bits, size_t count
+        );
+
+        /** Write a set of contiguous coils */
+        void writeCoils(int address, uint16_t start, std::vector<bool> const& values);
+
+        /** Modify a holding register through an AND and an OR mask */
+        void maskWriteRegister(
+            int address, uint16_t register_id, uint16_t and_mask, uint16_t or_mask
+        );
+
+        /** Change some bits of a holding register
+         *
+         * @see MasterInterface::writeRegisterBits
+         */
+        void writeRegisterBits(
+            int address, uint16_t register_id, uint16_t mask, uint16_t value
+        );
+
+        /** Write a set of holding registers and read another in a single
+         * transaction
+         */
+        void readWriteRegisters(
+            uint16_t* read_values, int address, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        );
+
         std::vector<bool> readDigitalInputs(int address, bool coils, uint16_t register_id, uint16_t count);
+
+        /** Read coils or digital inputs into a packed bit buffer
+         *
+         * The input i is stored in bit i % 8 of byte i / 8, which is how they
+         * are sent on the wire.
+         *
+         * @param bits output buffer of at least (count + 7) / 8 bytes
+         */
+        void readDigitalInputs(
+            uint8_t* bits, int address, bool coils, uint16_t register_id, uint16_t count
+        );
     };
 }
 
@@ -0,0 +1,470 @@
+#include <modbus/TCPReactor.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <iodrivers_base/Exceptions.hpp>
+#include <modbus/common.hpp>
+#include <modbus/TCP.hpp>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+/** epoll tag of the event file descriptor used to wake up the reactor */
+static const uint64_t EVENT_FD_TAG = ~static_cast<uint64_t>(0);
+
+/** Number of slots of the timer wheel */
+static const size_t TIMER_SLOTS = 512;
+
+TCPReactor::TCPReactor(Time const& resolution)
+    : m_timers(resolution, TIMER_SLOTS)
+    , m_quit(false) {
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd == -1) {
+        throw iodrivers_base::UnixError("TCPReactor: failed to create the epoll instance");
+    }
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_event_fd == -1) {
+        ::close(m_epoll_fd);
+        throw iodrivers_base::UnixError("TCPReactor: failed to create the event fd");
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = EVENT_FD_TAG;
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_event_fd, &event);
+}
+
+TCPReactor::~TCPReactor() {
+    stop();
+    for (size_t i = 0; i < m_connections.size(); ++i) {
+        close(i);
+    }
+    ::close(m_event_fd);
+    ::close(m_epoll_fd);
+}
+
+int TCPReactor::addConnection(string const& host, int port) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* info;
+    string service = to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &info) != 0) {
+        throw invalid_argument("TCPReactor: cannot resolve " + host);
+    }
+
+    Connection connection;
+    memcpy(&connection.address, info->ai_addr, sizeof(connection.address));
+    freeaddrinfo(info);
+    m_connections.push_back(move(connection));
+    return m_connections.size() - 1;
+}
+
+size_t TCPReactor::getConnectionCount() const {
+    return m_connections.size();
+}
+
+void TCPReactor::setTimeout(Time const& timeout) {
+    m_timeout = timeout;
+}
+
+void TCPReactor::request(int connection, int address, int function,
+                         vector<uint8_t> const& payload, Callback const& callback) {
+    if (connection < 0 || static_cast<size_t>(connection) >= m_connections.size()) {
+        throw invalid_argument("TCPReactor::request: invalid connection index");
+    }
+    if (payload.size() >
+        static_cast<size_t>(TCP::FRAME_MAX_SIZE - TCP::FRAME_OVERHEAD_SIZE)) {
+        throw invalid_argument("TCPReactor::request: payload too large");
+    }
+
+    Request request = { connection, address, function, payload, callback };
+    m_submissions.push(move(request));
+    wakeUp();
+}
+
+void TCPReactor::readRegisters(int connection, int address, bool input_registers,
+                               int start, int length,
+                               ReadRegistersCallback const& callback) {
+    // Validate and encode the request the same way as the masters
+    uint8_t buffer[TCP::FRAME_OVERHEAD_SIZE + 4];
+    TCP::formatReadRegisters(buffer, 0, address, input_registers, start, length);
+
+    int function = input_registers ? FUNCTION_READ_INPUT_REGISTERS :
+                                     FUNCTION_READ_HOLDING_REGISTERS;
+    vector<uint8_t> payload(buffer + TCP::FRAME_OVERHEAD_SIZE, buffer + sizeof(buffer));
+    request(connection, address, function, payload,
+        [callback, length](Result const& result, FrameView const& frame) {
+            if (!result.ok()) {
+                callback(result, nullptr);
+                return;
+            }
+
+            uint16_t values[common::READ_REGISTERS_MAX_COUNT];
+            Result parse = common::tryParseReadRegisters(values, frame, length);
+            callback(parse, values);
+        }
+    );
+}
+
+void TCPReactor::writeSingleRegister(int connection, int address,
+                                     uint16_t register_id, uint16_t value,
+                                     WriteCallback const& callback) {
+    uint8_t buffer[TCP::FRAME_OVERHEAD_SIZE + 4];
+    TCP::formatWriteRegister(buffer, 0, address, register_id, value);
+
+    vector<uint8_t> payload(buffer + TCP::FRAME_OVERHEAD_SIZE, buffer + sizeof(buffer));
+    request(connection, address, FUNCTION_WRITE_SINGLE_REGISTER, payload,
+        [callback](Result const& result, FrameView const&) {
+            callback(result);
+        }
+    );
+}
+
+void TCPReactor::wakeUp() {
+    uint64_t one = 1;
+    ssize_t ret = write(m_event_fd, &one, sizeof(one));
+    (void)ret;
+}
+
+void TCPReactor::start() {
+    if (m_thread.joinable()) {
+        return;
+    }
+    m_quit = false;
+    m_thread = thread([this]() {
+        while (!m_quit) {
+            poll(Time::fromMilliseconds(100));
+        }
+    });
+}
+
+void TCPReactor::stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_quit = true;
+    wakeUp();
+    m_thread.join();
+}
+
+void TCPReactor::poll(Time const& timeout) {
+    processSubmissions();
+
+    Time wait = timeout;
+    if (!m_timers.empty()) {
+        wait = min(wait, m_timers.getNextTick() - Time::now());
+    }
+    int wait_ms = max<int64_t>(0, (wait.toMicroseconds() + 999) / 1000);
+
+    epoll_event events[64];
+    int count = epoll_wait(m_epoll_fd, events, 64, wait_ms);
+    if (count < 0 && errno != EINTR) {
+        throw iodrivers_base::UnixError("TCPReactor: epoll_wait failed");
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (events[i].data.u64 == EVENT_FD_TAG) {
+            uint64_t value;
+            ssize_t ret = read(m_event_fd, &value, sizeof(value));
+            (void)ret;
+            processSubmissions();
+        }
+        else {
+            processEvents(events[i].data.u64, events[i].events);
+        }
+    }
+    processTimers();
+}
+
+void TCPReactor::processSubmissions() {
+    Request request;
+    while (m_submissions.pop(request)) {
+        int index = request.connection;
+        m_connections[index].queue.push_back(move(request));
+        sendNext(index);
+    }
+}
+
+void TCPReactor::processTimers() {
+    m_expired.clear();
+    m_timers.advance(Time::now(), m_expired);
+    for (uint64_t id : m_expired) {
+        int index = id >> 32;
+        Connection& c = m_connections[index];
+        if (c.generation != static_cast<uint32_t>(id)) {
+            continue;
+        }
+
+        m_timeout_count++;
+        if (c.state == Connection::CONNECTING) {
+            fail(index, Result(RESULT_TIMEOUT, "TCPReactor: timed out while connecting"));
+        }
+        else if (c.tx_offset != c.tx.size()) {
+            // The device does not even read. Give up on the connection, a
+            // partially sent frame would corrupt the next one
+            fail(index, Result(RESULT_TIMEOUT, "TCPReactor: timed out while sending"));
+        }
+        else if (c.busy) {
+            complete(index, Result(RESULT_TIMEOUT, "TCPReactor: timed out waiting for a reply"),
+                     FrameView());
+        }
+    }
+}
+
+void TCPReactor::armTimer(int index) {
+    uint64_t id = static_cast<uint64_t>(index) << 32 | m_connections[index].generation;
+    m_timers.schedule(Time::now() + m_timeout, id);
+}
+
+void TCPReactor::connect(int index) {
+    Connection& c = m_connections[index];
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd == -1) {
+        fail(index, Result(RESULT_IO_ERROR, "TCPReactor: failed to create socket"));
+        return;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int ret = ::connect(c.fd, reinterpret_cast<sockaddr const*>(&c.address),
+                        sizeof(c.address));
+    if (ret == -1 && errno != EINPROGRESS) {
+        fail(index, Result(RESULT_IO_ERROR, "TCPReactor: failed to connect"));
+        return;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u64 = index;
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, c.fd, &event);
+
+    if (ret == 0) {
+        c.state = Connection::CONNECTED;
+        sendNext(index);
+    }
+    else {
+        c.state = Connection::CONNECTING;
+        armTimer(index);
+    }
+}
+
+void TCPReactor::sendNext(int index) {
+    Connection& c = m_connections[index];
+    if (c.busy || c.queue.empty()) {
+        return;
+    }
+    else if (c.state == Connection::DISCONNECTED) {
+        connect(index);
+        return;
+    }
+    else if (c.state == Connection::CONNECTING) {
+        return;
+    }
+
+    Request const& request = c.queue.front();
+    c.transaction_id = c.next_transaction_id++;
+    c.tx.resize(TCP::FRAME_OVERHEAD_SIZE + request.payload.size());
+    TCP::formatFrame(c.tx.data(), c.transaction_id, request.address,
+                     request.function, request.payload);
+    c.tx_offset = 0;
+    c.busy = true;
+    armTimer(index);
+
+    if (flush(index)) {
+        updateEvents(index);
+    }
+}
+
+bool TCPReactor::flush(int index) {
+    Connection& c = m_connections[index];
+    while (c.tx_offset < c.tx.size()) {
+        ssize_t ret = send(c.fd, c.tx.data() + c.tx_offset, c.tx.size() - c.tx_offset,
+                           MSG_NOSIGNAL);
+        if (ret >= 0) {
+            c.tx_offset += ret;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        else if (errno != EINTR) {
+            fail(index, Result(RESULT_IO_ERROR, "TCPReactor: failed to send"));
+            return false;
+        }
+    }
+    return true;
+}
+
+void TCPReactor::updateEvents(int index) {
+    Connection& c = m_connections[index];
+    epoll_event event;
+    event.events = EPOLLIN;
+    if (c.tx_offset < c.tx.size()) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.u64 = index;
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, c.fd, &event);
+}
+
+void TCPReactor::processEvents(int index, uint32_t events) {
+    Connection& c = m_connections[index];
+    if (c.fd == -1) {
+        return;
+    }
+
+    if (c.state == Connection::CONNECTING) {
+        int error = 0;
+        socklen_t size = sizeof(error);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &error, &size);
+        if (error != 0) {
+            fail(index, Result(RESULT_IO_ERROR, "TCPReactor: failed to connect"));
+            return;
+        }
+        else if (!(events & EPOLLOUT)) {
+            return;
+        }
+
+        c.state = Connection::CONNECTED;
+        c.generation++;
+        updateEvents(index);
+        sendNext(index);
+        return;
+    }
+
+    if (events & EPOLLOUT) {
+        if (!flush(index)) {
+            return;
+        }
+        updateEvents(index);
+    }
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        receive(index);
+    }
+}
+
+void TCPReactor::receive(int index) {
+    Connection& c = m_connections[index];
+    while (true) {
+        uint8_t buffer[4096];
+        ssize_t ret = recv(c.fd, buffer, sizeof(buffer), 0);
+        if (ret > 0) {
+            c.rx.insert(c.rx.end(), buffer, buffer + ret);
+        }
+        else if (ret == 0) {
+            fail(index, Result(RESULT_IO_ERROR, "TCPReactor: connection closed by the device"));
+            return;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        else if (errno != EINTR) {
+            fail(index, Result(RESULT_IO_ERROR, "TCPReactor: failed to receive"));
+            return;
+        }
+    }
+
+    size_t offset = 0;
+    while (c.rx.size() - offset >= static_cast<size_t>(TCP::FRAME_OVERHEAD_SIZE)) {
+        uint8_t const* frame_start = c.rx.data() + offset;
+        size_t length = TCP::frameLength(frame_start);
+        if (frame_start[2] != 0 || frame_start[3] != 0 ||
+            length < static_cast<size_t>(TCP::FRAME_OVERHEAD_SIZE) ||
+            length > static_cast<size_t>(TCP::FRAME_MAX_SIZE)) {
+            // The stream is not aligned on frames anymore. Reconnecting is
+            // the only way to get in sync again
+            fail(index, Result(RESULT_IO_ERROR, "TCPReactor: invalid frame header"));
+            return;
+        }
+        else if (c.rx.size() - offset < length) {
+            break;
+        }
+
+        uint16_t transaction_id = static_cast<uint16_t>(frame_start[0]) << 8 | frame_start[1];
+        offset += length;
+        if (!c.busy || transaction_id != c.transaction_id) {
+            m_stale_reply_count++;
+            continue;
+        }
+
+        FrameView frame;
+        Result result = TCP::tryParseFrame(frame, transaction_id,
+                                           frame_start, frame_start + length);
+        if (result.ok()) {
+            result = common::checkReply(frame, c.queue.front().function);
+        }
+        complete(index, result, frame);
+        if (c.fd == -1) {
+            // Sending the next request failed
+            return;
+        }
+    }
+    c.rx.erase(c.rx.begin(), c.rx.begin() + offset);
+}
+
+void TCPReactor::complete(int index, Result const& result, FrameView const& frame) {
+    Connection& c = m_connections[index];
+    Request request = move(c.queue.front());
+    c.queue.pop_front();
+    c.busy = false;
+    c.generation++;
+
+    m_transaction_count++;
+    request.callback(result, frame);
+    sendNext(index);
+}
+
+void TCPReactor::fail(int index, Result const& result) {
+    if (result.code == RESULT_IO_ERROR) {
+        m_io_error_count++;
+    }
+
+    Connection& c = m_connections[index];
+    close(index);
+    deque<Request> requests;
+    swap(requests, c.queue);
+    for (auto const& request : requests) {
+        m_transaction_count++;
+        request.callback(result, FrameView());
+    }
+}
+
+void TCPReactor::close(int index) {
+    Connection& c = m_connections[index];
+    if (c.fd != -1) {
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        c.fd = -1;
+    }
+    c.state = Connection::DISCONNECTED;
+    c.busy = false;
+    c.generation++;
+    c.tx.clear();
+    c.tx_offset = 0;
+    c.rx.clear();
+}
+
+size_t TCPReactor::getTransactionCount() const {
+    return m_transaction_count;
+}
+
+size_t TCPReactor::getTimeoutCount() const {
+    return m_timeout_count;
+}
+
+size_t TCPReactor::getIOErrorCount() const {
+    return m_io_error_count;
+}
+
+size_t TCPReactor::getStaleReplyCount() const {
+    return m_stale_reply_count;
+}
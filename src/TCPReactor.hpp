@@ -0,0 +1,215 @@
+#ifndef MODBUS_TCPREACTOR_HPP
+#define MODBUS_TCPREACTOR_HPP
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <base/Time.hpp>
+#include <modbus/Frame.hpp>
+#include <modbus/MPSCQueue.hpp>
+#include <modbus/Result.hpp>
+#include <modbus/TimerWheel.hpp>
+
+namespace modbus {
+    /** Asynchronous Modbus TCP master for many devices
+     *
+     * A single thread drives all the connections through epoll, with
+     * non-blocking sockets. Each connection has one request on the wire at a
+     * time and queues the others, as most devices process requests one at a
+     * time. Timeouts are handled by a TimerWheel.
+     *
+     * Requests may be queued from any thread. Callbacks are called from the
+     * reactor thread, and must not block. They may queue new requests.
+     *
+     * Connections are opened on their first request and after an error.
+     * I/O errors and closed connections fail the request on the wire and all
+     * the queued requests with RESULT_IO_ERROR. A request that times out
+     * fails with RESULT_TIMEOUT but keeps the connection. Its late reply is
+     * recognized by its transaction ID and discarded.
+     */
+    class TCPReactor {
+    public:
+        /** Callback called with the result of a request
+         *
+         * The frame is valid only on success, and only during the call
+         */
+        typedef std::function<void (Result const&, FrameView const&)> Callback;
+
+        /** Callback called with the result of a register read
+         *
+         * The values are valid only on success, and only during the call
+         */
+        typedef std::function<void (Result const&, uint16_t const*)> ReadRegistersCallback;
+
+        /** Callback called with the result of a request that returns no data */
+        typedef std::function<void (Result const&)> WriteCallback;
+
+    private:
+        struct Request {
+            int connection;
+            int address;
+            int function;
+            std::vector<uint8_t> payload;
+            Callback callback;
+        };
+
+        struct Connection {
+            enum State {
+                DISCONNECTED,
+                CONNECTING,
+                CONNECTED
+            };
+
+            sockaddr_in address;
+            int fd = -1;
+            State state = DISCONNECTED;
+
+            std::deque<Request> queue;
+
+            /** Whether the front of the queue is on the wire */
+            bool busy = false;
+            uint16_t transaction_id = 0;
+            uint16_t next_transaction_id = 0xAA01;
+
+            /** Incremented each time a request completes or a connection
+             * attempt ends, to invalidate the timers that were armed for it
+             */
+            uint32_t generation = 0;
+
+            std::vector<uint8_t> tx;
+            size_t tx_offset = 0;
+            std::vector<uint8_t> rx;
+        };
+
+        int m_epoll_fd = -1;
+        int m_event_fd = -1;
+
+        /** A deque, as callbacks may add connections while the reactor
+         * holds references to others
+         */
+        std::deque<Connection> m_connections;
+        base::Time m_timeout = base::Time::fromSeconds(1);
+        TimerWheel m_timers;
+        std::vector<uint64_t> m_expired;
+
+        MPSCQueue<Request> m_submissions;
+
+        std::thread m_thread;
+        std::atomic<bool> m_quit;
+
+        std::atomic<size_t> m_transaction_count{0};
+        std::atomic<size_t> m_timeout_count{0};
+        std::atomic<size_t> m_io_error_count{0};
+        std::atomic<size_t> m_stale_reply_count{0};
+
+        void wakeUp();
+        void processSubmissions();
+        void processTimers();
+        void processEvents(int index, uint32_t events);
+
+        void connect(int index);
+        void sendNext(int index);
+        bool flush(int index);
+        void receive(int index);
+        void updateEvents(int index);
+        void armTimer(int index);
+
+        void complete(int index, Result const& result, FrameView const& frame);
+        void fail(int index, Result const& result);
+        void close(int index);
+
+    public:
+        /**
+         * @param resolution resolution of the timeouts
+         */
+        explicit TCPReactor(
+            base::Time const& resolution = base::Time::fromMilliseconds(10)
+        );
+
+        /** Stops the reactor thread and closes all connections
+         *
+         * Pending requests are dropped without their callbacks being called
+         */
+        ~TCPReactor();
+
+        TCPReactor(TCPReactor const&) = delete;
+        TCPReactor& operator=(TCPReactor const&) = delete;
+
+        /** Declare a device
+         *
+         * This must be called before start(), or from the reactor thread.
+         * The connection is opened on the first request.
+         *
+         * @param host IPv4 address or host name
+         * @return the connection index, to pass to the request methods
+         */
+        int addConnection(std::string const& host, int port);
+
+        /** Number of declared connections */
+        size_t getConnectionCount() const;
+
+        /** Set the time allowed to connect and to receive a reply
+         *
+         * This must be called before start(), or from the reactor thread.
+         */
+        void setTimeout(base::Time const& timeout);
+
+        /** Queue a request with the given function and payload
+         *
+         * This may be called from any thread
+         */
+        void request(int connection, int address, int function,
+                     std::vector<uint8_t> const& payload, Callback const& callback);
+
+        /** Queue a read of registers
+         *
+         * This may be called from any thread
+         */
+        void readRegisters(int connection, int address, bool input_registers,
+                           int start, int length,
+                           ReadRegistersCallback const& callback);
+
+        /** Queue a write of a single register
+         *
+         * This may be called from any thread
+         */
+        void writeSingleRegister(int connection, int address,
+                                 uint16_t register_id, uint16_t value,
+                                 WriteCallback const& callback);
+
+        /** Process the submitted requests, the socket events and the timeouts
+         *
+         * This is the body of the reactor thread, for callers that want to
+         * drive the reactor from their own loop instead of calling start()
+         *
+         * @param timeout maximum time to wait for an event
+         */
+        void poll(base::Time const& timeout);
+
+        /** Start the reactor thread */
+        void start();
+
+        /** Stop the reactor thread */
+        void stop();
+
+        /** Number of completed transactions, successful or not */
+        size_t getTransactionCount() const;
+
+        /** Number of requests that timed out */
+        size_t getTimeoutCount() const;
+
+        /** Number of connections that failed or were closed by the device */
+        size_t getIOErrorCount() const;
+
+        /** Number of replies discarded because they arrived after their
+         * request timed out
+         */
+        size_t getStaleReplyCount() const;
+    };
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include <modbus/TimeoutEstimator.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+static uint16_t key(int address, int function) {
+    return (address & 0xff) << 8 | (function & 0xff);
+}
+
+TimeoutEstimator::TimeoutEstimator(Time const& floor, Time const& ceiling,
+                                   Time const& margin)
+    : m_margin(margin) {
+    setBounds(floor, ceiling);
+}
+
+void TimeoutEstimator::setBounds(Time const& floor, Time const& ceiling) {
+    if (floor > ceiling) {
+        throw std::invalid_argument(
+            "TimeoutEstimator::setBounds: floor greater than the ceiling"
+        );
+    }
+    m_floor = floor;
+    m_ceiling = ceiling;
+}
+
+Time TimeoutEstimator::getFloor() const {
+    return m_floor;
+}
+
+Time TimeoutEstimator::getCeiling() const {
+    return m_ceiling;
+}
+
+void TimeoutEstimator::setMargin(Time const& margin) {
+    m_margin = margin;
+}
+
+Time TimeoutEstimator::getMargin() const {
+    return m_margin;
+}
+
+void TimeoutEstimator::setQuantile(double quantile) {
+    if (quantile <= 0 || quantile > 1) {
+        throw std::invalid_argument(
+            "TimeoutEstimator::setQuantile: quantile must be in ]0, 1]"
+        );
+    }
+    m_quantile = quantile;
+}
+
+double TimeoutEstimator::getQuantile() const {
+    return m_quantile;
+}
+
+void TimeoutEstimator::setGain(double gain) {
+    if (gain <= 0 || gain > 1) {
+        throw std::invalid_argument(
+            "TimeoutEstimator::setGain: gain must be in ]0, 1]"
+        );
+    }
+    m_gain = gain;
+}
+
+double TimeoutEstimator::getGain() const {
+    return m_gain;
+}
+
+TimeoutEstimator::Statistics const* TimeoutEstimator::find(
+    int address, int function
+) const {
+    auto it = m_statistics.find(key(address, function));
+    if (it == m_statistics.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+int64_t TimeoutEstimator::quantile(Statistics const& statistics) const {
+    size_t count = min<size_t>(statistics.sample_count, WINDOW_SIZE);
+    int64_t sorted[WINDOW_SIZE];
+    copy(statistics.window_us, statistics.window_us + count, sorted);
+
+    size_t index = static_cast<size_t>(ceil(m_quantile * count)) - 1;
+    nth_element(sorted, sorted + index, sorted + count);
+    return sorted[index];
+}
+
+void TimeoutEstimator::addTurnaround(int address, int function, Time const& turnaround) {
+    Statistics& statistics = m_statistics[key(address, function)];
+    int64_t turnaround_us = turnaround.toMicroseconds();
+    if (statistics.sample_count == 0) {
+        statistics.average_us = turnaround_us;
+    }
+    else {
+        statistics.average_us +=
+            llround(m_gain * (turnaround_us - statistics.average_us));
+    }
+    statistics.window_us[statistics.sample_count % WINDOW_SIZE] = turnaround_us;
+    statistics.sample_count++;
+    statistics.consecutive_timeouts = 0;
+}
+
+void TimeoutEstimator::addTimeout(int address, int function) {
+    m_statistics[key(address, function)].consecutive_timeouts++;
+}
+
+Time TimeoutEstimator::getTimeout(int address, int function) const {
+    Statistics const* statistics = find(address, function);
+    if (!statistics || statistics->sample_count < MIN_SAMPLES) {
+        return m_ceiling;
+    }
+
+    int64_t estimate_us = max(statistics->average_us, quantile(*statistics));
+    Time timeout = max(Time::fromMicroseconds(estimate_us) + m_margin, m_floor);
+    for (int i = 0; i < statistics->consecutive_timeouts && timeout < m_ceiling; ++i) {
+        timeout = timeout * 2;
+    }
+    return min(timeout, m_ceiling);
+}
+
+Time TimeoutEstimator::getAverageTurnaround(int address, int function) const {
+    Statistics const* statistics = find(address, function);
+    if (!statistics) {
+        return Time();
+    }
+    return Time::fromMicroseconds(statistics->average_us);
+}
+
+Time TimeoutEstimator::getTurnaroundQuantile(int address, int function) const {
+    Statistics const* statistics = find(address, function);
+    if (!statistics || statistics->sample_count == 0) {
+        return Time();
+    }
+    return Time::fromMicroseconds(quantile(*statistics));
+}
+
+size_t TimeoutEstimator::getSampleCount(int address, int function) const {
+    Statistics const* statistics = find(address, function);
+    if (!statistics) {
+        return 0;
+    }
+    return statistics->sample_count;
+}
+
+void TimeoutEstimator::clear() {
+    m_statistics.clear();
+}
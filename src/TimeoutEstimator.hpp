@@ -0,0 +1,126 @@
+#ifndef MODBUS_TIMEOUTESTIMATOR_HPP
+#define MODBUS_TIMEOUTESTIMATOR_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <base/Time.hpp>
+
+namespace modbus {
+    /** Learns the turnaround time of each slave and function, and derives
+     * reply timeouts from it
+     *
+     * For each slave and function, the estimator keeps an exponentially
+     * weighted moving average of the turnaround, and a high quantile of the
+     * last WINDOW_SIZE turnarounds. The timeout is the largest of the two,
+     * plus a margin, bounded by a floor and a ceiling.
+     *
+     * Until MIN_SAMPLES turnarounds have been measured, the timeout is the
+     * ceiling. Each consecutive timeout doubles the timeout, within the same
+     * bounds, so that a slave that became slower gets time to answer again.
+     */
+    class TimeoutEstimator {
+    public:
+        /** Number of turnarounds the quantile is computed on */
+        static const int WINDOW_SIZE = 32;
+
+        /** Number of turnarounds needed before the timeout is estimated */
+        static const int MIN_SAMPLES = 8;
+
+    private:
+        struct Statistics {
+            int64_t average_us = 0;
+            int64_t window_us[WINDOW_SIZE];
+            size_t sample_count = 0;
+            int consecutive_timeouts = 0;
+        };
+
+        std::unordered_map<uint16_t, Statistics> m_statistics;
+
+        base::Time m_floor;
+        base::Time m_ceiling;
+        base::Time m_margin;
+        double m_quantile = 0.95;
+        double m_gain = 0.125;
+
+        Statistics const* find(int address, int function) const;
+        int64_t quantile(Statistics const& statistics) const;
+
+    public:
+        /**
+         * @param floor the minimum timeout
+         * @param ceiling the maximum timeout, and the timeout until enough
+         *   turnarounds have been measured. This is usually the master's
+         *   read timeout
+         * @param margin the time added to the estimated turnaround
+         */
+        explicit TimeoutEstimator(
+            base::Time const& floor = base::Time::fromMilliseconds(5),
+            base::Time const& ceiling = base::Time::fromSeconds(1),
+            base::Time const& margin = base::Time::fromMilliseconds(5)
+        );
+
+        /** Set the bounds of the timeout
+         *
+         * @throw std::invalid_argument if the floor is greater than the
+         *   ceiling
+         */
+        void setBounds(base::Time const& floor, base::Time const& ceiling);
+
+        /** @see setBounds */
+        base::Time getFloor() const;
+
+        /** @see setBounds */
+        base::Time getCeiling() const;
+
+        /** Set the time added to the estimated turnaround */
+        void setMargin(base::Time const& margin);
+
+        /** @see setMargin */
+        base::Time getMargin() const;
+
+        /** Set the quantile of the turnarounds the timeout is based on
+         *
+         * The default is 0.95
+         *
+         * @throw std::invalid_argument if the quantile is not in ]0, 1]
+         */
+        void setQuantile(double quantile);
+
+        /** @see setQuantile */
+        double getQuantile() const;
+
+        /** Set the weight of a new turnaround in the moving average
+         *
+         * The default is 0.125
+         *
+         * @throw std::invalid_argument if the gain is not in ]0, 1]
+         */
+        void setGain(double gain);
+
+        /** @see setGain */
+        double getGain() const;
+
+        /** Record the turnaround of a transaction */
+        void addTurnaround(int address, int function, base::Time const& turnaround);
+
+        /** Record that a transaction timed out */
+        void addTimeout(int address, int function);
+
+        /** The timeout to use for the next transaction */
+        base::Time getTimeout(int address, int function) const;
+
+        /** Moving average of the turnaround */
+        base::Time getAverageTurnaround(int address, int function) const;
+
+        /** Quantile of the last turnarounds, as set by setQuantile */
+        base::Time getTurnaroundQuantile(int address, int function) const;
+
+        /** Number of turnarounds measured so far */
+        size_t getSampleCount(int address, int function) const;
+
+        /** Forget all the statistics */
+        void clear();
+    };
+}
+
+#endif
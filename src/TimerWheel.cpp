@@ -0,0 +1,80 @@
+#include <modbus/TimerWheel.hpp>
+
+#include <stdexcept>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+TimerWheel::TimerWheel(Time const& resolution, size_t slots, Time const& origin)
+    : m_resolution(resolution)
+    , m_origin(origin) {
+    if (resolution <= Time() || slots == 0) {
+        throw invalid_argument(
+            "TimerWheel: resolution and number of slots must be strictly positive"
+        );
+    }
+    m_slots.resize(slots);
+}
+
+uint64_t TimerWheel::tickAt(Time const& time) const {
+    if (time <= m_origin) {
+        return 0;
+    }
+    int64_t elapsed = (time - m_origin).toMicroseconds();
+    int64_t resolution = m_resolution.toMicroseconds();
+    return (elapsed + resolution - 1) / resolution;
+}
+
+void TimerWheel::schedule(Time const& deadline, uint64_t id) {
+    uint64_t tick = max(tickAt(deadline), m_current_tick + 1);
+    m_slots[tick % m_slots.size()].push_back(Timer { id, tick });
+    m_size++;
+}
+
+void TimerWheel::advance(Time const& now, vector<uint64_t>& expired) {
+    if (now < m_origin) {
+        return;
+    }
+    uint64_t target = (now - m_origin).toMicroseconds() / m_resolution.toMicroseconds();
+
+    // Jump over the ticks once there is nothing left to expire
+    if (m_size == 0) {
+        m_current_tick = max(m_current_tick, target);
+        return;
+    }
+
+    while (m_current_tick < target) {
+        m_current_tick++;
+        auto& slot = m_slots[m_current_tick % m_slots.size()];
+        for (size_t i = 0; i < slot.size(); ) {
+            if (slot[i].tick <= m_current_tick) {
+                expired.push_back(slot[i].id);
+                slot[i] = slot.back();
+                slot.pop_back();
+                m_size--;
+            }
+            else {
+                ++i;
+            }
+        }
+
+        if (m_size == 0) {
+            m_current_tick = target;
+        }
+    }
+}
+
+Time TimerWheel::getNextTick() const {
+    return m_origin + Time::fromMicroseconds(
+        (m_current_tick + 1) * m_resolution.toMicroseconds()
+    );
+}
+
+size_t TimerWheel::size() const {
+    return m_size;
+}
+
+bool TimerWheel::empty() const {
+    return m_size == 0;
+}
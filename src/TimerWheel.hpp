@@ -0,0 +1,67 @@
+#ifndef MODBUS_TIMERWHEEL_HPP
+#define MODBUS_TIMERWHEEL_HPP
+
+#include <cstdint>
+#include <vector>
+#include <base/Time.hpp>
+
+namespace modbus {
+    /** Hashed timer wheel
+     *
+     * Timers are hashed into a fixed number of slots by their expiration
+     * tick, which makes scheduling O(1) and expiration O(1) per timer
+     * regardless of how many timers are armed. Deadlines are rounded up to
+     * the next tick, so timers never expire early but may expire up to one
+     * resolution late.
+     *
+     * Timers cannot be cancelled. Owners instead ignore the expiration of
+     * timers they do not need anymore, e.g. by encoding a generation counter
+     * in the timer ID.
+     */
+    class TimerWheel {
+        struct Timer {
+            uint64_t id;
+            uint64_t tick;
+        };
+
+        base::Time m_resolution;
+        base::Time m_origin;
+        uint64_t m_current_tick = 0;
+        size_t m_size = 0;
+        std::vector<std::vector<Timer>> m_slots;
+
+        uint64_t tickAt(base::Time const& time) const;
+
+    public:
+        /**
+         * @param resolution duration of a tick
+         * @param slots number of slots. Timers that are more than
+         *   slots * resolution away stay in their slot for several turns
+         * @param origin time of tick zero
+         */
+        TimerWheel(base::Time const& resolution, size_t slots,
+                   base::Time const& origin = base::Time::now());
+
+        /** Arm a timer
+         *
+         * Deadlines in the past expire on the next tick
+         */
+        void schedule(base::Time const& deadline, uint64_t id);
+
+        /** Expire the timers whose tick is before the given time
+         *
+         * The IDs of the expired timers are appended to @a expired
+         */
+        void advance(base::Time const& now, std::vector<uint64_t>& expired);
+
+        /** Time at which the next tick ends */
+        base::Time getNextTick() const;
+
+        /** Number of armed timers */
+        size_t size() const;
+
+        bool empty() const;
+    };
+}
+
+#endif
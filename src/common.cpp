@@ -1,5 +1,14 @@
 #include <modbus/common.hpp>
 #include <modbus/Exceptions.hpp>
+#include <modbus/Functions.hpp>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 using namespace modbus;
 using namespace std;
@@ -16,53 +25,357 @@ uint8_t const* common::parse16(uint8_t const* buffer, uint16_t& value) {
     return buffer + 2;
 }
 
+namespace {
+    /** Swaps the bytes of each 16 bit word, scalar version */
+    void swap16Scalar(uint8_t* out, uint8_t const* in, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t msb = in[2 * i];
+            uint8_t lsb = in[2 * i + 1];
+            out[2 * i] = lsb;
+            out[2 * i + 1] = msb;
+        }
+    }
+
+#if defined(__x86_64__)
+    /** Swaps the bytes of each 16 bit word, 16 words at a time */
+    __attribute__((target("avx2")))
+    size_t swap16AVX2(uint8_t* out, uint8_t const* in, size_t count) {
+        __m256i const shuffle = _mm256_setr_epi8(
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+        );
+        size_t i = 0;
+        for (; count - i >= 16; i += 16) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + 2 * i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i),
+                                _mm256_shuffle_epi8(v, shuffle));
+        }
+        return i;
+    }
+
+    /** Swaps the bytes of each 16 bit word, 8 words at a time
+     *
+     * SSE2 is part of the x86_64 baseline, so this needs no runtime check
+     */
+    size_t swap16SSE2(uint8_t* out, uint8_t const* in, size_t count) {
+        size_t i = 0;
+        for (; count - i >= 8; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + 2 * i));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), v);
+        }
+        return i;
+    }
+
+    bool hasAVX2() {
+        static const bool available = __builtin_cpu_supports("avx2");
+        return available;
+    }
+
+    size_t swap16SIMD(uint8_t* out, uint8_t const* in, size_t count) {
+        size_t done = hasAVX2() ? swap16AVX2(out, in, count) : 0;
+        return done + swap16SSE2(out + 2 * done, in + 2 * done, count - done);
+    }
+#elif defined(__ARM_NEON)
+    /** Swaps the bytes of each 16 bit word, 8 words at a time */
+    size_t swap16SIMD(uint8_t* out, uint8_t const* in, size_t count) {
+        size_t i = 0;
+        for (; count - i >= 8; i += 8) {
+            vst1q_u8(out + 2 * i, vrev16q_u8(vld1q_u8(in + 2 * i)));
+        }
+        return i;
+    }
+#else
+    size_t swap16SIMD(uint8_t*, uint8_t const*, size_t) {
+        return 0;
+    }
+#endif
+
+    /** Converts between big endian and native 16 bit words
+     *
+     * out and in may be equal, but may not otherwise overlap
+     */
+    void swap16Block(uint8_t* out, uint8_t const* in, size_t count) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        if (out != in) {
+            memcpy(out, in, 2 * count);
+        }
+#else
+        size_t done = swap16SIMD(out, in, count);
+        swap16Scalar(out + 2 * done, in + 2 * done, count - done);
+#endif
+    }
+}
+
+uint8_t* common::format16Block(uint8_t* buffer, uint16_t const* values, size_t count) {
+    swap16Block(buffer, reinterpret_cast<uint8_t const*>(values), count);
+    return buffer + 2 * count;
+}
+
+uint8_t const* common::parse16Block(uint16_t* values, uint8_t const* buffer,
+                                    size_t count) {
+    swap16Block(reinterpret_cast<uint8_t*>(values), buffer, count);
+    return buffer + 2 * count;
+}
+
+/** Throws the UnexpectedReply of a failed read reply parse
+ *
+ * The sizes are appended to the message when they disagree, as the static
+ * Result message cannot carry them
+ */
+static void throwReadReplyError(Result const& result, FrameView const& frame) {
+    std::string message = result.message;
+    if (frame.payload_size != 0 && frame.payload_size != frame.payload[0] + 1u) {
+        message += " (" + std::to_string(frame.payload[0] + 1u) + " != " +
+                   std::to_string(frame.payload_size) + ")";
+    }
+    throw UnexpectedReply(message);
+}
+
 void common::parseReadRegisters(uint16_t* values, Frame const& frame, int length) {
+    parseReadRegisters(values, FrameView(frame), length);
+}
+
+void common::parseReadRegisters(uint16_t* values, FrameView const& frame, int length) {
+    Result result = tryParseReadRegisters(values, frame, length);
+    if (!result.ok()) {
+        throwReadReplyError(result, frame);
+    }
+}
+
+Result common::tryParseReadRegisters(uint16_t* values, FrameView const& frame,
+                                     int length) {
+    if (frame.payload_size == 0) {
+        return Result(RESULT_UNEXPECTED_REPLY, "RTU::parseReadRegisters: empty reply");
+    }
     uint8_t byte_count = frame.payload[0];
-    if (frame.payload.size() != byte_count + 1u) {
-        throw UnexpectedReply(
+    if (frame.payload_size != byte_count + 1u) {
+        return Result(
+            RESULT_UNEXPECTED_REPLY,
             "RTU::parseReadRegisters: reply's advertised byte count and frame payload "
-            "size differ ("
-            + to_string(byte_count + 1u) + " != "
-            + to_string(frame.payload.size()) + ")"
+            "size differ"
         );
     }
     else if (byte_count != length * 2) {
-        throw UnexpectedReply("RTU::parseReadRegisters: reply does not contain as many "
-                              "registers as was expected");
+        return Result(
+            RESULT_UNEXPECTED_REPLY,
+            "RTU::parseReadRegisters: reply does not contain as many registers as "
+            "was expected"
+        );
     }
 
-    for (int i = 0; i < length; ++i) {
-        parse16(&frame.payload[1 + i * 2], values[i]);
-    }
+    parse16Block(values, frame.payload + 1, length);
+    return Result();
 }
 
 void common::parseReadDigitalInputs(
     std::vector<bool>& values, Frame const& frame, int length
 ) {
-    if (frame.payload.empty()) {
-        throw UnexpectedReply("RTU::parseReadDigitalInputs: empty reply");
+    parseReadDigitalInputs(values, FrameView(frame), length);
+}
+
+static Result validateReadDigitalInputs(FrameView const& frame, int length) {
+    if (frame.payload_size == 0) {
+        return Result(RESULT_UNEXPECTED_REPLY, "RTU::parseReadDigitalInputs: empty reply");
     }
     uint16_t byte_count = frame.payload[0];
-    if (frame.payload.size() != byte_count + 1u) {
-        throw UnexpectedReply(
-            "RTU::praseReadDigitalInputs: reply's advertised byte count and frame payload "
-            "size differ ("
-            + to_string(byte_count + 1u) + " != "
-            + to_string(frame.payload.size()) + ")"
+    if (frame.payload_size != byte_count + 1u) {
+        return Result(
+            RESULT_UNEXPECTED_REPLY,
+            "RTU::parseReadDigitalInputs: reply's advertised byte count and frame "
+            "payload size differ"
         );
     }
     if (byte_count * 8 < length) {
-        throw UnexpectedReply("RTU::parseReadDigitalInputs: reply does not contain as many "
-                              "coils/digital inputs as expected");
+        return Result(
+            RESULT_UNEXPECTED_REPLY,
+            "RTU::parseReadDigitalInputs: reply does not contain as many "
+            "coils/digital inputs as expected"
+        );
+    }
+    return Result();
+}
+
+void common::parseReadDigitalInputs(
+    std::vector<bool>& values, FrameView const& frame, int length
+) {
+    Result result = validateReadDigitalInputs(frame, length);
+    if (!result.ok()) {
+        throwReadReplyError(result, frame);
     }
+    unpackBits(values, frame.payload + 1, length);
+}
 
-    int i = 1;
-    int shift = 0;
-    for (; length > 0; --length, ++shift) {
-        if (shift == 8) {
-            i++;
-            shift = 0;
+void common::parseReadDigitalInputs(
+    uint8_t* bits, FrameView const& frame, int length
+) {
+    Result result = tryParseReadDigitalInputs(bits, frame, length);
+    if (!result.ok()) {
+        throwReadReplyError(result, frame);
+    }
+}
+
+Result common::tryParseReadDigitalInputs(
+    uint8_t* bits, FrameView const& frame, int length
+) {
+    Result result = validateReadDigitalInputs(frame, length);
+    if (!result.ok()) {
+        return result;
+    }
+
+    int byte_count = (length + 7) / 8;
+    memcpy(bits, frame.payload + 1, byte_count);
+    if (length % 8) {
+        bits[byte_count - 1] &= (1 << (length % 8)) - 1;
+    }
+    return result;
+}
+
+uint8_t* common::formatWriteRegistersPayload(
+    uint8_t* payload, uint16_t start, uint16_t const* values, int count
+) {
+    format16(payload, start);
+    format16(payload + 2, count);
+    payload[4] = count * 2;
+    return format16Block(payload + 5, values, count);
+}
+
+uint8_t* common::formatWriteCoilsPayload(
+    uint8_t* payload, uint16_t start, uint8_t const* bits, int count
+) {
+    int byte_count = (count + 7) / 8;
+    format16(payload, start);
+    format16(payload + 2, count);
+    payload[4] = byte_count;
+    memcpy(payload + 5, bits, byte_count);
+    if (count % 8) {
+        payload[4 + byte_count] &= (1 << (count % 8)) - 1;
+    }
+    return payload + 5 + byte_count;
+}
+
+uint8_t* common::formatReadWriteRegistersPayload(
+    uint8_t* payload, uint16_t read_start, int read_count,
+    uint16_t write_start, uint16_t const* write_values, int write_count
+) {
+    format16(payload, read_start);
+    format16(payload + 2, read_count);
+    format16(payload + 4, write_start);
+    format16(payload + 6, write_count);
+    payload[8] = write_count * 2;
+    return format16Block(payload + 9, write_values, write_count);
+}
+
+Result common::checkWriteMultipleReply(FrameView const& reply,
+                                       uint16_t start, int count) {
+    if (reply.payload_size != 4) {
+        return Result(RESULT_UNEXPECTED_REPLY,
+                      "write multiple reply has an unexpected size");
+    }
+
+    uint16_t reply_start, reply_count;
+    parse16(reply.payload, reply_start);
+    parse16(reply.payload + 2, reply_count);
+    if (reply_start != start || reply_count != count) {
+        return Result(RESULT_UNEXPECTED_REPLY,
+                      "write multiple reply does not match the request");
+    }
+    return Result();
+}
+
+Result common::checkMaskWriteReply(FrameView const& reply, uint16_t register_id,
+                                  uint16_t and_mask, uint16_t or_mask) {
+    if (reply.payload_size != 6) {
+        return Result(RESULT_UNEXPECTED_REPLY,
+                      "mask write reply has an unexpected size");
+    }
+
+    uint8_t expected[6];
+    format16(expected, register_id);
+    format16(expected + 2, and_mask);
+    format16(expected + 4, or_mask);
+    if (memcmp(expected, reply.payload, 6) != 0) {
+        return Result(RESULT_UNEXPECTED_REPLY,
+                      "mask write reply does not match the request");
+    }
+    return Result();
+}
+
+Result common::checkReply(FrameView const& reply, int function) {
+    if (reply.function == function) {
+        return Result();
+    }
+
+    if (reply.function == FUNCTION_CODE_EXCEPTION + function) {
+        int exception_code = 0;
+        if (reply.payload_size) {
+            exception_code = reply.payload[0];
+        }
+        return Result::requestException(function, exception_code);
+    }
+    else {
+        return Result(RESULT_UNEXPECTED_REPLY,
+                      "received reply's function does not match request");
+    }
+}
+
+namespace {
+    /** Lookup table that expands a byte into one bool per bit */
+    struct BitUnpackTable {
+        bool bits[256][8];
+
+        BitUnpackTable() {
+            for (int byte = 0; byte < 256; ++byte) {
+                for (int bit = 0; bit < 8; ++bit) {
+                    bits[byte][bit] = (byte >> bit) & 1;
+                }
+            }
+        }
+    };
+}
+
+void common::unpackBits(bool* values, uint8_t const* bits, size_t count) {
+    static const BitUnpackTable table;
+
+    size_t full_bytes = count / 8;
+    for (size_t i = 0; i < full_bytes; ++i) {
+        memcpy(values + i * 8, table.bits[bits[i]], 8);
+    }
+    if (count % 8) {
+        memcpy(values + full_bytes * 8, table.bits[bits[full_bytes]], count % 8);
+    }
+}
+
+void common::unpackBits(std::vector<bool>& values, uint8_t const* bits, size_t count) {
+    size_t offset = values.size();
+    values.resize(offset + count);
+    for (size_t i = 0; i < count; ++i) {
+        values[offset + i] = (bits[i / 8] >> (i % 8)) & 1;
+    }
+}
+
+void common::packBits(uint8_t* bits, std::vector<bool> const& values,
+                      size_t offset, size_t count) {
+    memset(bits, 0, (count + 7) / 8);
+    for (size_t i = 0; i < count; ++i) {
+        if (values[offset + i]) {
+            bits[i / 8] |= 1 << (i % 8);
         }
-        values.push_back((frame.payload[i] >> shift) & 0x1);
+    }
+}
+
+Result common::tryParseBatchReply(BatchRequest& request, FrameView const& reply) {
+    switch (request.function) {
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS:
+            return tryParseReadRegisters(request.read_registers, reply, request.count);
+        case FUNCTION_READ_COILS:
+        case FUNCTION_READ_DIGITAL_INPUTS:
+            return tryParseReadDigitalInputs(request.read_bits, reply, request.count);
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS:
+        case FUNCTION_WRITE_MULTIPLE_COILS:
+            return checkWriteMultipleReply(reply, request.start, request.count);
+        default:
+            return Result();
     }
 }
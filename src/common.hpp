@@ -1,26 +1,236 @@
 #ifndef MODBUS_COMMON_HPP
 #define MODBUS_COMMON_HPP
 
+#include <modbus/BatchRequest.hpp>
 #include <modbus/Frame.hpp>
+#include <modbus/Result.hpp>
 
 namespace modbus {
     /** Parts common between the RTU and TCP protocols
      */
     namespace common {
+        /** Value added to the request's function code in exception replies */
+        static const int FUNCTION_CODE_EXCEPTION = 0x80;
+
+        /** Maximum number of registers in a single read registers request,
+         * as limited by the size of the Modbus PDU
+         */
+        static const int READ_REGISTERS_MAX_COUNT = 125;
+
+        /** Maximum number of coils or digital inputs in a single read
+         * request, as limited by the size of the Modbus PDU
+         */
+        static const int READ_DIGITAL_INPUTS_MAX_COUNT = 2000;
+
+        /** Maximum number of registers in a single write multiple registers
+         * request, as limited by the size of the Modbus PDU
+         */
+        static const int WRITE_REGISTERS_MAX_COUNT = 123;
+
+        /** Maximum number of coils in a single write multiple coils request,
+         * as limited by the size of the Modbus PDU
+         */
+        static const int WRITE_COILS_MAX_COUNT = 1968;
+
+        /** Maximum number of registers read by a read/write multiple
+         * registers request
+         */
+        static const int READ_WRITE_REGISTERS_MAX_READ_COUNT = 125;
+
+        /** Maximum number of registers written by a read/write multiple
+         * registers request
+         */
+        static const int READ_WRITE_REGISTERS_MAX_WRITE_COUNT = 121;
+
         uint8_t* format16(uint8_t* buffer, uint16_t value);
 
         uint8_t const* parse16(uint8_t const* buffer, uint16_t& value);
 
+        /** Encode a block of 16 bit values in big endian byte order
+         *
+         * This is the bulk version of format16. It uses the SIMD instructions
+         * available on the CPU (SSE2/AVX2 on x86_64, NEON on ARM).
+         *
+         * @param buffer the output buffer, of at least 2 * count bytes
+         * @param values the values to encode. They may be stored at the same
+         *   address than buffer, in which case the encoding is done in place.
+         *   They may not otherwise overlap with buffer.
+         * @return the end of the encoded data in buffer
+         */
+        uint8_t* format16Block(uint8_t* buffer, uint16_t const* values, size_t count);
+
+        /** Decode a block of big endian 16 bit values
+         *
+         * This is the bulk version of parse16. It uses the SIMD instructions
+         * available on the CPU (SSE2/AVX2 on x86_64, NEON on ARM).
+         *
+         * @param values the output values, of at least count elements. They may
+         *   be stored at the same address than buffer, in which case the
+         *   decoding is done in place. They may not otherwise overlap with
+         *   buffer.
+         * @param buffer the encoded data, of at least 2 * count bytes
+         * @return the end of the decoded data in buffer
+         */
+        uint8_t const* parse16Block(uint16_t* values, uint8_t const* buffer, size_t count);
+
         /** Parse a read registers reply */
         void parseReadRegisters(
             uint16_t* values, Frame const& frame, int length
         );
 
+        /** Parse a read registers reply directly from a frame view */
+        void parseReadRegisters(
+            uint16_t* values, FrameView const& frame, int length
+        );
+
+        /** Non-throwing version of parseReadRegisters
+         *
+         * @return RESULT_UNEXPECTED_REPLY or RESULT_OK
+         */
+        Result tryParseReadRegisters(
+            uint16_t* values, FrameView const& frame, int length
+        );
+
+        /** Parse a read registers reply from a static frame */
+        template<size_t N>
+        void parseReadRegisters(
+            uint16_t* values, StaticFrame<N> const& frame, int length
+        ) {
+            parseReadRegisters(values, FrameView(frame), length);
+        }
+
         /** Parse a coil/digital input reply */
         void parseReadDigitalInputs(
             std::vector<bool>& values, Frame const& frame, int length
         );
 
+        /** Parse a coil/digital input reply directly from a frame view */
+        void parseReadDigitalInputs(
+            std::vector<bool>& values, FrameView const& frame, int length
+        );
+
+        /** Parse a coil/digital input reply into a packed bit buffer
+         *
+         * The bits are packed in the Modbus wire format, i.e. the input i
+         * is bit i % 8 of byte i / 8. The unused bits of the last byte are
+         * cleared. The parsing itself is a memcpy.
+         *
+         * @param bits output buffer of at least (length + 7) / 8 bytes
+         */
+        void parseReadDigitalInputs(
+            uint8_t* bits, FrameView const& frame, int length
+        );
+
+        /** Non-throwing version of parseReadDigitalInputs into packed bits
+         *
+         * @return RESULT_UNEXPECTED_REPLY or RESULT_OK
+         */
+        Result tryParseReadDigitalInputs(
+            uint8_t* bits, FrameView const& frame, int length
+        );
+
+        /** Fill a buffer with the payload of a write multiple registers request
+         *
+         * The count is not validated, this is the job of the RTU and TCP
+         * formatting functions
+         *
+         * @param payload output buffer of at least 5 + 2 * count bytes
+         * @return the end of the payload
+         */
+        uint8_t* formatWriteRegistersPayload(
+            uint8_t* payload, uint16_t start, uint16_t const* values, int count
+        );
+
+        /** Fill a buffer with the payload of a write multiple coils request
+         *
+         * The count is not validated, this is the job of the RTU and TCP
+         * formatting functions. The unused bits of the last byte are cleared.
+         *
+         * @param payload output buffer of at least 5 + (count + 7) / 8 bytes
+         * @param bits packed bits, in the format of parseReadDigitalInputs
+         * @return the end of the payload
+         */
+        uint8_t* formatWriteCoilsPayload(
+            uint8_t* payload, uint16_t start, uint8_t const* bits, int count
+        );
+
+        /** Fill a buffer with the payload of a read/write multiple registers
+         * request
+         *
+         * The counts are not validated, this is the job of the RTU and TCP
+         * formatting functions
+         *
+         * @param payload output buffer of at least 9 + 2 * write_count bytes
+         * @return the end of the payload
+         */
+        uint8_t* formatReadWriteRegistersPayload(
+            uint8_t* payload, uint16_t read_start, int read_count,
+            uint16_t write_start, uint16_t const* write_values, int write_count
+        );
+
+        /** Validates the reply to a mask write register request
+         *
+         * The reply is expected to be an echo of the request
+         *
+         * @return RESULT_UNEXPECTED_REPLY or RESULT_OK
+         */
+        Result checkMaskWriteReply(FrameView const& reply, uint16_t register_id,
+                                   uint16_t and_mask, uint16_t or_mask);
+
+        /** Validates the reply to a write multiple registers or coils request
+         *
+         * The reply is expected to echo the request's start register and
+         * register or coil count
+         *
+         * @return RESULT_UNEXPECTED_REPLY or RESULT_OK
+         */
+        Result checkWriteMultipleReply(FrameView const& reply, uint16_t start, int count);
+
+        /** Decode the reply to a batch request into its destination buffer,
+         * or check it for writes
+         *
+         * The reply must already have been checked with checkReply
+         */
+        Result tryParseBatchReply(BatchRequest& request, FrameView const& reply);
+
+        /** Checks that a reply matches the function of the request
+         *
+         * @return RESULT_OK if the reply has the request's function,
+         *   RESULT_REQUEST_EXCEPTION if it is an exception reply and
+         *   RESULT_UNEXPECTED_REPLY otherwise
+         */
+        Result checkReply(FrameView const& reply, int function);
+
+        /** Unpack a packed bit buffer into one bool per bit
+         *
+         * The bits are unpacked a byte at a time with a lookup table
+         *
+         * @param values output array of at least count elements
+         * @param bits packed bits, in the format of parseReadDigitalInputs
+         */
+        void unpackBits(bool* values, uint8_t const* bits, size_t count);
+
+        /** Append the bits of a packed bit buffer to a vector of booleans */
+        void unpackBits(std::vector<bool>& values, uint8_t const* bits, size_t count);
+
+        /** Pack booleans into a packed bit buffer
+         *
+         * This is the inverse of unpackBits. The unused bits of the last byte
+         * are cleared.
+         *
+         * @param bits output buffer of at least (count + 7) / 8 bytes
+         */
+        void packBits(uint8_t* bits, std::vector<bool> const& values,
+                      size_t offset, size_t count);
+
+        /** Parse a coil/digital input reply from a static frame */
+        template<size_t N>
+        void parseReadDigitalInputs(
+            std::vector<bool>& values, StaticFrame<N> const& frame, int length
+        ) {
+            parseReadDigitalInputs(values, FrameView(frame), length);
+        }
+
     };
 }
 
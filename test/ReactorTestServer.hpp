@@ -0,0 +1,134 @@
+#ifndef MODBUS_TEST_REACTORTESTSERVER_HPP
+#define MODBUS_TEST_REACTORTESTSERVER_HPP
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/** Minimal Modbus TCP server on the loopback interface
+ *
+ * It replies to register reads with the register addresses as values, to
+ * multiple writes with their start and count, and to all other requests
+ * with an echo
+ */
+struct ReactorTestServer {
+    int listen_fd;
+    int port;
+    std::atomic<bool> quit;
+    std::thread acceptor;
+    std::mutex lock;
+    std::vector<std::thread> clients;
+
+    /** Requests that get no reply */
+    std::atomic<int> silent_requests;
+    /** Delay of the first reply on each connection */
+    std::atomic<int> first_reply_delay_ms;
+
+    ReactorTestServer()
+        : quit(false)
+        , silent_requests(0)
+        , first_reply_delay_ms(0) {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        socklen_t size = sizeof(address);
+        getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &size);
+        port = ntohs(address.sin_port);
+        listen(listen_fd, 128);
+
+        acceptor = std::thread([this]() { accept(); });
+    }
+
+    ~ReactorTestServer() {
+        quit = true;
+        acceptor.join();
+        for (auto& client : clients) {
+            client.join();
+        }
+        close(listen_fd);
+    }
+
+    bool waitReadable(int fd) {
+        pollfd p = { fd, POLLIN, 0 };
+        while (!quit) {
+            if (::poll(&p, 1, 10) > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void accept() {
+        while (waitReadable(listen_fd)) {
+            int fd = ::accept(listen_fd, nullptr, nullptr);
+            std::lock_guard<std::mutex> guard(lock);
+            clients.push_back(std::thread([this, fd]() { serve(fd); }));
+        }
+    }
+
+    bool readAll(int fd, uint8_t* buffer, size_t size) {
+        while (size > 0) {
+            if (!waitReadable(fd)) {
+                return false;
+            }
+            ssize_t ret = read(fd, buffer, size);
+            if (ret <= 0) {
+                return false;
+            }
+            buffer += ret;
+            size -= ret;
+        }
+        return true;
+    }
+
+    void serve(int fd) {
+        bool first = true;
+        uint8_t request[260];
+        while (readAll(fd, request, 6)) {
+            size_t length = request[4] << 8 | request[5];
+            if (!readAll(fd, request + 6, length)) {
+                break;
+            }
+
+            std::vector<uint8_t> reply(request, request + 8);
+            if (request[7] == 0x03) {
+                int start = request[8] << 8 | request[9];
+                int count = request[11];
+                reply.push_back(count * 2);
+                for (int i = 0; i < count; ++i) {
+                    reply.push_back((start + i) >> 8);
+                    reply.push_back((start + i) & 0xff);
+                }
+            }
+            else if (request[7] == 0x0f || request[7] == 0x10) {
+                reply.insert(reply.end(), request + 8, request + 12);
+            }
+            else {
+                reply.insert(reply.end(), request + 8, request + 6 + length);
+            }
+            reply[4] = 0;
+            reply[5] = reply.size() - 6;
+
+            if (silent_requests > 0) {
+                silent_requests--;
+                continue;
+            }
+            if (first) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(first_reply_delay_ms));
+                first = false;
+            }
+            write(fd, reply.data(), reply.size());
+        }
+        close(fd);
+    }
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include <modbus/RTU.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace modbus;
+
+typedef uint16_t (*CRCFunction)(uint16_t, uint8_t const*, uint8_t const*);
+
+/** Returns the throughput of a CRC implementation in bytes per nanosecond */
+static double measure(CRCFunction function, vector<uint8_t> const& bytes,
+                      size_t frame_size) {
+    size_t const total = 64 * 1024 * 1024;
+    size_t iterations = max<size_t>(1, total / frame_size);
+    uint8_t const* start = &bytes[0];
+
+    // Accumulate the results so that the compiler can't optimize the calls out
+    volatile uint16_t sink = 0;
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        size_t offset = (i * frame_size) % (bytes.size() - frame_size + 1);
+        sink = sink ^ function(RTU::CRC_INITIAL_VALUE,
+                               start + offset, start + offset + frame_size);
+    }
+    auto duration = chrono::steady_clock::now() - begin;
+    double ns = chrono::duration_cast<chrono::nanoseconds>(duration).count();
+    return static_cast<double>(iterations * frame_size) / ns;
+}
+
+int main(int argc, char** argv) {
+    vector<uint8_t> bytes(4 * 1024 * 1024);
+    for (auto& b : bytes) {
+        b = rand();
+    }
+
+    struct Implementation {
+        char const* name;
+        CRCFunction function;
+    };
+    Implementation implementations[] = {
+        { "bitwise", RTU::updateCRCBitwise },
+        { "table", RTU::updateCRCTable },
+        { "slicing-by-8", RTU::updateCRCSlicingBy8 },
+        { "clmul", RTU::updateCRCCarrylessMultiply },
+        { "default", RTU::updateCRC }
+    };
+    size_t frame_sizes[] = { 8, 64, 256, 4096, 1024 * 1024 };
+
+    cout << "carry-less multiplication available: "
+         << (RTU::hasCRCCarrylessMultiply() ? "yes" : "no") << "\n\n";
+    cout << setw(14) << "bytes/ns";
+    for (size_t size : frame_sizes) {
+        cout << setw(10) << size;
+    }
+    cout << "\n";
+
+    for (auto const& impl : implementations) {
+        cout << setw(14) << impl.name;
+        for (size_t size : frame_sizes) {
+            cout << setw(10) << fixed << setprecision(3)
+                 << measure(impl.function, bytes, size);
+        }
+        cout << endl;
+    }
+    return 0;
+}
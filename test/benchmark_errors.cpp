@@ -0,0 +1,80 @@
+#include <modbus/RTU.hpp>
+#include <modbus/Exceptions.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace modbus;
+
+/** Number of parse attempts per measurement */
+static const size_t ITERATIONS = 1000000;
+
+/** Returns the time in nanoseconds spent per call of the throwing API */
+static double measureThrowing(uint8_t const* start, uint8_t const* end) {
+    volatile size_t failures = 0;
+    FrameView frame;
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i) {
+        try {
+            RTU::parseFrame(frame, start, end);
+        }
+        catch(RTU::InvalidCRC const&) {
+            failures = failures + 1;
+        }
+        catch(RTU::TooSmall const&) {
+            failures = failures + 1;
+        }
+    }
+    auto duration = chrono::steady_clock::now() - begin;
+    double ns = chrono::duration_cast<chrono::nanoseconds>(duration).count();
+    return ns / ITERATIONS;
+}
+
+/** Returns the time in nanoseconds spent per call of the non-throwing API */
+static double measureResult(uint8_t const* start, uint8_t const* end) {
+    volatile size_t failures = 0;
+    FrameView frame;
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i) {
+        if (!RTU::tryParseFrame(frame, start, end).ok()) {
+            failures = failures + 1;
+        }
+    }
+    auto duration = chrono::steady_clock::now() - begin;
+    double ns = chrono::duration_cast<chrono::nanoseconds>(duration).count();
+    return ns / ITERATIONS;
+}
+
+int main(int argc, char** argv) {
+    // A holding register read reply, as it would be received with and
+    // without line noise
+    vector<uint8_t> valid = { 0x10, 0x03, 0x4, 0x12, 0x34, 0x56, 0x78, 0x80, 0x06 };
+    vector<uint8_t> corrupted = valid;
+    corrupted[4] ^= 0x10;
+    vector<uint8_t> truncated(valid.begin(), valid.begin() + 3);
+
+    struct Case {
+        char const* name;
+        vector<uint8_t> const* bytes;
+    };
+    Case cases[] = {
+        { "valid", &valid },
+        { "invalid CRC", &corrupted },
+        { "too small", &truncated }
+    };
+
+    cout << setw(14) << "ns/frame" << setw(12) << "throwing" << setw(12) << "result"
+         << "\n";
+    for (auto const& c : cases) {
+        uint8_t const* start = &(*c.bytes)[0];
+        uint8_t const* end = start + c.bytes->size();
+        cout << setw(14) << c.name
+             << setw(12) << fixed << setprecision(1) << measureThrowing(start, end)
+             << setw(12) << fixed << setprecision(1) << measureResult(start, end)
+             << endl;
+    }
+    return 0;
+}
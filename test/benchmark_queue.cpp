@@ -0,0 +1,91 @@
+#include <modbus/MasterQueue.hpp>
+#include <modbus/TCPMaster.hpp>
+
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace modbus;
+
+/** Number of operations per producer thread */
+static const size_t OPERATIONS = 20000;
+
+/** Simulated duration of a bus transaction */
+static const chrono::microseconds TRANSACTION_DURATION(10);
+
+/** Stand-in for a transaction. It busy-waits to keep the measurement free of
+ * scheduler wake-up latencies, and does not touch the master
+ */
+static Result transaction(MasterInterface&) {
+    auto end = chrono::steady_clock::now() + TRANSACTION_DURATION;
+    while (chrono::steady_clock::now() < end);
+    return Result();
+}
+
+/** Returns the throughput in operations per second when all producers share
+ * the master through a mutex
+ */
+static double measureMutex(MasterInterface& master, int producers) {
+    mutex lock;
+    auto begin = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.push_back(thread([&]() {
+            for (size_t j = 0; j < OPERATIONS; ++j) {
+                lock_guard<mutex> guard(lock);
+                transaction(master);
+            }
+        }));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double s = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return producers * OPERATIONS / s;
+}
+
+/** Returns the throughput in operations per second when all producers go
+ * through a MasterQueue, each waiting for the future of its operations
+ */
+static double measureQueue(MasterInterface& master, int producers) {
+    MasterQueue queue(master);
+    queue.start();
+    auto begin = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.push_back(thread([&]() {
+            for (size_t j = 0; j < OPERATIONS; ++j) {
+                queue.submit(transaction).get();
+            }
+        }));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double s = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return producers * OPERATIONS / s;
+}
+
+int main(int argc, char** argv) {
+    TCPMaster master(256);
+
+    cout << "Simulated transaction duration: "
+         << TRANSACTION_DURATION.count() << "us\n";
+    cout << setw(10) << "producers"
+         << setw(16) << "mutex (op/s)"
+         << setw(16) << "queue (op/s)" << "\n";
+
+    for (int producers : { 1, 2, 4, 8, 16 }) {
+        double mutex_rate = measureMutex(master, producers);
+        double queue_rate = measureQueue(master, producers);
+        cout << setw(10) << producers
+             << setw(16) << fixed << setprecision(0) << mutex_rate
+             << setw(16) << queue_rate << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <modbus/TCPReactor.hpp>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+/** Duration of each measurement */
+static const Time DURATION = Time::fromSeconds(2);
+
+/** Returns the CPU time consumed by the calling thread, in seconds */
+static double threadCPUTime() {
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/** Stand-in Modbus TCP server, replying to register reads from a single
+ * epoll thread
+ */
+struct StandInServer {
+    int listen_fd;
+    int epoll_fd;
+    int port;
+    atomic<bool> quit;
+    thread worker;
+
+    StandInServer()
+        : quit(false) {
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        socklen_t size = sizeof(address);
+        getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &size);
+        port = ntohs(address.sin_port);
+        listen(listen_fd, 1024);
+
+        epoll_fd = epoll_create1(0);
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = listen_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+        worker = thread([this]() { run(); });
+    }
+
+    ~StandInServer() {
+        quit = true;
+        worker.join();
+        close(epoll_fd);
+        close(listen_fd);
+    }
+
+    void run() {
+        map<int, vector<uint8_t>> buffers;
+        epoll_event events[64];
+        while (!quit) {
+            int count = epoll_wait(epoll_fd, events, 64, 10);
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd) {
+                    int client;
+                    while ((client = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK)) != -1) {
+                        epoll_event event;
+                        event.events = EPOLLIN;
+                        event.data.fd = client;
+                        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client, &event);
+                    }
+                }
+                else if (!serve(fd, buffers[fd])) {
+                    close(fd);
+                    buffers.erase(fd);
+                }
+            }
+        }
+        for (auto const& buffer : buffers) {
+            close(buffer.first);
+        }
+    }
+
+    /** Reply to the complete requests received on fd
+     *
+     * @return false if the connection was closed
+     */
+    bool serve(int fd, vector<uint8_t>& buffer) {
+        uint8_t data[4096];
+        ssize_t ret = read(fd, data, sizeof(data));
+        if (ret <= 0) {
+            return ret < 0 && errno == EAGAIN;
+        }
+        buffer.insert(buffer.end(), data, data + ret);
+
+        vector<uint8_t> replies;
+        size_t offset = 0;
+        while (buffer.size() - offset >= 12) {
+            uint8_t const* request = buffer.data() + offset;
+            int count = request[11];
+            size_t reply_start = replies.size();
+            replies.insert(replies.end(), request, request + 8);
+            replies[reply_start + 5] = 3 + count * 2;
+            replies.push_back(count * 2);
+            replies.resize(replies.size() + count * 2, 0x42);
+            offset += 12;
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + offset);
+        if (!replies.empty()) {
+            ssize_t written = write(fd, replies.data(), replies.size());
+            (void)written;
+        }
+        return true;
+    }
+};
+
+struct Measurement {
+    double transactions_per_second;
+    double reactor_cpu_time;
+    size_t errors;
+};
+
+/** Keeps each connection busy with back-to-back register reads */
+static Measurement measure(StandInServer const& server, int connections) {
+    TCPReactor reactor;
+    for (int i = 0; i < connections; ++i) {
+        reactor.addConnection("127.0.0.1", server.port);
+    }
+
+    atomic<bool> running(true);
+    atomic<size_t> errors(0);
+    // CPU time of the reactor thread, sampled in the callbacks
+    atomic<double> cpu_end(0);
+
+    function<void (int)> next = [&](int connection) {
+        reactor.readRegisters(connection, 1, false, 0, 10,
+            [&, connection](Result const& result, uint16_t const*) {
+                if (!result.ok()) {
+                    errors++;
+                }
+                cpu_end = threadCPUTime();
+                if (running) {
+                    next(connection);
+                }
+            }
+        );
+    };
+
+    reactor.start();
+    for (int i = 0; i < connections; ++i) {
+        next(i);
+    }
+
+    // Let the connections open before measuring
+    this_thread::sleep_for(chrono::milliseconds(200));
+    size_t start_count = reactor.getTransactionCount();
+    Time start = Time::now();
+    double start_cpu = cpu_end;
+    this_thread::sleep_for(chrono::microseconds(DURATION.toMicroseconds()));
+    size_t end_count = reactor.getTransactionCount();
+    Time end = Time::now();
+    double end_cpu = cpu_end;
+
+    running = false;
+    this_thread::sleep_for(chrono::milliseconds(50));
+    reactor.stop();
+
+    Measurement result;
+    result.transactions_per_second = (end_count - start_count) / (end - start).toSeconds();
+    result.reactor_cpu_time = (end_cpu - start_cpu) / (end - start).toSeconds();
+    result.errors = errors;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    StandInServer server;
+
+    cout << setw(12) << "connections"
+         << setw(16) << "transactions/s"
+         << setw(12) << "reactor CPU"
+         << setw(20) << "transactions/CPU.s"
+         << setw(8) << "errors" << "\n";
+
+    for (int connections : { 1, 16, 64, 256, 400 }) {
+        Measurement m = measure(server, connections);
+        cout << setw(12) << connections
+             << setw(16) << fixed << setprecision(0) << m.transactions_per_second
+             << setw(11) << setprecision(0) << m.reactor_cpu_time * 100 << "%"
+             << setw(20) << m.transactions_per_second / m.reactor_cpu_time
+             << setw(8) << m.errors << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <modbus/AsyncMaster.hpp>
+
+// The coroutine API needs C++20. The test is empty otherwise
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <gtest/gtest.h>
+#include "ReactorTestServer.hpp"
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+struct AsyncMasterTest : public ::testing::Test {
+    ReactorTestServer server;
+    TCPReactor reactor;
+
+    AsyncMasterTest()
+        : reactor(Time::fromMilliseconds(5)) {
+    }
+
+    void pollUntilDone(Task const& task) {
+        Time deadline = Time::now() + Time::fromSeconds(5);
+        while (!task.done() && Time::now() < deadline) {
+            reactor.poll(Time::fromMilliseconds(10));
+        }
+    }
+};
+
+static Task readThenWrite(AsyncMaster& device, uint16_t* values, Result& write_result) {
+    Result result = co_await device.readRegisters(values, 1, false, 0x10, 2);
+    if (result.ok()) {
+        write_result = co_await device.writeSingleRegister(1, 0x20, values[1]);
+    }
+}
+
+TEST_F(AsyncMasterTest, it_runs_a_conversation_as_straight_line_code) {
+    AsyncMaster device(reactor, reactor.addConnection("127.0.0.1", server.port));
+
+    uint16_t values[2];
+    Result write_result(RESULT_TIMEOUT, "not run");
+    Task task = readThenWrite(device, values, write_result);
+    pollUntilDone(task);
+
+    ASSERT_TRUE(task.done());
+    ASSERT_EQ(0x10, values[0]);
+    ASSERT_EQ(0x11, values[1]);
+    ASSERT_TRUE(write_result.ok());
+}
+
+static Task countReads(AsyncMaster& device, int reads, int& successes) {
+    for (int i = 0; i < reads; ++i) {
+        uint16_t value;
+        Result result = co_await device.readRegisters(&value, 1, false, i, 1);
+        if (result.ok() && value == i) {
+            successes++;
+        }
+    }
+}
+
+static Task runAll(vector<AsyncMaster>& devices, int& successes) {
+    vector<Task> tasks;
+    for (auto& device : devices) {
+        tasks.push_back(countReads(device, 10, successes));
+    }
+    for (auto& task : tasks) {
+        co_await task;
+    }
+}
+
+TEST_F(AsyncMasterTest, it_interleaves_conversations_with_several_devices) {
+    vector<AsyncMaster> devices;
+    for (int i = 0; i < 20; ++i) {
+        devices.push_back(AsyncMaster(reactor, reactor.addConnection("127.0.0.1", server.port)));
+    }
+
+    int successes = 0;
+    Task task = runAll(devices, successes);
+    pollUntilDone(task);
+    ASSERT_TRUE(task.done());
+    ASSERT_EQ(200, successes);
+}
+
+static Task failOnTimeout(AsyncMaster& device) {
+    Result result = co_await device.writeSingleRegister(1, 0, 0);
+    if (!result.ok()) {
+        throw runtime_error(result.message);
+    }
+}
+
+TEST_F(AsyncMasterTest, it_rethrows_exceptions_when_getting_the_task_result) {
+    AsyncMaster device(reactor, reactor.addConnection("127.0.0.1", server.port));
+    reactor.setTimeout(Time::fromMilliseconds(20));
+    server.silent_requests = 1;
+
+    Task task = failOnTimeout(device);
+    pollUntilDone(task);
+    ASSERT_TRUE(task.done());
+    ASSERT_THROW(task.get(), runtime_error);
+}
+
+static Task readMany(AsyncMaster& device, uint16_t* values, Result& result) {
+    result = co_await device.readRegisters(values, 1, false, 0x100, 300);
+}
+
+TEST_F(AsyncMasterTest, it_splits_reads_longer_than_a_request) {
+    AsyncMaster device(reactor, reactor.addConnection("127.0.0.1", server.port));
+
+    vector<uint16_t> values(300);
+    Result result(RESULT_TIMEOUT, "not run");
+    Task task = readMany(device, values.data(), result);
+    pollUntilDone(task);
+
+    ASSERT_TRUE(task.done());
+    ASSERT_TRUE(result.ok());
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_EQ(0x100 + i, values[i]);
+    }
+}
+
+static Task writeAll(AsyncMaster& device, vector<Result>& results) {
+    vector<uint16_t> values(200, 0x1234);
+    vector<uint8_t> bits(250, 0x55);
+    results.push_back(co_await device.writeRegisters(1, 0x10, values.data(), 200));
+    results.push_back(co_await device.writeCoils(1, 0x10, bits.data(), 2000));
+    results.push_back(co_await device.writeSingleCoil(1, 0x10, true));
+    results.push_back(co_await device.maskWriteRegister(1, 0x10, 0xff00, 0x0012));
+}
+
+TEST_F(AsyncMasterTest, it_validates_the_replies_to_writes) {
+    AsyncMaster device(reactor, reactor.addConnection("127.0.0.1", server.port));
+
+    vector<Result> results;
+    Task task = writeAll(device, results);
+    pollUntilDone(task);
+
+    ASSERT_TRUE(task.done());
+    ASSERT_EQ(4, results.size());
+    for (auto const& result : results) {
+        ASSERT_TRUE(result.ok()) << result.message;
+    }
+}
+
+TEST_F(AsyncMasterTest, it_rejects_invalid_ranges_when_creating_an_operation) {
+    AsyncMaster device(reactor, reactor.addConnection("127.0.0.1", server.port));
+
+    uint16_t values[1];
+    ASSERT_THROW(device.readRegisters(values, 1, false, 0, 0), invalid_argument);
+    ASSERT_THROW(device.readRegisters(values, 1, false, 0xffff, 2), invalid_argument);
+    ASSERT_THROW(device.writeRegisters(1, 0, values, 0), invalid_argument);
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <modbus/MasterQueue.hpp>
+#include <modbus/TCPMaster.hpp>
+#include <iodrivers_base/FixtureGTest.hpp>
+#include <set>
+#include <thread>
+
+using namespace std;
+using namespace modbus;
+
+struct MasterQueueDriver : public TCPMaster {
+    MasterQueueDriver()
+        : TCPMaster(256) {
+    }
+};
+
+struct MasterQueueTest : public ::testing::Test, iodrivers_base::Fixture<MasterQueueDriver> {
+    MasterQueue queue;
+
+    MasterQueueTest()
+        : queue(driver) {
+        queue.start();
+    }
+};
+
+TEST_F(MasterQueueTest, it_runs_operations_and_reports_their_result_through_a_future) {
+    auto result = queue.submit([](MasterInterface&) {
+        return Result(RESULT_TIMEOUT, "timeout");
+    });
+    ASSERT_EQ(RESULT_TIMEOUT, result.get().code);
+}
+
+TEST_F(MasterQueueTest, it_reports_the_result_through_a_callback) {
+    promise<Result> done;
+    queue.submit(
+        [](MasterInterface&) { return Result(); },
+        [&done](Result const& result) { done.set_value(result); }
+    );
+    ASSERT_TRUE(done.get_future().get().ok());
+}
+
+TEST_F(MasterQueueTest, it_runs_all_operations_in_a_single_thread) {
+    mutex lock;
+    set<thread::id> threads;
+    vector<future<Result>> results[4];
+
+    vector<thread> producers;
+    for (int i = 0; i < 4; ++i) {
+        producers.push_back(thread([&, i]() {
+            for (int j = 0; j < 100; ++j) {
+                results[i].push_back(queue.submit([&](MasterInterface&) {
+                    lock_guard<mutex> guard(lock);
+                    threads.insert(this_thread::get_id());
+                    return Result();
+                }));
+            }
+        }));
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    for (auto& r : results) {
+        for (auto& f : r) {
+            ASSERT_TRUE(f.get().ok());
+        }
+    }
+    ASSERT_EQ(1u, threads.size());
+    ASSERT_EQ(0u, threads.count(this_thread::get_id()));
+}
+
+TEST_F(MasterQueueTest, it_keeps_the_submission_order_of_a_given_thread) {
+    vector<int> order;
+    vector<future<Result>> results;
+    for (int i = 0; i < 100; ++i) {
+        results.push_back(queue.submit([&order, i](MasterInterface&) {
+            order.push_back(i);
+            return Result();
+        }));
+    }
+    results.back().get();
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(i, order[i]);
+    }
+}
+
+TEST_F(MasterQueueTest, it_processes_the_queued_operations_before_stopping) {
+    int count = 0;
+    for (int i = 0; i < 100; ++i) {
+        queue.submit([&count](MasterInterface&) { ++count; return Result(); },
+                     MasterQueue::Callback());
+    }
+    queue.stop();
+    ASSERT_EQ(100, count);
+}
+
+TEST_F(MasterQueueTest, it_reads_registers_through_the_master) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0xab, 0xcd, 0, 2 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 7, 0x10, 0x03, 4, 0x12, 0x34, 0x56, 0x78 }
+    );
+
+    uint16_t values[2];
+    ASSERT_TRUE(queue.readRegisters(values, 0x10, false, 0xabcd, 2).get().ok());
+    ASSERT_EQ(0x1234, values[0]);
+    ASSERT_EQ(0x5678, values[1]);
+}
+
+TEST_F(MasterQueueTest, it_reports_exceptions_returned_by_the_slave) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 3, 0x10, 0x86, 0x02 }
+    );
+
+    Result result = queue.writeSingleRegister(0x10, 0xabcd, 0x1234).get();
+    ASSERT_FALSE(result.ok());
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, result.code);
+}
+
+TEST_F(MasterQueueTest, it_passes_exceptions_thrown_by_an_operation_to_its_future) {
+    uint16_t values[2];
+    auto result = queue.readRegisters(values, 0x10, false, 0xffff, 2);
+    ASSERT_THROW(result.get(), std::invalid_argument);
+
+    auto next = queue.submit([](MasterInterface&) { return Result(); });
+    ASSERT_TRUE(next.get().ok());
+}
+
+TEST_F(MasterQueueTest, it_reports_exceptions_thrown_by_an_operation_to_its_callback) {
+    promise<Result> done;
+    queue.submit(
+        [](MasterInterface&) -> Result { throw std::runtime_error("failed"); },
+        [&done](Result const& result) { done.set_value(result); }
+    );
+    ASSERT_EQ(RESULT_EXCEPTION, done.get_future().get().code);
+}
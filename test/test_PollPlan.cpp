@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include <modbus/PollPlan.hpp>
+#include <modbus/TCPMaster.hpp>
+#include <iodrivers_base/FixtureGTest.hpp>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+struct PollPlanDriver : public TCPMaster {
+    PollPlanDriver()
+        : TCPMaster(256) {
+    }
+};
+
+struct PollPlanTest : public ::testing::Test, iodrivers_base::Fixture<PollPlanDriver> {
+    PollCost rtu = PollCost::forRTU(19200);
+    PollCost tcp = PollCost::forTCP(Time::fromMilliseconds(1));
+};
+
+TEST_F(PollPlanTest, it_merges_adjacent_and_overlapping_points) {
+    PollPlan plan(driver, PollCost());
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10, 2);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 12, 4);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 14);
+    plan.compile();
+
+    auto requests = plan.getRequests();
+    ASSERT_EQ(1, requests.size());
+    ASSERT_EQ(10, requests[0].start);
+    ASSERT_EQ(6, requests[0].count);
+}
+
+TEST_F(PollPlanTest, it_does_not_bridge_gaps_with_a_null_request_overhead) {
+    PollPlan plan(driver, PollCost());
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 12);
+    plan.compile();
+    ASSERT_EQ(2, plan.getRequests().size());
+}
+
+TEST_F(PollPlanTest, it_bridges_small_gaps_on_RTU) {
+    PollPlan plan(driver, rtu);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 15);
+    plan.compile();
+
+    auto requests = plan.getRequests();
+    ASSERT_EQ(1, requests.size());
+    ASSERT_EQ(10, requests[0].start);
+    ASSERT_EQ(6, requests[0].count);
+}
+
+TEST_F(PollPlanTest, it_does_not_bridge_large_gaps_on_RTU) {
+    PollPlan plan(driver, rtu);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 50);
+    plan.compile();
+    ASSERT_EQ(2, plan.getRequests().size());
+}
+
+TEST_F(PollPlanTest, it_bridges_large_gaps_on_TCP) {
+    PollPlan plan(driver, tcp);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 50);
+    plan.compile();
+    ASSERT_EQ(1, plan.getRequests().size());
+}
+
+TEST_F(PollPlanTest, it_does_not_merge_points_of_different_slaves_or_tables) {
+    PollPlan plan(driver, tcp);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10);
+    plan.addPoint(2, TABLE_HOLDING_REGISTERS, 11);
+    plan.addPoint(1, TABLE_INPUT_REGISTERS, 11);
+    plan.addPoint(1, TABLE_COILS, 11);
+    plan.compile();
+    ASSERT_EQ(4, plan.getRequests().size());
+}
+
+TEST_F(PollPlanTest, it_cuts_requests_at_the_slave_max_block_size) {
+    driver.setMaxReadBlockSize(1, 20, 2000);
+
+    PollPlan plan(driver, tcp);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 0, 10);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 15, 10);
+    plan.compile();
+
+    auto requests = plan.getRequests();
+    ASSERT_EQ(2, requests.size());
+    ASSERT_EQ(0, requests[0].start);
+    ASSERT_EQ(10, requests[0].count);
+    ASSERT_EQ(15, requests[1].start);
+    ASSERT_EQ(10, requests[1].count);
+}
+
+TEST_F(PollPlanTest, it_accepts_a_point_that_spans_the_whole_table) {
+    PollPlan plan(driver, tcp);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 0, 65536);
+    plan.compile();
+
+    auto requests = plan.getRequests();
+    ASSERT_EQ(1, requests.size());
+    ASSERT_EQ(0, requests[0].start);
+    ASSERT_EQ(65536, requests[0].count);
+}
+
+TEST_F(PollPlanTest, it_rejects_a_point_that_extends_beyond_register_65536) {
+    PollPlan plan(driver, tcp);
+    ASSERT_THROW(plan.addPoint(1, TABLE_HOLDING_REGISTERS, 0xffff, 2),
+                 std::invalid_argument);
+    ASSERT_THROW(plan.addPoint(1, TABLE_HOLDING_REGISTERS, 0, 65537),
+                 std::invalid_argument);
+}
+
+TEST_F(PollPlanTest, it_rejects_a_bit_index_outside_of_the_point) {
+    PollPlan plan(driver, tcp);
+    size_t point = plan.addPoint(1, TABLE_COILS, 10, 2);
+    plan.addPoint(1, TABLE_COILS, 12, 2);
+    plan.compile();
+    ASSERT_THROW(plan.getBit(point, 2), std::out_of_range);
+    ASSERT_THROW(plan.getBit(point, -1), std::out_of_range);
+}
+
+TEST_F(PollPlanTest, it_estimates_the_cycle_duration) {
+    PollPlan plan(driver, rtu);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10, 2);
+    plan.addPoint(1, TABLE_HOLDING_REGISTERS, 100, 2);
+    plan.compile();
+    ASSERT_EQ(rtu.requestDuration(4) * 2, plan.getEstimatedCycleDuration());
+}
+
+TEST_F(PollPlanTest, it_throws_if_accessing_an_uncompiled_plan) {
+    PollPlan plan(driver, rtu);
+    size_t point = plan.addPoint(1, TABLE_HOLDING_REGISTERS, 10, 2);
+    ASSERT_THROW(plan.getRegisters(point), std::logic_error);
+    ASSERT_THROW(plan.poll(), std::logic_error);
+}
+
+TEST_F(PollPlanTest, it_polls_the_requests_into_the_image) {
+    driver.openURI("test://");
+
+    PollPlan plan(driver, tcp);
+    size_t reg0 = plan.addPoint(0x10, TABLE_HOLDING_REGISTERS, 0x100);
+    size_t reg1 = plan.addPoint(0x10, TABLE_HOLDING_REGISTERS, 0x102);
+    size_t coil = plan.addPoint(0x10, TABLE_COILS, 0x09, 2);
+    plan.compile();
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x01, 0, 0x09, 0, 2 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 4, 0x10, 0x01, 1, 0x02 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x03, 0x01, 0x00, 0, 3 },
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 9, 0x10, 0x03, 6,
+                         0x12, 0x34, 0, 0, 0x56, 0x78 }
+    );
+    ASSERT_TRUE(plan.poll().ok());
+    ASSERT_EQ(0x1234, plan.getRegisters(reg0)[0]);
+    ASSERT_EQ(0x5678, plan.getRegisters(reg1)[0]);
+    ASSERT_FALSE(plan.getBit(coil, 0));
+    ASSERT_TRUE(plan.getBit(coil, 1));
+}
+
+TEST_F(PollPlanTest, it_polls_the_last_register) {
+    driver.openURI("test://");
+
+    PollPlan plan(driver, tcp);
+    size_t reg = plan.addPoint(0x10, TABLE_HOLDING_REGISTERS, 0xffff);
+    plan.compile();
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0xff, 0xff, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x34 }
+    );
+    ASSERT_TRUE(plan.poll().ok());
+    ASSERT_EQ(0x1234, plan.getRegisters(reg)[0]);
+}
+
+TEST_F(PollPlanTest, it_continues_polling_after_a_failed_request) {
+    driver.openURI("test://");
+
+    PollPlan plan(driver, tcp);
+    size_t coil = plan.addPoint(0x10, TABLE_COILS, 0x09);
+    size_t reg = plan.addPoint(0x10, TABLE_HOLDING_REGISTERS, 0x100);
+    plan.compile();
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x01, 0, 0x09, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 3, 0x10, 0x81, 2 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x03, 0x01, 0x00, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x34 }
+    );
+    Result result = plan.poll();
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, result.code);
+    ASSERT_EQ(0x1234, plan.getRegisters(reg)[0]);
+
+    auto const& request = plan.getRequests()[plan.getPoints()[coil].request];
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, request.result.code);
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <modbus/PollScheduler.hpp>
+#include <modbus/TCPMaster.hpp>
+#include <thread>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+struct PollSchedulerTest : public ::testing::Test {
+    TCPMaster master;
+    PollScheduler scheduler;
+    vector<int> order;
+
+    PollSchedulerTest()
+        : master(256)
+        , scheduler(master) {
+    }
+
+    PollScheduler::Job record(int id, Result result = Result()) {
+        return [this, id, result](MasterInterface&) {
+            order.push_back(id);
+            return result;
+        };
+    }
+};
+
+TEST_F(PollSchedulerTest, it_runs_the_job_with_the_earliest_deadline_first) {
+    scheduler.addPeriodicJob(record(0), Time::fromSeconds(1));
+    scheduler.addPeriodicJob(record(1), Time::fromMilliseconds(20));
+    scheduler.addPeriodicJob(record(2), Time::fromSeconds(1), Time::fromMilliseconds(100));
+
+    while (scheduler.runOnce());
+    ASSERT_EQ((vector<int>{ 1, 2, 0 }), order);
+}
+
+TEST_F(PollSchedulerTest, it_does_not_run_a_job_before_its_next_release) {
+    scheduler.addPeriodicJob(record(0), Time::fromSeconds(1));
+    ASSERT_TRUE(scheduler.runOnce());
+    ASSERT_FALSE(scheduler.runOnce());
+    ASSERT_EQ(1, scheduler.getJobStats(0).runs);
+}
+
+TEST_F(PollSchedulerTest, it_runs_urgent_jobs_before_periodic_jobs) {
+    scheduler.addPeriodicJob(record(0), Time::fromMilliseconds(20));
+    scheduler.enqueueUrgent(record(1));
+    scheduler.enqueueUrgent(record(2));
+
+    while (scheduler.runOnce());
+    ASSERT_EQ((vector<int>{ 1, 2, 0 }), order);
+    ASSERT_EQ(2, scheduler.getUrgentStats().runs);
+}
+
+TEST_F(PollSchedulerTest, it_counts_errors) {
+    scheduler.addPeriodicJob(record(0, Result(RESULT_TIMEOUT, "timeout")),
+                             Time::fromSeconds(1));
+    scheduler.runOnce();
+    ASSERT_EQ(1, scheduler.getJobStats(0).errors);
+}
+
+TEST_F(PollSchedulerTest, it_counts_deadline_misses) {
+    scheduler.addPeriodicJob(
+        [](MasterInterface&) {
+            this_thread::sleep_for(chrono::milliseconds(5));
+            return Result();
+        },
+        Time::fromSeconds(1), Time::fromMilliseconds(1)
+    );
+    scheduler.runOnce();
+    ASSERT_EQ(1, scheduler.getJobStats(0).deadline_misses);
+}
+
+TEST_F(PollSchedulerTest, it_skips_releases_whose_deadline_has_passed) {
+    scheduler.addPeriodicJob(
+        [](MasterInterface&) {
+            this_thread::sleep_for(chrono::milliseconds(25));
+            return Result();
+        },
+        Time::fromMilliseconds(10)
+    );
+    scheduler.runOnce();
+    // The first release is late and the one at 10ms is skipped. The one at
+    // 20ms can still make its deadline
+    ASSERT_EQ(2, scheduler.getJobStats(0).deadline_misses);
+    ASSERT_TRUE(scheduler.runOnce());
+    ASSERT_EQ(2, scheduler.getJobStats(0).runs);
+}
+
+TEST_F(PollSchedulerTest, it_runs_periodic_jobs_until_the_given_time) {
+    scheduler.addPeriodicJob(record(0), Time::fromMilliseconds(10));
+    scheduler.runUntil(Time::now() + Time::fromMilliseconds(45));
+    ASSERT_GE(scheduler.getJobStats(0).runs, 4);
+    ASSERT_LE(scheduler.getJobStats(0).runs, 6);
+    ASSERT_EQ(0, scheduler.getJobStats(0).deadline_misses);
+}
+
+TEST_F(PollSchedulerTest, it_wakes_up_for_urgent_jobs_queued_from_another_thread) {
+    scheduler.addPeriodicJob(record(0), Time::fromSeconds(10));
+
+    thread producer([this]() {
+        this_thread::sleep_for(chrono::milliseconds(10));
+        scheduler.enqueueUrgent([this](MasterInterface&) {
+            scheduler.stop();
+            return Result();
+        });
+    });
+    Time start = Time::now();
+    scheduler.run();
+    producer.join();
+
+    ASSERT_LT(Time::now() - start, Time::fromSeconds(1));
+    ASSERT_EQ(1, scheduler.getUrgentStats().runs);
+}
+
+TEST_F(PollSchedulerTest, it_does_not_run_if_stopped_before_run_is_called) {
+    scheduler.addPeriodicJob(record(0), Time::fromMilliseconds(10));
+    scheduler.stop();
+    scheduler.run();
+    ASSERT_EQ(0, scheduler.getJobStats(0).runs);
+}
+
+TEST_F(PollSchedulerTest, it_runs_again_after_a_restart) {
+    scheduler.addPeriodicJob(record(0), Time::fromMilliseconds(10));
+    scheduler.stop();
+    scheduler.restart();
+    scheduler.runUntil(Time::now() + Time::fromMilliseconds(5));
+    ASSERT_EQ(1, scheduler.getJobStats(0).runs);
+}
+
+TEST_F(PollSchedulerTest, it_schedules_the_next_release_of_a_job_that_throws) {
+    scheduler.addPeriodicJob(
+        [](MasterInterface&) -> Result { throw std::runtime_error("job failed"); },
+        Time::fromSeconds(1)
+    );
+    ASSERT_THROW(scheduler.runOnce(), std::runtime_error);
+    ASSERT_FALSE(scheduler.runOnce());
+
+    auto const& stats = scheduler.getJobStats(0);
+    ASSERT_EQ(1, stats.runs);
+    ASSERT_EQ(1, stats.errors);
+    ASSERT_EQ(1, stats.deadline_misses);
+}
+
+TEST_F(PollSchedulerTest, it_counts_urgent_jobs_that_throw_as_errors) {
+    scheduler.enqueueUrgent(
+        [](MasterInterface&) -> Result { throw std::runtime_error("job failed"); }
+    );
+    ASSERT_THROW(scheduler.runOnce(), std::runtime_error);
+    ASSERT_FALSE(scheduler.runOnce());
+    ASSERT_EQ(1, scheduler.getUrgentStats().runs);
+    ASSERT_EQ(1, scheduler.getUrgentStats().errors);
+}
+
+TEST_F(PollSchedulerTest, it_reports_the_bus_utilization) {
+    scheduler.addPeriodicJob(
+        [](MasterInterface&) {
+            this_thread::sleep_for(chrono::milliseconds(5));
+            return Result();
+        },
+        Time::fromMilliseconds(10)
+    );
+    scheduler.resetStatistics();
+    scheduler.runUntil(Time::now() + Time::fromMilliseconds(100));
+
+    double utilization = scheduler.getBusUtilization();
+    ASSERT_GT(utilization, 0.3);
+    ASSERT_LT(utilization, 0.8);
+}
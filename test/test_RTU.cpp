@@ -19,6 +19,104 @@ TEST_F(RTUTest, it_computes_the_CRC) {
     ASSERT_EQ(0xDD, crc[1]);
 }
 
+TEST_F(RTUTest, it_computes_the_same_CRC_with_all_implementations) {
+    std::vector<uint8_t> bytes(1024);
+    for (auto& b : bytes) {
+        b = rand();
+    }
+
+    for (size_t length = 0; length < bytes.size(); ++length) {
+        uint8_t const* start = &bytes[0];
+        uint8_t const* end = start + length;
+        uint16_t expected = RTU::updateCRCBitwise(RTU::CRC_INITIAL_VALUE, start, end);
+        ASSERT_EQ(expected, RTU::updateCRCTable(RTU::CRC_INITIAL_VALUE, start, end));
+        ASSERT_EQ(expected, RTU::updateCRCSlicingBy8(RTU::CRC_INITIAL_VALUE, start, end));
+        ASSERT_EQ(expected, RTU::updateCRC(RTU::CRC_INITIAL_VALUE, start, end));
+    }
+}
+
+TEST_F(RTUTest, it_computes_the_same_CRC_with_carryless_multiplication_than_bitwise) {
+    std::vector<uint8_t> bytes(2048 + 16);
+    for (auto& b : bytes) {
+        b = rand();
+    }
+
+    for (size_t offset = 0; offset < 16; ++offset) {
+        for (size_t length = 0; length <= 2048; ++length) {
+            uint16_t initial = rand();
+            uint8_t const* start = &bytes[offset];
+            uint8_t const* end = start + length;
+            ASSERT_EQ(RTU::updateCRCBitwise(initial, start, end),
+                      RTU::updateCRCCarrylessMultiply(initial, start, end))
+                << "offset=" << offset << " length=" << length;
+        }
+    }
+}
+
+TEST_F(RTUTest, it_computes_the_CRC_of_a_multi_megabyte_buffer) {
+    std::vector<uint8_t> bytes(4 * 1024 * 1024 + 7);
+    for (auto& b : bytes) {
+        b = rand();
+    }
+
+    uint8_t const* start = &bytes[0];
+    uint8_t const* end = start + bytes.size();
+    uint16_t expected = RTU::updateCRCBitwise(RTU::CRC_INITIAL_VALUE, start, end);
+    ASSERT_EQ(expected, RTU::updateCRCCarrylessMultiply(RTU::CRC_INITIAL_VALUE, start, end));
+    ASSERT_EQ(expected, RTU::updateCRC(RTU::CRC_INITIAL_VALUE, start, end));
+}
+
+TEST_F(RTUTest, it_updates_a_running_CRC) {
+    uint8_t bytes[] = { 1, 2, 3, 4, 5, 6 };
+    uint16_t crc = RTU::updateCRC(RTU::CRC_INITIAL_VALUE, bytes, bytes + 2);
+    crc = RTU::updateCRC(crc, bytes + 2, bytes + 6);
+    ASSERT_EQ(0xDDBA, crc);
+}
+
+TEST_F(RTUTest, it_computes_the_CRC_incrementally) {
+    uint8_t bytes[] = { 1, 2, 3, 4, 5, 6 };
+    RTU::CRCState crc;
+    crc.update(bytes[0]);
+    crc.update(bytes + 1, bytes + 6);
+    ASSERT_EQ(0xDDBA, crc.value());
+    ASSERT_EQ(0xBA, crc.bytes()[0]);
+    ASSERT_EQ(0xDD, crc.bytes()[1]);
+}
+
+TEST_F(RTUTest, it_validates_a_frame_fed_incrementally) {
+    uint8_t frame[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    RTU::CRCState crc;
+    for (uint8_t byte : frame) {
+        ASSERT_FALSE(crc.isValid());
+        crc.update(byte);
+    }
+    ASSERT_TRUE(crc.isValid());
+}
+
+TEST_F(RTUTest, it_detects_an_invalid_CRC_fed_incrementally) {
+    uint8_t frame[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEA };
+    RTU::CRCState crc;
+    crc.update(frame, frame + 9);
+    ASSERT_FALSE(crc.isValid());
+}
+
+TEST_F(RTUTest, it_resets_the_CRC_state) {
+    uint8_t frame[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    RTU::CRCState crc;
+    crc.update(frame, frame + 4);
+    crc.reset();
+    crc.update(frame, frame + 9);
+    ASSERT_TRUE(crc.isValid());
+}
+
+TEST_F(RTUTest, it_parses_a_frame_using_a_precomputed_CRC_state) {
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEA };
+    RTU::CRCState crc;
+    crc.update(bytes, bytes + 9);
+    Frame frame;
+    ASSERT_THROW(RTU::parseFrame(frame, bytes, bytes + 9, crc), RTU::InvalidCRC);
+}
+
 TEST_F(RTUTest, it_computes_the_interframe_timeout_for_bitrates_smaller_than_19200) {
     auto time = RTU::interframeDuration(9600);
     ASSERT_EQ(4011, time.toMicroseconds());
@@ -63,6 +161,64 @@ TEST_F(RTUTest, it_parses_a_frame) {
     ASSERT_THAT(frame.payload, ElementsAreArray(payload));
 }
 
+TEST_F(RTUTest, it_parses_a_frame_into_a_view_without_copying_the_payload) {
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    FrameView frame;
+    RTU::parseFrame(frame, bytes, bytes + 9);
+    ASSERT_EQ(0x02, frame.address);
+    ASSERT_EQ(0x10, frame.function);
+    ASSERT_EQ(bytes + 2, frame.payload);
+    ASSERT_EQ(5, frame.payload_size);
+}
+
+TEST_F(RTUTest, it_parses_a_frame_into_a_static_frame) {
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    RTU::StaticFrame frame;
+    RTU::parseFrame(frame, bytes, bytes + 9);
+    ASSERT_EQ(0x02, frame.address);
+    ASSERT_EQ(0x10, frame.function);
+
+    uint8_t payload[5] = { 1, 2, 3, 4, 5 };
+    ASSERT_THAT(vector<uint8_t>(frame.payload.begin(),
+                                frame.payload.begin() + frame.payload_size),
+                ElementsAreArray(payload));
+}
+
+TEST_F(RTUTest, it_throws_if_the_payload_does_not_fit_in_the_static_frame) {
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    StaticFrame<4> frame;
+    ASSERT_THROW(RTU::parseFrame(frame, bytes, bytes + 9), std::length_error);
+}
+
+TEST_F(RTUTest, it_throws_if_the_CRC_check_fails_while_parsing_into_a_view) {
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEA };
+    FrameView frame;
+    ASSERT_THROW(RTU::parseFrame(frame, bytes, bytes + 9), RTU::InvalidCRC);
+}
+
+TEST_F(RTUTest, it_reports_an_invalid_CRC_without_throwing) {
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEA };
+    FrameView frame;
+    Result result = RTU::tryParseFrame(frame, bytes, bytes + 9);
+    ASSERT_EQ(RESULT_INVALID_CRC, result.code);
+}
+
+TEST_F(RTUTest, it_reports_a_buffer_too_small_without_throwing) {
+    uint8_t bytes[3] = { 0x02, 0x10, 1 };
+    FrameView frame;
+    Result result = RTU::tryParseFrame(frame, bytes, bytes + 3);
+    ASSERT_EQ(RESULT_TOO_SMALL, result.code);
+}
+
+TEST_F(RTUTest, it_parses_a_valid_frame_with_the_non_throwing_API) {
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    FrameView frame;
+    ASSERT_TRUE(RTU::tryParseFrame(frame, bytes, bytes + 9).ok());
+    ASSERT_EQ(0x02, frame.address);
+    ASSERT_EQ(0x10, frame.function);
+    ASSERT_EQ(5, frame.payload_size);
+}
+
 TEST_F(RTUTest, it_throws_if_attempting_to_parse_a_buffer_that_is_too_small) {
     uint8_t bytes[0];
     ASSERT_THROW(RTU::parseFrame(bytes, bytes + 3), RTU::TooSmall);
@@ -113,8 +269,18 @@ TEST_F(RTUTest, it_formats_a_read_input_registers_command) {
                 ElementsAreArray(expected));
 }
 
+TEST_F(RTUTest, it_formats_a_read_of_the_last_register) {
+    uint8_t buffer[8];
+    uint8_t* end = RTU::formatReadRegisters(buffer, 0x10, false, 0xffff, 1);
+    ASSERT_EQ(end - buffer, 8);
+
+    uint8_t expected[] = { 0x10, 0x03, 0xff, 0xff, 0x00, 0x01 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end - 2),
+                ElementsAreArray(expected));
+}
+
 TEST_F(RTUTest, it_throws_if_attempting_to_read_beyond_register_65536) {
-    ASSERT_THROW(RTU::formatReadRegisters(nullptr, 0x10, false, 0xfffe, 2),
+    ASSERT_THROW(RTU::formatReadRegisters(nullptr, 0x10, false, 0xffff, 2),
                  std::invalid_argument);
 }
 
@@ -131,4 +297,126 @@ TEST_F(RTUTest, it_formats_a_single_register_write) {
     uint8_t expected[] = { 0x10, 0x06, 0x10, 0x20, 0x11, 0x21 };
     ASSERT_THAT(std::vector<uint8_t>(buffer, end - 2),
                 ElementsAreArray(expected));
+}
+
+TEST_F(RTUTest, it_formats_a_write_multiple_registers_request) {
+    uint8_t buffer[256];
+    uint16_t values[] = { 0x1234, 0x5678 };
+    uint8_t* end = RTU::formatWriteRegisters(buffer, 0x10, 0xabcd, values, 2);
+
+    uint8_t expected[] = { 0x10, 0x10, 0xab, 0xcd, 0x00, 0x02, 0x04,
+                           0x12, 0x34, 0x56, 0x78, 0x9e, 0x59 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(RTUTest, it_throws_if_attempting_to_write_more_registers_than_fit_in_a_frame) {
+    uint8_t buffer[256];
+    uint16_t values[124];
+    ASSERT_THROW(RTU::formatWriteRegisters(buffer, 0x10, 0, values, 124),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_throws_if_attempting_to_write_beyond_the_last_register) {
+    uint8_t buffer[256];
+    uint16_t values[2];
+    ASSERT_THROW(RTU::formatWriteRegisters(buffer, 0x10, 0xffff, values, 2),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_formats_a_write_multiple_coils_request_from_packed_bits) {
+    uint8_t buffer[256];
+    uint8_t bits[] = { 0xcd, 0xfd };
+    uint8_t* end = RTU::formatWriteCoils(buffer, 0x10, 0x13, bits, 10);
+
+    uint8_t expected[] = { 0x10, 0x0f, 0x00, 0x13, 0x00, 0x0a, 0x02, 0xcd, 0x01,
+                           0xb2, 0x9b };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(RTUTest, it_formats_a_write_multiple_coils_request_from_booleans) {
+    uint8_t buffer[256];
+    vector<bool> values = { true, false, true, true, false, false, true, true,
+                            true, false };
+    uint8_t* end = RTU::formatWriteCoils(buffer, 0x10, 0x13, values);
+
+    uint8_t expected[] = { 0x10, 0x0f, 0x00, 0x13, 0x00, 0x0a, 0x02, 0xcd, 0x01,
+                           0xb2, 0x9b };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(RTUTest, it_throws_if_attempting_to_write_more_coils_than_fit_in_a_frame) {
+    uint8_t buffer[256];
+    uint8_t bits[247];
+    ASSERT_THROW(RTU::formatWriteCoils(buffer, 0x10, 0, bits, 1969),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_formats_a_read_write_multiple_registers_request) {
+    uint8_t buffer[256];
+    uint16_t values[] = { 0x00ff };
+    uint8_t* end = RTU::formatReadWriteRegisters(buffer, 0x11, 0x03, 2, 0x0e, values, 1);
+
+    uint8_t expected[] = { 0x11, 0x17, 0x00, 0x03, 0x00, 0x02, 0x00, 0x0e, 0x00, 0x01,
+                           0x02, 0x00, 0xff, 0x9b, 0x4a };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(RTUTest, it_throws_if_a_read_write_request_writes_more_registers_than_allowed) {
+    uint8_t buffer[256];
+    uint16_t values[122];
+    ASSERT_THROW(RTU::formatReadWriteRegisters(buffer, 0x11, 0, 2, 0, values, 122),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_throws_if_a_read_write_request_reads_more_registers_than_allowed) {
+    uint8_t buffer[256];
+    uint16_t values[1];
+    ASSERT_THROW(RTU::formatReadWriteRegisters(buffer, 0x11, 0, 126, 0, values, 1),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_formats_a_mask_write_register_request) {
+    uint8_t buffer[256];
+    uint8_t* end = RTU::formatMaskWriteRegister(buffer, 0x11, 0x04, 0x00f2, 0x0025);
+
+    uint8_t expected[] = { 0x11, 0x16, 0x00, 0x04, 0x00, 0xf2, 0x00, 0x25,
+                           0x66, 0xe2 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(RTUTest, it_throws_if_attempting_to_read_more_than_125_registers) {
+    uint8_t buffer[256];
+    ASSERT_THROW(RTU::formatReadRegisters(buffer, 0x10, false, 0, 126),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_throws_if_attempting_to_read_more_than_2000_digital_inputs) {
+    uint8_t buffer[256];
+    ASSERT_THROW(RTU::formatReadDigitalInputs(buffer, 0x10, false, 0, 2001),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_throws_if_attempting_to_read_beyond_input_65536) {
+    uint8_t buffer[256];
+    ASSERT_THROW(RTU::formatReadDigitalInputs(buffer, 0x10, false, 0xfff0, 17),
+                 std::invalid_argument);
+}
+
+TEST_F(RTUTest, it_predicts_the_length_of_a_read_reply_from_its_byte_count) {
+    uint8_t prefix[] = { 0x10, 0x03, 0x04 };
+    ASSERT_EQ(9, RTU::predictReplyLength(prefix));
+}
+
+TEST_F(RTUTest, it_predicts_the_length_of_write_and_exception_replies) {
+    uint8_t write_register[] = { 0x10, 0x06, 0x00 };
+    ASSERT_EQ(8, RTU::predictReplyLength(write_register));
+    uint8_t mask_write[] = { 0x10, 0x16, 0x00 };
+    ASSERT_EQ(10, RTU::predictReplyLength(mask_write));
+    uint8_t exception[] = { 0x10, 0x83, 0x02 };
+    ASSERT_EQ(5, RTU::predictReplyLength(exception));
+}
+
+TEST_F(RTUTest, it_does_not_predict_the_length_of_unknown_functions) {
+    uint8_t prefix[] = { 0x10, 0x2b, 0x0e };
+    ASSERT_EQ(0, RTU::predictReplyLength(prefix));
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <modbus/Exceptions.hpp>
 #include <iodrivers_base/FixtureGTest.hpp>
 #include <fcntl.h>
+#include <sys/socket.h>
 #include <thread>
 
 using namespace std;
@@ -90,6 +91,36 @@ TEST_F(RTUMasterTest, it_does_a_modbus_request) {
     ASSERT_THAT(f.payload, ElementsAreArray(expected));
 }
 
+TEST_F(RTUMasterTest, it_returns_a_view_on_a_reply_within_its_read_buffer) {
+    driver.openURI("test://");
+
+    uint8_t reply[] = { 0x02, 0x10, 6, 7, 8, 9, 0xB6, 0xB5 };
+    pushDataToDriver(reply, reply + 8);
+
+    FrameView f;
+    driver.readReply(f, 0x10);
+    ASSERT_EQ(0x02, f.address);
+    ASSERT_EQ(0x10, f.function);
+    uint8_t expected[] = { 6, 7, 8, 9 };
+    ASSERT_THAT(vector<uint8_t>(f.payload, f.payload + f.payload_size),
+                ElementsAreArray(expected));
+}
+
+TEST_F(RTUMasterTest, it_reads_a_reply_into_a_static_frame) {
+    driver.openURI("test://");
+
+    uint8_t reply[] = { 0x02, 0x10, 6, 7, 8, 9, 0xB6, 0xB5 };
+    pushDataToDriver(reply, reply + 8);
+
+    RTU::StaticFrame f;
+    driver.readReply(f, 0x10);
+    ASSERT_EQ(0x02, f.address);
+    ASSERT_EQ(0x10, f.function);
+    uint8_t expected[] = { 6, 7, 8, 9 };
+    ASSERT_THAT(vector<uint8_t>(f.payload.begin(), f.payload.begin() + f.payload_size),
+                ElementsAreArray(expected));
+}
+
 TEST_F(RTUMasterTest, it_throws_if_receiving_an_unexpected_function_code_in_reply) {
     driver.openURI("test://");
 
@@ -158,6 +189,55 @@ TEST_F(RTUMasterTest, it_retries_on_CRC_error) {
               driver.readRegisters(0x10, false, 0xabcd, 2));
 }
 
+TEST_F(RTUMasterTest, it_retries_on_CRC_error_with_the_non_throwing_API) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0xab, 0xcd, 0x00, 0x02, 0x76, 0x91 },
+        vector<uint8_t>{ 0x10, 0x03, 0x4, 0x12, 0x34, 0x56, 0x78, 0x80, 0x07 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0xab, 0xcd, 0x00, 0x02, 0x76, 0x91 },
+        vector<uint8_t>{ 0x10, 0x03, 0x4, 0x12, 0x34, 0x56, 0x78, 0x80, 0x06 }
+    );
+    uint16_t values[2];
+    ASSERT_TRUE(driver.tryReadRegisters(values, 0x10, false, 0xabcd, 2).ok());
+    ASSERT_EQ(0x1234, values[0]);
+    ASSERT_EQ(0x5678, values[1]);
+}
+
+TEST_F(RTUMasterTest, it_reports_a_permanent_CRC_error_with_the_non_throwing_API) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0xab, 0xcd, 0x00, 0x02, 0x76, 0x91 },
+        vector<uint8_t>{ 0x10, 0x03, 0x4, 0x12, 0x34, 0x56, 0x78, 0x80, 0x07 }
+    );
+    driver.setReadTimeout(Time());
+    uint16_t values[2];
+    Result result = driver.tryReadRegisters(values, 0x10, false, 0xabcd, 2);
+    ASSERT_EQ(RESULT_INVALID_CRC, result.code);
+}
+
+TEST_F(RTUMasterTest, it_reports_an_exception_reply_with_the_non_throwing_API) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    uint8_t request[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    uint8_t reply[] = { 0x02, 0x90, 0x01, 0x7D, 0xC0 };
+    EXPECT_REPLY(vector<uint8_t>(request, request + 9),
+                 vector<uint8_t>(reply, reply + 5));
+
+    driver.writePacket(request, 9);
+    FrameView frame;
+    Result result = driver.tryReadReply(frame, 0x10);
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, result.code);
+    ASSERT_EQ(0x10, result.function_code);
+    ASSERT_EQ(0x01, result.exception_code);
+}
+
 TEST_F(RTUMasterTest, it_accounts_for_invalid_data) {
     driver.openURI("test://");
 
@@ -235,6 +315,21 @@ TEST_F(RTUMasterTest, it_reads_multiple_coils) {
     ASSERT_THAT(values, ElementsAreArray(expected));
 }
 
+TEST_F(RTUMasterTest, it_reads_multiple_coils_into_packed_bits) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x01, 0x12, 0x34, 0x00, 0x09, 0xbb, 0xfb },
+        vector<uint8_t>{ 0x10, 0x01, 0x02, 0xab, 0xcd, 0xfb, 0x5a }
+    );
+    uint8_t bits[2];
+    driver.readDigitalInputs(bits, 0x10, true, 0x1234, 9);
+
+    ASSERT_EQ(0xab, bits[0]);
+    ASSERT_EQ(0x01, bits[1]);
+}
+
 TEST_F(RTUMasterTest, it_reads_multiple_digital_inputs) {
     driver.openURI("test://");
 
@@ -270,4 +365,296 @@ TEST_F(RTUMasterTest, it_does_a_coil_OFF_write_request) {
         vector<uint8_t>{ 0x10, 0x05, 0x12, 0x34, 0x00, 0x00, 0x8a, 0x3d }
     );
     driver.writeSingleCoil(0x10, 0x1234, false);
-}
\ No newline at end of file
+}
+
+TEST_F(RTUMasterTest, it_writes_multiple_registers) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x10, 0xab, 0xcd, 0x00, 0x02, 0x04,
+                         0x12, 0x34, 0x56, 0x78, 0x9e, 0x59 },
+        vector<uint8_t>{ 0x10, 0x10, 0xab, 0xcd, 0x00, 0x02, 0xf3, 0x52 }
+    );
+    uint16_t values[] = { 0x1234, 0x5678 };
+    driver.writeRegisters(0x10, 0xabcd, values, 2);
+}
+
+TEST_F(RTUMasterTest, it_writes_multiple_coils) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x0f, 0x00, 0x13, 0x00, 0x0a, 0x02, 0xcd, 0x01,
+                         0xb2, 0x9b },
+        vector<uint8_t>{ 0x10, 0x0f, 0x00, 0x13, 0x00, 0x0a, 0x27, 0x48 }
+    );
+    vector<bool> values = { true, false, true, true, false, false, true, true,
+                            true, false };
+    driver.writeCoils(0x10, 0x13, values);
+}
+
+TEST_F(RTUMasterTest, it_writes_and_reads_registers_in_a_single_transaction) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x11, 0x17, 0x00, 0x03, 0x00, 0x02, 0x00, 0x0e, 0x00, 0x01,
+                         0x02, 0x00, 0xff, 0x9b, 0x4a },
+        vector<uint8_t>{ 0x11, 0x17, 0x04, 0x12, 0x34, 0x56, 0x78, 0x93, 0xd2 }
+    );
+    uint16_t write_values[] = { 0x00ff };
+    uint16_t read_values[2];
+    driver.readWriteRegisters(read_values, 0x11, 0x03, 2, 0x0e, write_values, 1);
+    ASSERT_EQ(0x1234, read_values[0]);
+    ASSERT_EQ(0x5678, read_values[1]);
+}
+
+TEST_F(RTUMasterTest, it_modifies_a_register_with_a_mask_write) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x11, 0x16, 0x00, 0x04, 0x00, 0xf2, 0x00, 0x25, 0x66, 0xe2 },
+        vector<uint8_t>{ 0x11, 0x16, 0x00, 0x04, 0x00, 0xf2, 0x00, 0x25, 0x66, 0xe2 }
+    );
+    driver.maskWriteRegister(0x11, 0x04, 0x00f2, 0x0025);
+}
+
+TEST_F(RTUMasterTest, it_validates_a_reply_received_in_several_chunks) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0x00, 0x00, 0x00, 0x0a, 0xc6, 0x8c },
+        vector<uint8_t>{ 0x10, 0x03, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x02,
+                         0x00, 0x03, 0x00, 0x04, 0x00, 0x05, 0x00, 0x06, 0x00, 0x07,
+                         0x00, 0x08, 0x00, 0x09, 0xcd, 0xc1 }
+    );
+    auto values = driver.readRegisters(0x10, false, 0, 10);
+    ASSERT_EQ((vector<uint16_t>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }), values);
+}
+
+TEST_F(RTUMasterTest, it_rejects_empty_reads) {
+    driver.openURI("test://");
+
+    uint16_t values[1];
+    uint8_t bits[1];
+    ASSERT_THROW(driver.tryReadRegisters(values, 0x10, false, 0, 0), std::invalid_argument);
+    ASSERT_THROW(driver.tryReadDigitalInputs(bits, 0x10, true, 0, 0), std::invalid_argument);
+}
+
+TEST_F(RTUMasterTest, it_splits_register_reads_according_to_the_slave_block_size) {
+    driver.openURI("test://");
+    driver.setMaxReadBlockSize(0x10, 1, 8);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0xab, 0xcd, 0x00, 0x01, 0x36, 0x90 },
+        vector<uint8_t>{ 0x10, 0x03, 0x02, 0x12, 0x34, 0x49, 0x30 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0xab, 0xce, 0x00, 0x01, 0xc6, 0x90 },
+        vector<uint8_t>{ 0x10, 0x03, 0x02, 0x56, 0x78, 0x7b, 0xc5 }
+    );
+    auto values = driver.readRegisters(0x10, false, 0xabcd, 2);
+    ASSERT_EQ(2, values.size());
+    ASSERT_EQ(0x1234, values[0]);
+    ASSERT_EQ(0x5678, values[1]);
+}
+
+TEST_F(RTUMasterTest, it_executes_a_batch_and_reports_the_status_of_each_request) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0x00, 0x01, 0x00, 0x02, 0x96, 0x8a },
+        vector<uint8_t>{ 0x10, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78, 0x80, 0x06 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x10, 0xab, 0xcd, 0x00, 0x02, 0x04,
+                         0x12, 0x34, 0x56, 0x78, 0x9e, 0x59 },
+        vector<uint8_t>{ 0x10, 0x90, 0x02, 0x9d, 0xc4 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x10, 0xab, 0xcd, 0x00, 0x02, 0x04,
+                         0x12, 0x34, 0x56, 0x78, 0x9e, 0x59 },
+        vector<uint8_t>{ 0x10, 0x10, 0xab, 0xcd, 0x00, 0x02, 0xf3, 0x52 }
+    );
+
+    uint16_t read[2];
+    uint16_t written[] = { 0x1234, 0x5678 };
+    BatchRequest batch[] = {
+        BatchRequest::readRegisters(read, 0x10, false, 1, 2),
+        BatchRequest::writeRegisters(0x10, 0xabcd, written, 2),
+        BatchRequest::writeRegisters(0x10, 0xabcd, written, 2)
+    };
+    ASSERT_EQ(1u, driver.execute(batch, 3));
+    ASSERT_EQ(RESULT_OK, batch[0].result.code);
+    ASSERT_EQ(0x1234, read[0]);
+    ASSERT_EQ(0x5678, read[1]);
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, batch[1].result.code);
+    ASSERT_EQ(0x02, batch[1].result.exception_code);
+    ASSERT_EQ(RESULT_OK, batch[2].result.code);
+}
+
+TEST_F(RTUMasterTest, it_rejects_an_invalid_batch_before_sending_any_request) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    uint16_t read[1];
+    uint16_t written[] = { 0x1234 };
+    BatchRequest batch[] = {
+        BatchRequest::readRegisters(read, 0x10, false, 1, 1),
+        BatchRequest::writeRegisters(0x10, 0xabcd, written, 0)
+    };
+    ASSERT_THROW(driver.execute(batch, 2), std::invalid_argument);
+}
+
+TEST_F(RTUMasterTest, it_ends_a_frame_at_its_predicted_length_without_waiting_for_silence) {
+    openPipe();
+
+    uint8_t bytes[] = { 0x10, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78, 0x80, 0x06 };
+    for (uint8_t byte : bytes) {
+        writeToPipe(&byte, 1);
+    }
+    driver.setInterframeDelay(Time::fromMilliseconds(500));
+    driver.setReadTimeout(Time::fromSeconds(1));
+    driver.setReplyLengthPrediction(true);
+
+    Time start = Time::now();
+    Frame f = driver.readFrame();
+    ASSERT_EQ(0x03, f.function);
+    ASSERT_EQ((vector<uint8_t>{ 0x04, 0x12, 0x34, 0x56, 0x78 }), f.payload);
+    ASSERT_LE(Time::now() - start, Time::fromMilliseconds(100));
+}
+
+TEST_F(RTUMasterTest, it_reads_until_silence_if_the_crc_is_invalid_at_the_predicted_length) {
+    openPipe();
+
+    // A multiple-write request, which is longer than the reply
+    uint8_t bytes[] = { 0x02, 0x10, 1, 2, 3, 4, 5, 0x34, 0xEB };
+    for (uint8_t byte : bytes) {
+        writeToPipe(&byte, 1);
+    }
+    driver.setInterframeDelay(Time::fromMilliseconds(10));
+    driver.setReplyLengthPrediction(true);
+
+    Frame f = driver.readFrame();
+    ASSERT_EQ(0x10, f.function);
+    ASSERT_EQ((vector<uint8_t>{ 1, 2, 3, 4, 5 }), f.payload);
+}
+
+TEST_F(RTUMasterTest, it_reads_until_silence_if_the_function_is_unknown) {
+    openPipe();
+
+    uint8_t bytes[] = { 0x02, 0x2b, 0x01, 0x02, 0x03, 0x44, 0x85 };
+    for (uint8_t byte : bytes) {
+        writeToPipe(&byte, 1);
+    }
+    driver.setInterframeDelay(Time::fromMilliseconds(10));
+    driver.setReplyLengthPrediction(true);
+
+    Frame f = driver.readFrame();
+    ASSERT_EQ(0x2b, f.function);
+    ASSERT_EQ((vector<uint8_t>{ 1, 2, 3 }), f.payload);
+}
+
+TEST_F(RTUMasterTest, it_does_not_read_past_the_predicted_length) {
+    driver.openURI("test://");
+    driver.setReplyLengthPrediction(true);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0x10, 0x03, 0x00, 0x01, 0x00, 0x02, 0x96, 0x8a },
+        vector<uint8_t>{ 0x10, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78, 0x80, 0x06,
+                         0x10, 0x03 }
+    );
+    auto values = driver.readRegisters(0x10, false, 1, 2);
+    ASSERT_EQ((vector<uint16_t>{ 0x1234, 0x5678 }), values);
+}
+
+TEST_F(RTUMasterTest, it_learns_the_reply_timeout_of_each_slave) {
+    driver.openURI("test://");
+    driver.setAdaptiveTimeouts(true);
+    TimeoutEstimator const& estimator = driver.getTimeoutEstimator();
+
+    IODRIVERS_BASE_MOCK();
+    vector<uint8_t> request = { 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34, 0x36, 0x27 };
+    for (int i = 0; i < TimeoutEstimator::MIN_SAMPLES; ++i) {
+        EXPECT_REPLY(request, request);
+        driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    }
+    ASSERT_EQ(8u, estimator.getSampleCount(0x10, FUNCTION_WRITE_SINGLE_REGISTER));
+    Time timeout = estimator.getTimeout(0x10, FUNCTION_WRITE_SINGLE_REGISTER);
+    ASSERT_LT(timeout, Time::fromMilliseconds(100));
+
+    EXPECT_REPLY(request, vector<uint8_t>{});
+    ASSERT_THROW(driver.writeSingleRegister(0x10, 0xabcd, 0x1234),
+                 iodrivers_base::TimeoutError);
+    ASSERT_GT(estimator.getTimeout(0x10, FUNCTION_WRITE_SINGLE_REGISTER), timeout);
+}
+
+TEST_F(RTUMasterTest, it_measures_the_turnaround_up_to_the_first_byte_of_the_reply) {
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    long fd_flags = fcntl(sockets[0], F_GETFL);
+    fcntl(sockets[0], F_SETFL, fd_flags | O_NONBLOCK);
+    driver.setFileDescriptor(sockets[0], true);
+    pipeTX = sockets[1];
+
+    driver.setInterframeDelay(Time::fromMilliseconds(10));
+    driver.setAdaptiveTimeouts(true);
+
+    // Reply immediately, but send the reply slowly
+    uint8_t reply[] = { 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34, 0x36, 0x27 };
+    thread slave([this, &reply]{
+        uint8_t request[8];
+        ASSERT_EQ(read(pipeTX, request, 8), 8);
+        for (uint8_t i = 0; i < 8; ++i) {
+            writeToPipe(reply + i, 1);
+            usleep(5000);
+        }
+    });
+    driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    slave.join();
+
+    Time turnaround = driver.getTimeoutEstimator().getAverageTurnaround(
+        0x10, FUNCTION_WRITE_SINGLE_REGISTER
+    );
+    ASSERT_LT(turnaround, Time::fromMilliseconds(20));
+}
+
+TEST_F(RTUMasterTest, it_leaves_the_interframe_silence_after_a_predicted_reply) {
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    long fd_flags = fcntl(sockets[0], F_GETFL);
+    fcntl(sockets[0], F_SETFL, fd_flags | O_NONBLOCK);
+    driver.setFileDescriptor(sockets[0], true);
+    pipeTX = sockets[1];
+
+    driver.setInterframeDelay(Time::fromMilliseconds(500));
+    driver.setInterframeSilence(Time::fromMilliseconds(50));
+    driver.setReplyLengthPrediction(true);
+
+    uint8_t reply[] = { 0x10, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78, 0x80, 0x06 };
+    Time reply_start;
+    Time second_request;
+    thread slave([this, &reply, &reply_start, &second_request]{
+        uint8_t request[8];
+        ASSERT_EQ(read(pipeTX, request, 8), 8);
+        reply_start = Time::now();
+        ASSERT_EQ(write(pipeTX, reply, 9), 9);
+        ASSERT_EQ(read(pipeTX, request, 8), 8);
+        second_request = Time::now();
+        ASSERT_EQ(write(pipeTX, reply, 9), 9);
+    });
+
+    Time start = Time::now();
+    driver.readRegisters(0x10, false, 1, 2);
+    driver.readRegisters(0x10, false, 1, 2);
+    slave.join();
+
+    ASSERT_GE(second_request - reply_start, Time::fromMilliseconds(50));
+    ASSERT_LT(Time::now() - start, Time::fromMilliseconds(500));
+}
@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+#include <modbus/ReadCoalescer.hpp>
+#include <modbus/TCPMaster.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace modbus;
+
+/** Master that fills registers and bits from their address, and blocks each
+ * read until the test releases it
+ */
+struct CoalescerMaster : public TCPMaster {
+    mutex lock;
+    condition_variable signal;
+    int released = 0;
+    vector<pair<int, int>> reads;
+    Result result;
+
+    CoalescerMaster()
+        : TCPMaster(256) {
+    }
+
+    void block(int start, int length) {
+        unique_lock<mutex> guard(lock);
+        int index = reads.size();
+        reads.push_back(make_pair(start, length));
+        signal.notify_all();
+        signal.wait(guard, [&]() { return released > index; });
+    }
+
+    void release() {
+        lock_guard<mutex> guard(lock);
+        released++;
+        signal.notify_all();
+    }
+
+    void waitForReads(size_t count) {
+        unique_lock<mutex> guard(lock);
+        signal.wait(guard, [&]() { return reads.size() >= count; });
+    }
+
+    Result tryReadRegisters(uint16_t* values, int, bool, int start, int length) {
+        block(start, length);
+        for (int i = 0; i < length; ++i) {
+            values[i] = start + i;
+        }
+        return result;
+    }
+
+    Result tryReadDigitalInputs(uint8_t* bits, int, bool, uint16_t start,
+                                uint16_t count) {
+        block(start, count);
+        memset(bits, 0, (count + 7) / 8);
+        for (int i = 0; i < count; ++i) {
+            if ((start + i) % 3 == 0) {
+                bits[i / 8] |= 1 << (i % 8);
+            }
+        }
+        return result;
+    }
+};
+
+struct ReadCoalescerTest : public ::testing::Test {
+    CoalescerMaster master;
+    ReadCoalescer coalescer;
+
+    ReadCoalescerTest()
+        : coalescer(master) {
+    }
+
+    void waitForPending(size_t count) {
+        while (coalescer.getPendingReadCount() < count) {
+            this_thread::yield();
+        }
+    }
+
+    thread readInBackground(uint16_t* values, int address, int start, int length) {
+        return thread([this, values, address, start, length]() {
+            coalescer.readRegisters(values, address, false, start, length);
+        });
+    }
+};
+
+TEST_F(ReadCoalescerTest, it_serves_a_read_contained_in_a_read_on_the_bus) {
+    uint16_t wide[10];
+    thread first = readInBackground(wide, 1, 100, 10);
+    master.waitForReads(1);
+
+    uint16_t narrow[3];
+    thread second = readInBackground(narrow, 1, 102, 3);
+    while (coalescer.getCoalescedReadCount() < 1) {
+        this_thread::yield();
+    }
+    master.release();
+    first.join();
+    second.join();
+
+    ASSERT_EQ(1u, master.reads.size());
+    ASSERT_EQ(1u, coalescer.getTransactionCount());
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(102 + i, narrow[i]);
+    }
+}
+
+TEST_F(ReadCoalescerTest, it_does_not_widen_a_read_that_is_on_the_bus) {
+    uint16_t first_values[10];
+    thread first = readInBackground(first_values, 1, 100, 10);
+    master.waitForReads(1);
+
+    uint16_t second_values[10];
+    thread second = readInBackground(second_values, 1, 105, 10);
+    waitForPending(2);
+    master.release();
+    master.waitForReads(2);
+    master.release();
+    first.join();
+    second.join();
+
+    ASSERT_EQ((vector<pair<int, int>>{ { 100, 10 }, { 105, 10 } }), master.reads);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(105 + i, second_values[i]);
+    }
+}
+
+TEST_F(ReadCoalescerTest, it_merges_overlapping_reads_waiting_for_the_bus) {
+    uint16_t busy[1];
+    thread first = readInBackground(busy, 1, 0, 1);
+    master.waitForReads(1);
+
+    uint16_t a[10];
+    thread second = readInBackground(a, 2, 100, 10);
+    waitForPending(2);
+    uint16_t b[10];
+    thread third = readInBackground(b, 2, 105, 10);
+    while (coalescer.getCoalescedReadCount() < 1) {
+        this_thread::yield();
+    }
+
+    master.release();
+    master.waitForReads(2);
+    master.release();
+    first.join();
+    second.join();
+    third.join();
+
+    ASSERT_EQ((vector<pair<int, int>>{ { 0, 1 }, { 100, 15 } }), master.reads);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(100 + i, a[i]);
+        ASSERT_EQ(105 + i, b[i]);
+    }
+}
+
+TEST_F(ReadCoalescerTest, it_does_not_merge_reads_beyond_the_max_block_size) {
+    master.setMaxReadBlockSize(2, 12, 2000);
+
+    uint16_t busy[1];
+    thread first = readInBackground(busy, 1, 0, 1);
+    master.waitForReads(1);
+
+    uint16_t a[10];
+    thread second = readInBackground(a, 2, 100, 10);
+    waitForPending(2);
+    uint16_t b[10];
+    thread third = readInBackground(b, 2, 105, 10);
+    waitForPending(3);
+
+    for (int i = 0; i < 3; ++i) {
+        master.release();
+    }
+    first.join();
+    second.join();
+    third.join();
+    ASSERT_EQ(3u, master.reads.size());
+}
+
+TEST_F(ReadCoalescerTest, it_does_not_merge_reads_from_different_tables) {
+    uint16_t busy[1];
+    thread first = readInBackground(busy, 1, 0, 1);
+    master.waitForReads(1);
+
+    uint16_t a[10];
+    thread second = readInBackground(a, 2, 100, 10);
+    waitForPending(2);
+    uint16_t b[10];
+    thread third([&]() { coalescer.readRegisters(b, 2, true, 100, 10); });
+    waitForPending(3);
+
+    for (int i = 0; i < 3; ++i) {
+        master.release();
+    }
+    first.join();
+    second.join();
+    third.join();
+    ASSERT_EQ(3u, master.reads.size());
+    ASSERT_EQ(0u, coalescer.getCoalescedReadCount());
+}
+
+TEST_F(ReadCoalescerTest, it_fans_errors_out_to_all_waiters) {
+    master.result = Result(RESULT_TIMEOUT, "timeout");
+
+    Result first_result;
+    uint16_t wide[10];
+    thread first([&]() {
+        first_result = coalescer.readRegisters(wide, 1, false, 100, 10);
+    });
+    master.waitForReads(1);
+
+    Result second_result;
+    uint16_t narrow[3];
+    thread second([&]() {
+        second_result = coalescer.readRegisters(narrow, 1, false, 102, 3);
+    });
+    while (coalescer.getCoalescedReadCount() < 1) {
+        this_thread::yield();
+    }
+    master.release();
+    first.join();
+    second.join();
+
+    ASSERT_EQ(RESULT_TIMEOUT, first_result.code);
+    ASSERT_EQ(RESULT_TIMEOUT, second_result.code);
+}
+
+TEST_F(ReadCoalescerTest, it_extracts_bits_at_an_offset_in_a_wider_read) {
+    uint8_t wide[3];
+    thread first([&]() { coalescer.readDigitalInputs(wide, 1, true, 100, 20); });
+    master.waitForReads(1);
+
+    uint8_t narrow[2];
+    thread second([&]() { coalescer.readDigitalInputs(narrow, 1, true, 103, 10); });
+    while (coalescer.getCoalescedReadCount() < 1) {
+        this_thread::yield();
+    }
+    master.release();
+    first.join();
+    second.join();
+
+    // Bits set at addresses 105, 108 and 111
+    ASSERT_EQ(0x24, narrow[0]);
+    ASSERT_EQ(0x01, narrow[1]);
+}
+
+TEST_F(ReadCoalescerTest, it_rejects_empty_reads) {
+    uint16_t values[1];
+    ASSERT_THROW(coalescer.readRegisters(values, 1, false, 0, 0), invalid_argument);
+}
+
+TEST_F(ReadCoalescerTest, it_rejects_bit_reads_out_of_bounds) {
+    uint8_t bits[1];
+    ASSERT_THROW(coalescer.readDigitalInputs(bits, 1, true, 0, 0), invalid_argument);
+    ASSERT_THROW(coalescer.readDigitalInputs(bits, 1, true, -1, 1), invalid_argument);
+    ASSERT_THROW(coalescer.readDigitalInputs(bits, 1, true, 0xffff, 2), invalid_argument);
+}
@@ -55,6 +55,43 @@ TEST_F(TCPTest, it_parses_a_frame) {
     ASSERT_THAT(frame.payload, ElementsAreArray(payload));
 }
 
+TEST_F(TCPTest, it_parses_a_frame_into_a_view_without_copying_the_payload) {
+    uint8_t bytes[] = { 0x12, 0x34, 0, 0, 0, 9, 0x34, 0xEB, 1, 2, 3, 4, 5, 6, 7 };
+    FrameView frame;
+    TCP::parseFrame(frame, 0x1234, bytes, bytes + sizeof(bytes));
+    ASSERT_EQ(0x34, frame.address);
+    ASSERT_EQ(0xeb, frame.function);
+    ASSERT_EQ(bytes + 8, frame.payload);
+    ASSERT_EQ(7, frame.payload_size);
+}
+
+TEST_F(TCPTest, it_parses_a_frame_into_a_static_frame) {
+    uint8_t bytes[] = { 0x12, 0x34, 0, 0, 0, 9, 0x34, 0xEB, 1, 2, 3, 4, 5, 6, 7 };
+    StaticFrame<16> frame;
+    TCP::parseFrame(frame, 0x1234, bytes, bytes + sizeof(bytes));
+    ASSERT_EQ(0x34, frame.address);
+    ASSERT_EQ(0xeb, frame.function);
+
+    uint8_t payload[7] = { 1, 2, 3, 4, 5, 6, 7 };
+    ASSERT_THAT(vector<uint8_t>(frame.payload.begin(),
+                                frame.payload.begin() + frame.payload_size),
+                ElementsAreArray(payload));
+}
+
+TEST_F(TCPTest, it_reports_a_transaction_ID_mismatch_without_throwing) {
+    uint8_t bytes[] = { 0x12, 0x34, 0, 0, 0, 9, 0x34, 0xEB, 1, 2, 3, 4, 5, 6, 7 };
+    FrameView frame;
+    Result result = TCP::tryParseFrame(frame, 0x0000, bytes, bytes + sizeof(bytes));
+    ASSERT_EQ(RESULT_TRANSACTION_ID_MISMATCH, result.code);
+}
+
+TEST_F(TCPTest, it_reports_a_length_mismatch_without_throwing) {
+    uint8_t bytes[] = { 0x12, 0x34, 0, 0, 0, 10, 0x34, 0xEB, 1, 2, 3, 4, 5, 6, 7 };
+    FrameView frame;
+    Result result = TCP::tryParseFrame(frame, 0x1234, bytes, bytes + sizeof(bytes));
+    ASSERT_EQ(RESULT_TOO_SMALL, result.code);
+}
+
 TEST_F(TCPTest, it_rejects_a_frame_if_its_transaction_ID_does_not_match) {
     uint8_t bytes[] = { 0x12, 0x34, 0, 0, 0, 9, 0x34, 0xEB, 1, 2, 3, 4, 5, 6, 7 };
     ASSERT_THROW(TCP::parseFrame(0x0000, bytes, bytes + sizeof(bytes)),
@@ -92,8 +129,18 @@ TEST_F(TCPTest, it_formats_a_read_input_registers_command) {
     ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
 }
 
+TEST_F(TCPTest, it_formats_a_read_of_the_last_register) {
+    constexpr int EXPECTED_SIZE = 12;
+    uint8_t buffer[EXPECTED_SIZE];
+    uint8_t* end = TCP::formatReadRegisters(buffer, 0xabcd, 0x10, false, 0xffff, 1);
+    ASSERT_EQ(end - buffer, EXPECTED_SIZE);
+
+    uint8_t expected[EXPECTED_SIZE] = { 0xab, 0xcd, 0, 0, 0, 6, 0x10, 3, 0xff, 0xff, 0x0, 0x01 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
 TEST_F(TCPTest, it_throws_if_attempting_to_read_beyond_register_65536) {
-    ASSERT_THROW(TCP::formatReadRegisters(nullptr, 0xabcd, 0x10, false, 0xfffe, 2),
+    ASSERT_THROW(TCP::formatReadRegisters(nullptr, 0xabcd, 0x10, false, 0xffff, 2),
                  std::invalid_argument);
 }
 
@@ -111,3 +158,44 @@ TEST_F(TCPTest, it_formats_a_single_register_write) {
     uint8_t expected[EXPECTED_SIZE] = { 0xab, 0xcd, 0, 0, 0, 6, 0x10, 6, 0x10, 0x20, 0x11, 0x21 };
     ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
 }
+
+TEST_F(TCPTest, it_formats_a_write_multiple_coils_request) {
+    uint8_t buffer[256];
+    uint8_t bits[] = { 0xcd, 0x01 };
+    uint8_t* end = TCP::formatWriteCoils(buffer, 0xabcd, 0x10, 0x13, bits, 10);
+
+    uint8_t expected[] = { 0xab, 0xcd, 0, 0, 0, 9, 0x10, 0x0f, 0x00, 0x13, 0, 10, 2,
+                           0xcd, 0x01 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(TCPTest, it_formats_a_read_write_multiple_registers_request) {
+    uint8_t buffer[256];
+    uint16_t values[] = { 0x00ff, 0x1234 };
+    uint8_t* end = TCP::formatReadWriteRegisters(
+        buffer, 0xabcd, 0x11, 0x03, 6, 0x0e, values, 2
+    );
+
+    uint8_t expected[] = { 0xab, 0xcd, 0, 0, 0, 15, 0x11, 0x17, 0, 0x03, 0, 6,
+                           0, 0x0e, 0, 2, 4, 0x00, 0xff, 0x12, 0x34 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(TCPTest, it_formats_a_mask_write_register_request) {
+    uint8_t buffer[256];
+    uint8_t* end = TCP::formatMaskWriteRegister(buffer, 0xabcd, 0x11, 0x04, 0x00f2, 0x0025);
+
+    uint8_t expected[] = { 0xab, 0xcd, 0, 0, 0, 8, 0x11, 0x16, 0, 0x04,
+                           0x00, 0xf2, 0x00, 0x25 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
+
+TEST_F(TCPTest, it_formats_a_write_multiple_registers_request) {
+    uint8_t buffer[256];
+    uint16_t values[] = { 0x1234, 0x5678 };
+    uint8_t* end = TCP::formatWriteRegisters(buffer, 0xabcd, 0x10, 0x1020, values, 2);
+
+    uint8_t expected[] = { 0xab, 0xcd, 0, 0, 0, 11, 0x10, 0x10, 0x10, 0x20, 0, 2, 4,
+                           0x12, 0x34, 0x56, 0x78 };
+    ASSERT_THAT(std::vector<uint8_t>(buffer, end), ElementsAreArray(expected));
+}
@@ -64,6 +64,20 @@ TEST_F(TCPMasterTest, it_does_a_modbus_request) {
     ASSERT_THAT(f.payload, ElementsAreArray(expected));
 }
 
+TEST_F(TCPMasterTest, it_returns_a_view_on_a_reply_within_its_read_buffer) {
+    driver.openURI("test://");
+
+    uint8_t reply[] = { 0, 0, 0, 0, 0, 6, 0x10, 0x02, 6, 7, 8, 9 };
+    pushDataToDriver(reply, reply + sizeof(reply));
+    FrameView f;
+    driver.readReply(f, 0x02);
+    ASSERT_EQ(0x10, f.address);
+    ASSERT_EQ(0x02, f.function);
+    uint8_t expected[4] = { 6, 7, 8, 9 };
+    ASSERT_THAT(vector<uint8_t>(f.payload, f.payload + f.payload_size),
+                ElementsAreArray(expected));
+}
+
 TEST_F(TCPMasterTest, it_throws_if_receiving_an_unexpected_function_code_in_reply) {
     driver.openURI("test://");
 
@@ -92,6 +106,22 @@ TEST_F(TCPMasterTest, it_throws_if_receiving_an_exception_function_code_in_reply
         RequestException);
 }
 
+TEST_F(TCPMasterTest, it_reports_an_exception_reply_with_the_non_throwing_API) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0xab, 0xcd, 0, 2 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 3, 0x10, 0x83, 2 }
+    );
+
+    uint16_t values[2];
+    Result result = driver.tryReadRegisters(values, 0x10, false, 0xabcd, 2);
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, result.code);
+    ASSERT_EQ(0x03, result.function_code);
+    ASSERT_EQ(0x02, result.exception_code);
+}
+
 TEST_F(TCPMasterTest, it_handles_a_malformed_exception_reply_that_is_lacking_the_exception_code) {
     driver.openURI("test://");
 
@@ -156,6 +186,21 @@ TEST_F(TCPMasterTest, it_reads_multiple_coils) {
     ASSERT_THAT(values, ElementsAreArray(expected));
 }
 
+TEST_F(TCPMasterTest, it_reads_multiple_coils_into_packed_bits) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x01, 0x12, 0x34, 0x00, 0x09 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 5, 0x10, 0x01, 0x2, 0xab, 0xcd }
+    );
+    uint8_t bits[2];
+    driver.readDigitalInputs(bits, 0x10, true, 0x1234, 9);
+
+    ASSERT_EQ(0xab, bits[0]);
+    ASSERT_EQ(0x01, bits[1]);
+}
+
 TEST_F(TCPMasterTest, it_reads_multiple_digital_inputs) {
     driver.openURI("test://");
 
@@ -191,3 +236,628 @@ TEST_F(TCPMasterTest, it_does_a_coil_OFF_write_request) {
     );
     driver.writeSingleCoil(0x10, 0x1234, false);
 }
+
+TEST_F(TCPMasterTest, it_writes_multiple_registers) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 11, 0x10, 0x10, 0xab, 0xcd, 0, 2, 4,
+                         0x12, 0x34, 0x56, 0x78 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x10, 0xab, 0xcd, 0, 2 }
+    );
+    uint16_t values[] = { 0x1234, 0x5678 };
+    driver.writeRegisters(0x10, 0xabcd, values, 2);
+}
+
+TEST_F(TCPMasterTest, it_splits_register_writes_that_do_not_fit_in_one_request) {
+    driver.openURI("test://");
+
+    uint16_t values[130];
+    vector<uint8_t> first = { 0xaa, 0x01, 0, 0, 0, 253, 0x10, 0x10, 0x01, 0x00, 0, 123, 246 };
+    vector<uint8_t> second = { 0xaa, 0x02, 0, 0, 0, 21, 0x10, 0x10, 0x01, 0x7b, 0, 7, 14 };
+    for (int i = 0; i < 130; ++i) {
+        values[i] = i;
+        auto& request = (i < 123) ? first : second;
+        request.push_back(0);
+        request.push_back(i);
+    }
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        first,
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x10, 0x01, 0x00, 0, 123 }
+    );
+    EXPECT_REPLY(
+        second,
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x10, 0x01, 0x7b, 0, 7 }
+    );
+    driver.writeRegisters(0x10, 0x100, values, 130);
+}
+
+TEST_F(TCPMasterTest, it_rejects_a_register_write_beyond_the_last_register) {
+    driver.openURI("test://");
+
+    uint16_t values[2];
+    ASSERT_THROW(driver.writeRegisters(0x10, 0xffff, values, 2), std::invalid_argument);
+}
+
+TEST_F(TCPMasterTest, it_reads_the_last_register) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0xff, 0xff, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x34 }
+    );
+    ASSERT_EQ(vector<uint16_t>{ 0x1234 }, driver.readRegisters(0x10, false, 0xffff, 1));
+}
+
+TEST_F(TCPMasterTest, it_rejects_a_register_read_beyond_the_last_register) {
+    driver.openURI("test://");
+
+    ASSERT_THROW(driver.readRegisters(0x10, false, 0xffff, 2), std::invalid_argument);
+}
+
+TEST_F(TCPMasterTest, it_rejects_empty_ranges) {
+    driver.openURI("test://");
+
+    uint16_t values[1];
+    uint8_t bits[1];
+    ASSERT_THROW(driver.tryReadRegisters(values, 0x10, false, 0, 0), std::invalid_argument);
+    ASSERT_THROW(driver.tryReadRegisters(values, 0x10, false, 0, -1), std::invalid_argument);
+    ASSERT_THROW(driver.tryReadDigitalInputs(bits, 0x10, true, 0, 0), std::invalid_argument);
+    ASSERT_THROW(driver.tryWriteRegisters(0x10, 0, values, 0), std::invalid_argument);
+    ASSERT_THROW(driver.tryWriteCoils(0x10, 0, bits, 0), std::invalid_argument);
+}
+
+TEST_F(TCPMasterTest, it_writes_multiple_coils) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 9, 0x10, 0x0f, 0x00, 0x13, 0, 10, 2,
+                         0xcd, 0x01 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x0f, 0x00, 0x13, 0, 10 }
+    );
+    uint8_t bits[] = { 0xcd, 0x01 };
+    driver.writeCoils(0x10, 0x13, bits, 10);
+}
+
+TEST_F(TCPMasterTest, it_splits_coil_writes_that_do_not_fit_in_one_request) {
+    driver.openURI("test://");
+
+    vector<uint8_t> bits(250);
+    vector<uint8_t> first = { 0xaa, 0x01, 0, 0, 0, 253, 0x10, 0x0f, 0, 0, 0x07, 0xb0, 246 };
+    vector<uint8_t> second = { 0xaa, 0x02, 0, 0, 0, 11, 0x10, 0x0f, 0x07, 0xb0, 0, 32, 4 };
+    for (int i = 0; i < 250; ++i) {
+        bits[i] = i;
+        auto& request = (i < 246) ? first : second;
+        request.push_back(i);
+    }
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        first,
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x0f, 0, 0, 0x07, 0xb0 }
+    );
+    EXPECT_REPLY(
+        second,
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x0f, 0x07, 0xb0, 0, 32 }
+    );
+    driver.writeCoils(0x10, 0, bits.data(), 2000);
+}
+
+TEST_F(TCPMasterTest, it_writes_and_reads_registers_in_a_single_transaction) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 13, 0x11, 0x17, 0, 0x03, 0, 2,
+                         0, 0x0e, 0, 1, 2, 0x00, 0xff },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 7, 0x11, 0x17, 4, 0x12, 0x34, 0x56, 0x78 }
+    );
+    uint16_t write_values[] = { 0x00ff };
+    uint16_t read_values[2];
+    driver.readWriteRegisters(read_values, 0x11, 0x03, 2, 0x0e, write_values, 1);
+    ASSERT_EQ(0x1234, read_values[0]);
+    ASSERT_EQ(0x5678, read_values[1]);
+}
+
+TEST_F(TCPMasterTest, it_reports_a_read_write_reply_of_the_wrong_size) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 13, 0x11, 0x17, 0, 0x03, 0, 2,
+                         0, 0x0e, 0, 1, 2, 0x00, 0xff },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 5, 0x11, 0x17, 2, 0x12, 0x34 }
+    );
+    uint16_t write_values[] = { 0x00ff };
+    uint16_t read_values[2];
+    Result result = driver.tryReadWriteRegisters(
+        read_values, 0x11, 0x03, 2, 0x0e, write_values, 1
+    );
+    ASSERT_EQ(RESULT_UNEXPECTED_REPLY, result.code);
+}
+
+TEST_F(TCPMasterTest, it_changes_register_bits_with_a_mask_write) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 8, 0x10, 0x16, 0, 4, 0xff, 0xf0, 0, 5 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 8, 0x10, 0x16, 0, 4, 0xff, 0xf0, 0, 5 }
+    );
+    driver.writeRegisterBits(0x10, 4, 0x000f, 0x0005);
+    ASSERT_TRUE(driver.isMaskWriteSupported(0x10));
+}
+
+TEST_F(TCPMasterTest, it_falls_back_to_read_modify_write_if_mask_write_is_not_supported) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 8, 0x10, 0x16, 0, 4, 0xff, 0xf0, 0, 5 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 3, 0x10, 0x96, 0x01 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x03, 0, 4, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x3a }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x03, 0, 0, 0, 6, 0x10, 0x06, 0, 4, 0x12, 0x35 },
+        vector<uint8_t>{ 0xaa, 0x03, 0, 0, 0, 6, 0x10, 0x06, 0, 4, 0x12, 0x35 }
+    );
+    driver.writeRegisterBits(0x10, 4, 0x000f, 0x0005);
+    ASSERT_FALSE(driver.isMaskWriteSupported(0x10));
+    ASSERT_TRUE(driver.isMaskWriteSupported(0x11));
+
+    // The fallback is remembered
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x04, 0, 0, 0, 6, 0x10, 0x03, 0, 4, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x04, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x35 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x05, 0, 0, 0, 6, 0x10, 0x06, 0, 4, 0x12, 0x3a },
+        vector<uint8_t>{ 0xaa, 0x05, 0, 0, 0, 6, 0x10, 0x06, 0, 4, 0x12, 0x3a }
+    );
+    driver.writeRegisterBits(0x10, 4, 0x000f, 0x000a);
+}
+
+TEST_F(TCPMasterTest, it_does_not_fall_back_on_other_exceptions) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 8, 0x10, 0x16, 0, 4, 0xff, 0xf0, 0, 5 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 3, 0x10, 0x96, 0x02 }
+    );
+    ASSERT_THROW(driver.writeRegisterBits(0x10, 4, 0x000f, 0x0005), RequestException);
+    ASSERT_TRUE(driver.isMaskWriteSupported(0x10));
+}
+
+TEST_F(TCPMasterTest, it_splits_register_reads_that_do_not_fit_in_one_request) {
+    driver.openURI("test://");
+
+    vector<uint8_t> first = { 0xaa, 0x01, 0, 0, 0, 253, 0x10, 0x03, 250 };
+    vector<uint8_t> second = { 0xaa, 0x02, 0, 0, 0, 13, 0x10, 0x03, 10 };
+    for (int i = 0; i < 130; ++i) {
+        auto& reply = (i < 125) ? first : second;
+        reply.push_back(0);
+        reply.push_back(i);
+    }
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x01, 0x00, 0, 125 },
+        first
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x03, 0x01, 0x7d, 0, 5 },
+        second
+    );
+    uint16_t values[130];
+    driver.readRegisters(values, 0x10, false, 0x100, 130);
+    for (int i = 0; i < 130; ++i) {
+        ASSERT_EQ(i, values[i]);
+    }
+}
+
+TEST_F(TCPMasterTest, it_splits_digital_input_reads_that_do_not_fit_in_one_request) {
+    driver.openURI("test://");
+
+    vector<uint8_t> first = { 0xaa, 0x01, 0, 0, 0, 253, 0x10, 0x02, 250 };
+    vector<uint8_t> second = { 0xaa, 0x02, 0, 0, 0, 5, 0x10, 0x02, 2, 0xff, 0x03 };
+    for (int i = 0; i < 250; ++i) {
+        first.push_back(i);
+    }
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x02, 0, 0, 0x07, 0xd0 },
+        first
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x02, 0x07, 0xd0, 0, 10 },
+        second
+    );
+    uint8_t bits[252];
+    driver.readDigitalInputs(bits, 0x10, false, 0, 2010);
+    for (int i = 0; i < 250; ++i) {
+        ASSERT_EQ(i, bits[i]);
+    }
+    ASSERT_EQ(0xff, bits[250]);
+    ASSERT_EQ(0x03, bits[251]);
+}
+
+TEST_F(TCPMasterTest, it_applies_the_read_block_size_only_to_the_configured_slave) {
+    driver.setMaxReadBlockSize(0x10, 2, 16);
+    ASSERT_EQ(2, driver.getMaxRegisterReadBlockSize(0x10));
+    ASSERT_EQ(16, driver.getMaxBitReadBlockSize(0x10));
+    ASSERT_EQ(125, driver.getMaxRegisterReadBlockSize(0x11));
+    ASSERT_EQ(2000, driver.getMaxBitReadBlockSize(0x11));
+}
+
+TEST_F(TCPMasterTest, it_rejects_a_bit_block_size_that_is_not_a_multiple_of_8) {
+    ASSERT_THROW(driver.setMaxReadBlockSize(0x10, 2, 12), std::invalid_argument);
+}
+
+TEST_F(TCPMasterTest, it_rejects_a_register_block_size_above_the_protocol_maximum) {
+    ASSERT_THROW(driver.setMaxReadBlockSize(0x10, 126, 16), std::invalid_argument);
+}
+
+TEST_F(TCPMasterTest, it_allocates_transaction_ids_in_the_whole_16_bit_range) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    for (int i = 1; i <= 256; ++i) {
+        uint8_t id_msb = (0xaa00 + i) >> 8;
+        uint8_t id_lsb = (0xaa00 + i) & 0xff;
+        EXPECT_REPLY(
+            vector<uint8_t>{ id_msb, id_lsb, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+            vector<uint8_t>{ id_msb, id_lsb, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+        );
+    }
+    for (int i = 1; i <= 256; ++i) {
+        driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    }
+}
+
+TEST_F(TCPMasterTest, it_demultiplexes_pipelined_replies_received_out_of_order) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(2);
+
+    // The mock queues a reply on each write. Swap them to have the slave
+    // reply to the second request first
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 5, 0x11, 0x03, 2, 0x56, 0x78 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x11, 0x03, 0x00, 0x02, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x34 }
+    );
+
+    ASSERT_EQ(0xaa01, driver.sendRequest(0x10, 0x03, { 0, 1, 0, 1 }));
+    ASSERT_EQ(0xaa02, driver.sendRequest(0x11, 0x03, { 0, 2, 0, 1 }));
+    ASSERT_EQ(2u, driver.getPendingRequestCount());
+
+    Frame frame;
+    ASSERT_EQ(0xaa02, driver.readNextReply(frame));
+    ASSERT_EQ(0x11, frame.address);
+    ASSERT_EQ((vector<uint8_t>{ 2, 0x56, 0x78 }), frame.payload);
+    ASSERT_EQ(0xaa01, driver.readNextReply(frame));
+    ASSERT_EQ(0x10, frame.address);
+    ASSERT_EQ((vector<uint8_t>{ 2, 0x12, 0x34 }), frame.payload);
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_refuses_to_send_more_than_the_max_pending_requests) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(1);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1 },
+        vector<uint8_t>{}
+    );
+    driver.sendRequest(0x10, 0x03, { 0, 1, 0, 1 });
+    ASSERT_THROW(driver.sendRequest(0x10, 0x03, { 0, 1, 0, 1 }), std::logic_error);
+}
+
+TEST_F(TCPMasterTest, it_refuses_request_reply_transactions_while_requests_are_pending) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(2);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1 },
+        vector<uint8_t>{}
+    );
+    driver.sendRequest(0x10, 0x03, { 0, 1, 0, 1 });
+    ASSERT_THROW(driver.readRegisters(0x10, false, 1, 1), std::logic_error);
+    ASSERT_THROW(driver.writeSingleRegister(0x10, 1, 2), std::logic_error);
+    ASSERT_EQ(1u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_forgets_the_pending_requests_on_clear) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(2);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1 },
+        vector<uint8_t>{}
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1 },
+        vector<uint8_t>{}
+    );
+    driver.sendRequest(0x10, 0x03, { 0, 1, 0, 1 });
+    driver.sendRequest(0x10, 0x03, { 0, 1, 0, 1 });
+    driver.clearPendingRequests();
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_reports_exceptions_to_pipelined_requests) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 3, 0x10, 0x83, 0x02 }
+    );
+    driver.sendRequest(0x10, 0x03, { 0, 1, 0, 1 });
+
+    FrameView frame;
+    uint16_t transaction_id;
+    Result result = driver.tryReadNextReply(frame, transaction_id);
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, result.code);
+    ASSERT_EQ(0xaa01, transaction_id);
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_throws_when_reading_a_reply_without_pending_requests) {
+    driver.openURI("test://");
+    FrameView frame;
+    ASSERT_THROW(driver.readNextReply(frame), std::logic_error);
+}
+
+TEST_F(TCPMasterTest, it_discards_a_late_reply_whole_and_reads_the_expected_one) {
+    driver.openURI("test://");
+    driver.setReadTimeout(base::Time::fromMilliseconds(10));
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{}
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34,
+                         0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+    );
+
+    ASSERT_THROW(driver.writeSingleRegister(0x10, 0xabcd, 0x1234),
+                 iodrivers_base::TimeoutError);
+    driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    ASSERT_EQ(1u, driver.getStaleReplyCount());
+    ASSERT_EQ(0u, driver.getResyncCount());
+    ASSERT_EQ(12u, driver.getStatus().bad_rx);
+}
+
+TEST_F(TCPMasterTest, it_resynchronizes_on_the_next_header_after_garbage) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{ 0x12, 0x34, 0x56, 0x78,
+                         0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+    );
+
+    driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    ASSERT_EQ(1u, driver.getResyncCount());
+    ASSERT_EQ(4u, driver.getStatus().bad_rx);
+}
+
+TEST_F(TCPMasterTest, it_does_not_accept_a_frame_with_an_invalid_length_field) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 1,
+                         0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+    );
+
+    driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    ASSERT_EQ(1u, driver.getResyncCount());
+}
+
+TEST_F(TCPMasterTest, it_pipelines_a_batch_with_a_single_write) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(3);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0x00, 0x02,
+                         0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34,
+                         0xaa, 0x03, 0, 0, 0, 6, 0x11, 0x02, 0x00, 0x00, 0x00, 0x03 },
+        vector<uint8_t>{ 0xaa, 0x03, 0, 0, 0, 4, 0x11, 0x02, 1, 0x05,
+                         0xaa, 0x01, 0, 0, 0, 7, 0x10, 0x03, 4, 0x12, 0x34, 0x56, 0x78,
+                         0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+    );
+
+    uint16_t registers[2];
+    uint8_t bits = 0;
+    BatchRequest batch[] = {
+        BatchRequest::readRegisters(registers, 0x10, false, 1, 2),
+        BatchRequest::writeSingleRegister(0x10, 0xabcd, 0x1234),
+        BatchRequest::readDigitalInputs(&bits, 0x11, false, 0, 3)
+    };
+    ASSERT_EQ(0u, driver.execute(batch, 3));
+    for (auto const& request : batch) {
+        ASSERT_EQ(RESULT_OK, request.result.code);
+    }
+    ASSERT_EQ(0x1234, registers[0]);
+    ASSERT_EQ(0x5678, registers[1]);
+    ASSERT_EQ(0x05, bits);
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_runs_a_batch_one_request_at_a_time_by_default) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0x00, 0x01 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 3, 0x10, 0x83, 0x02 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+    );
+
+    uint16_t value;
+    BatchRequest batch[] = {
+        BatchRequest::readRegisters(&value, 0x10, false, 1, 1),
+        BatchRequest::writeSingleRegister(0x10, 0xabcd, 0x1234)
+    };
+    ASSERT_EQ(1u, driver.execute(batch, 2));
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, batch[0].result.code);
+    ASSERT_EQ(RESULT_OK, batch[1].result.code);
+}
+
+TEST_F(TCPMasterTest, it_fails_the_batch_requests_whose_reply_is_missing) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(2);
+    driver.setReadTimeout(base::Time::fromMilliseconds(10));
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0x00, 0x01, 0x00, 0x02,
+                         0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0x00, 0x03, 0x00, 0x04 },
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0x00, 0x03, 0x00, 0x04 }
+    );
+
+    BatchRequest batch[] = {
+        BatchRequest::writeSingleRegister(0x10, 1, 2),
+        BatchRequest::writeSingleRegister(0x10, 3, 4)
+    };
+    ASSERT_EQ(1u, driver.execute(batch, 2));
+    ASSERT_EQ(RESULT_TIMEOUT, batch[0].result.code);
+    ASSERT_NE(iodrivers_base::TimeoutError::NONE, batch[0].result.timeout_type);
+    ASSERT_EQ(RESULT_OK, batch[1].result.code);
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_rejects_a_batch_with_an_unsupported_function) {
+    driver.openURI("test://");
+
+    BatchRequest batch[1];
+    batch[0].function = 0x2b;
+    ASSERT_THROW(driver.execute(batch, 1), std::invalid_argument);
+}
+
+TEST_F(TCPMasterTest, it_rejects_an_invalid_batch_before_sending_any_request) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(4);
+
+    uint16_t values[2];
+    BatchRequest batch[] = {
+        BatchRequest::readRegisters(values, 0x10, false, 0, 1),
+        BatchRequest::readRegisters(values, 0x10, false, 0xffff, 2)
+    };
+    ASSERT_THROW(driver.execute(batch, 2), std::invalid_argument);
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+    ASSERT_EQ(0u, driver.getQueuedRequestCount());
+
+    batch[1] = BatchRequest::readRegisters(nullptr, 0x10, false, 2, 1);
+    ASSERT_THROW(driver.execute(batch, 2), std::invalid_argument);
+    batch[1] = BatchRequest::readRegisters(values, 0x10, false, 2, 0);
+    ASSERT_THROW(driver.execute(batch, 2), std::invalid_argument);
+    batch[1] = BatchRequest::writeSingleRegister(0x10, 2, 3);
+    batch[1].count = 2;
+    ASSERT_THROW(driver.execute(batch, 2), std::invalid_argument);
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_flushes_the_queued_requests_with_a_single_write) {
+    driver.openURI("test://");
+    driver.setMaxPendingRequests(3);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1,
+                         0xaa, 0x02, 0, 0, 0, 6, 0x11, 0x03, 0x00, 0x02, 0, 1,
+                         0xaa, 0x03, 0, 0, 0, 6, 0x12, 0x03, 0x00, 0x03, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x34,
+                         0xaa, 0x02, 0, 0, 0, 5, 0x11, 0x03, 2, 0x56, 0x78,
+                         0xaa, 0x03, 0, 0, 0, 5, 0x12, 0x03, 2, 0x9a, 0xbc }
+    );
+
+    ASSERT_EQ(0xaa01, driver.queueRequest(0x10, 0x03, { 0, 1, 0, 1 }));
+    ASSERT_EQ(0xaa02, driver.queueRequest(0x11, 0x03, { 0, 2, 0, 1 }));
+    ASSERT_EQ(0xaa03, driver.queueRequest(0x12, 0x03, { 0, 3, 0, 1 }));
+    ASSERT_EQ(3u, driver.getQueuedRequestCount());
+    ASSERT_EQ(3u, driver.getPendingRequestCount());
+    driver.flushRequests();
+    ASSERT_EQ(0u, driver.getQueuedRequestCount());
+
+    // All three replies arrive in one segment
+    Frame frame;
+    ASSERT_EQ(0xaa01, driver.readNextReply(frame));
+    ASSERT_EQ((vector<uint8_t>{ 2, 0x12, 0x34 }), frame.payload);
+    ASSERT_EQ(0xaa02, driver.readNextReply(frame));
+    ASSERT_EQ((vector<uint8_t>{ 2, 0x56, 0x78 }), frame.payload);
+    ASSERT_EQ(0xaa03, driver.readNextReply(frame));
+    ASSERT_EQ((vector<uint8_t>{ 2, 0x9a, 0xbc }), frame.payload);
+}
+
+TEST_F(TCPMasterTest, it_flushes_the_queued_requests_before_waiting_for_a_reply) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x03, 0x00, 0x01, 0, 1 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 5, 0x10, 0x03, 2, 0x12, 0x34 }
+    );
+
+    driver.queueRequest(0x10, 0x03, { 0, 1, 0, 1 });
+    Frame frame;
+    ASSERT_EQ(0xaa01, driver.readNextReply(frame));
+    ASSERT_EQ(0u, driver.getQueuedRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_drops_the_queued_requests_on_clear) {
+    driver.openURI("test://");
+
+    driver.queueRequest(0x10, 0x03, { 0, 1, 0, 1 });
+    driver.clearPendingRequests();
+    ASSERT_EQ(0u, driver.getQueuedRequestCount());
+    ASSERT_EQ(0u, driver.getPendingRequestCount());
+}
+
+TEST_F(TCPMasterTest, it_measures_the_turnarounds_only_with_adaptive_timeouts) {
+    driver.openURI("test://");
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{ 0xaa, 0x01, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+    );
+    EXPECT_REPLY(
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 },
+        vector<uint8_t>{ 0xaa, 0x02, 0, 0, 0, 6, 0x10, 0x06, 0xab, 0xcd, 0x12, 0x34 }
+    );
+
+    TimeoutEstimator const& estimator = driver.getTimeoutEstimator();
+    driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    ASSERT_EQ(0u, estimator.getSampleCount(0x10, 0x06));
+    driver.setAdaptiveTimeouts(true);
+    driver.writeSingleRegister(0x10, 0xabcd, 0x1234);
+    ASSERT_EQ(1u, estimator.getSampleCount(0x10, 0x06));
+}
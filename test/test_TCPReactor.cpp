@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <modbus/TCPReactor.hpp>
+#include "ReactorTestServer.hpp"
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+struct TCPReactorTest : public ::testing::Test {
+    ReactorTestServer server;
+    TCPReactor reactor;
+
+    TCPReactorTest()
+        : reactor(Time::fromMilliseconds(5)) {
+    }
+
+    template<typename Predicate>
+    bool pollUntil(Predicate predicate) {
+        Time deadline = Time::now() + Time::fromSeconds(5);
+        while (!predicate() && Time::now() < deadline) {
+            reactor.poll(Time::fromMilliseconds(10));
+        }
+        return predicate();
+    }
+};
+
+TEST_F(TCPReactorTest, it_reads_registers) {
+    int connection = reactor.addConnection("127.0.0.1", server.port);
+
+    bool done = false;
+    vector<uint16_t> values;
+    reactor.readRegisters(connection, 1, false, 0x100, 3,
+        [&](Result const& result, uint16_t const* v) {
+            ASSERT_TRUE(result.ok());
+            values.assign(v, v + 3);
+            done = true;
+        }
+    );
+    ASSERT_TRUE(pollUntil([&]() { return done; }));
+    ASSERT_EQ((vector<uint16_t>{ 0x100, 0x101, 0x102 }), values);
+}
+
+TEST_F(TCPReactorTest, it_queues_the_requests_of_a_connection) {
+    int connection = reactor.addConnection("127.0.0.1", server.port);
+
+    vector<int> order;
+    for (int i = 0; i < 10; ++i) {
+        reactor.writeSingleRegister(connection, 1, i, 0x1234,
+            [&order, i](Result const& result) {
+                ASSERT_TRUE(result.ok());
+                order.push_back(i);
+            }
+        );
+    }
+    ASSERT_TRUE(pollUntil([&]() { return order.size() == 10; }));
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(i, order[i]);
+    }
+}
+
+TEST_F(TCPReactorTest, it_drives_many_connections_from_its_thread) {
+    atomic<int> done(0);
+    for (int i = 0; i < 50; ++i) {
+        reactor.addConnection("127.0.0.1", server.port);
+    }
+    reactor.start();
+    for (int i = 0; i < 50; ++i) {
+        reactor.readRegisters(i, 1, false, i, 1,
+            [&done, i](Result const& result, uint16_t const* values) {
+                if (result.ok() && values[0] == i) {
+                    done++;
+                }
+            }
+        );
+    }
+
+    Time deadline = Time::now() + Time::fromSeconds(5);
+    while (done < 50 && Time::now() < deadline) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    reactor.stop();
+    ASSERT_EQ(50, done);
+    ASSERT_EQ(50u, reactor.getTransactionCount());
+}
+
+TEST_F(TCPReactorTest, it_times_out_if_the_device_does_not_reply) {
+    int connection = reactor.addConnection("127.0.0.1", server.port);
+    reactor.setTimeout(Time::fromMilliseconds(50));
+    server.silent_requests = 1;
+
+    Result result;
+    bool done = false;
+    Time start = Time::now();
+    reactor.writeSingleRegister(connection, 1, 0, 0, [&](Result const& r) {
+        result = r;
+        done = true;
+    });
+    ASSERT_TRUE(pollUntil([&]() { return done; }));
+    ASSERT_EQ(RESULT_TIMEOUT, result.code);
+    ASSERT_GE(Time::now() - start, Time::fromMilliseconds(50));
+    ASSERT_EQ(1u, reactor.getTimeoutCount());
+}
+
+TEST_F(TCPReactorTest, it_discards_late_replies_and_keeps_the_connection) {
+    int connection = reactor.addConnection("127.0.0.1", server.port);
+    reactor.setTimeout(Time::fromMilliseconds(50));
+    server.first_reply_delay_ms = 100;
+
+    vector<ResultCode> results;
+    for (int i = 0; i < 2; ++i) {
+        reactor.writeSingleRegister(connection, 1, 0, 0, [&](Result const& r) {
+            results.push_back(r.code);
+        });
+    }
+    ASSERT_TRUE(pollUntil([&]() { return results.size() == 2; }));
+    ASSERT_EQ((vector<ResultCode>{ RESULT_TIMEOUT, RESULT_OK }), results);
+    ASSERT_EQ(1u, reactor.getStaleReplyCount());
+    ASSERT_EQ(0u, reactor.getIOErrorCount());
+}
+
+TEST_F(TCPReactorTest, it_fails_the_requests_if_the_connection_is_refused) {
+    // Get a port that nothing listens on
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    socklen_t size = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size);
+    close(fd);
+
+    int connection = reactor.addConnection("127.0.0.1", ntohs(address.sin_port));
+    vector<ResultCode> results;
+    for (int i = 0; i < 2; ++i) {
+        reactor.writeSingleRegister(connection, 1, 0, 0, [&](Result const& r) {
+            results.push_back(r.code);
+        });
+    }
+    ASSERT_TRUE(pollUntil([&]() { return results.size() == 2; }));
+    ASSERT_EQ((vector<ResultCode>{ RESULT_IO_ERROR, RESULT_IO_ERROR }), results);
+}
+
+TEST_F(TCPReactorTest, it_rejects_invalid_connection_indexes) {
+    ASSERT_THROW(reactor.writeSingleRegister(0, 1, 0, 0, [](Result const&) {}),
+                 invalid_argument);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <modbus/TimeoutEstimator.hpp>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+struct TimeoutEstimatorTest : public ::testing::Test {
+    TimeoutEstimator estimator;
+
+    TimeoutEstimatorTest()
+        : estimator(Time::fromMilliseconds(2), Time::fromSeconds(1),
+                    Time::fromMilliseconds(3)) {
+    }
+
+    void addTurnarounds(int count, int ms) {
+        for (int i = 0; i < count; ++i) {
+            estimator.addTurnaround(1, 3, Time::fromMilliseconds(ms));
+        }
+    }
+};
+
+TEST_F(TimeoutEstimatorTest, it_uses_the_ceiling_until_it_has_enough_samples) {
+    addTurnarounds(TimeoutEstimator::MIN_SAMPLES - 1, 10);
+    ASSERT_EQ(Time::fromSeconds(1), estimator.getTimeout(1, 3));
+    addTurnarounds(1, 10);
+    ASSERT_EQ(Time::fromMilliseconds(13), estimator.getTimeout(1, 3));
+}
+
+TEST_F(TimeoutEstimatorTest, it_keeps_separate_statistics_per_slave_and_function) {
+    addTurnarounds(TimeoutEstimator::MIN_SAMPLES, 10);
+    ASSERT_EQ(Time::fromSeconds(1), estimator.getTimeout(2, 3));
+    ASSERT_EQ(Time::fromSeconds(1), estimator.getTimeout(1, 4));
+    ASSERT_EQ(0u, estimator.getSampleCount(2, 3));
+}
+
+TEST_F(TimeoutEstimatorTest, it_covers_the_high_quantile_of_the_turnarounds) {
+    addTurnarounds(31, 10);
+    addTurnarounds(1, 50);
+    // 1 out of 32 samples is above the 0.95 quantile
+    ASSERT_EQ(Time::fromMilliseconds(10), estimator.getTurnaroundQuantile(1, 3));
+    estimator.setQuantile(1);
+    ASSERT_EQ(Time::fromMilliseconds(53), estimator.getTimeout(1, 3));
+}
+
+TEST_F(TimeoutEstimatorTest, it_follows_the_average_when_the_turnaround_increases) {
+    addTurnarounds(TimeoutEstimator::WINDOW_SIZE, 10);
+    addTurnarounds(1, 100);
+    ASSERT_EQ(Time::fromMicroseconds(21250), estimator.getAverageTurnaround(1, 3));
+    ASSERT_EQ(Time::fromMicroseconds(24250), estimator.getTimeout(1, 3));
+}
+
+TEST_F(TimeoutEstimatorTest, it_applies_the_floor_and_the_ceiling) {
+    addTurnarounds(TimeoutEstimator::MIN_SAMPLES, 0);
+    estimator.setMargin(Time());
+    ASSERT_EQ(Time::fromMilliseconds(2), estimator.getTimeout(1, 3));
+
+    addTurnarounds(1, 100);
+    estimator.setBounds(Time::fromMilliseconds(2), Time::fromMilliseconds(50));
+    ASSERT_EQ(Time::fromMilliseconds(50), estimator.getTimeout(1, 3));
+}
+
+TEST_F(TimeoutEstimatorTest, it_doubles_the_timeout_on_each_consecutive_timeout) {
+    addTurnarounds(TimeoutEstimator::MIN_SAMPLES, 10);
+    estimator.addTimeout(1, 3);
+    ASSERT_EQ(Time::fromMilliseconds(26), estimator.getTimeout(1, 3));
+    estimator.addTimeout(1, 3);
+    ASSERT_EQ(Time::fromMilliseconds(52), estimator.getTimeout(1, 3));
+    for (int i = 0; i < 10; ++i) {
+        estimator.addTimeout(1, 3);
+    }
+    ASSERT_EQ(Time::fromSeconds(1), estimator.getTimeout(1, 3));
+
+    addTurnarounds(1, 10);
+    ASSERT_EQ(Time::fromMilliseconds(13), estimator.getTimeout(1, 3));
+}
+
+TEST_F(TimeoutEstimatorTest, it_rejects_invalid_parameters) {
+    ASSERT_THROW(estimator.setBounds(Time::fromSeconds(1), Time::fromMilliseconds(1)),
+                 invalid_argument);
+    ASSERT_THROW(estimator.setQuantile(0), invalid_argument);
+    ASSERT_THROW(estimator.setGain(1.5), invalid_argument);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <modbus/TimerWheel.hpp>
+
+using namespace std;
+using base::Time;
+using namespace modbus;
+
+struct TimerWheelTest : public ::testing::Test {
+    Time origin = Time::fromSeconds(1000);
+    TimerWheel wheel;
+    vector<uint64_t> expired;
+
+    TimerWheelTest()
+        : wheel(Time::fromMilliseconds(10), 8, origin) {
+    }
+
+    Time at(int ms) {
+        return origin + Time::fromMilliseconds(ms);
+    }
+};
+
+TEST_F(TimerWheelTest, it_does_not_expire_timers_before_their_deadline) {
+    wheel.schedule(at(25), 1);
+    wheel.advance(at(29), expired);
+    ASSERT_TRUE(expired.empty());
+    wheel.advance(at(30), expired);
+    ASSERT_EQ(vector<uint64_t>{ 1 }, expired);
+    ASSERT_TRUE(wheel.empty());
+}
+
+TEST_F(TimerWheelTest, it_expires_deadlines_in_the_past_on_the_next_tick) {
+    wheel.advance(at(50), expired);
+    wheel.schedule(at(0), 1);
+    wheel.advance(at(55), expired);
+    ASSERT_TRUE(expired.empty());
+    wheel.advance(at(60), expired);
+    ASSERT_EQ(vector<uint64_t>{ 1 }, expired);
+}
+
+TEST_F(TimerWheelTest, it_keeps_timers_beyond_one_turn_for_the_next_turns) {
+    wheel.schedule(at(10), 1);
+    wheel.schedule(at(90), 2);
+    wheel.schedule(at(170), 3);
+    ASSERT_EQ(3u, wheel.size());
+
+    wheel.advance(at(80), expired);
+    ASSERT_EQ(vector<uint64_t>{ 1 }, expired);
+    wheel.advance(at(160), expired);
+    ASSERT_EQ((vector<uint64_t>{ 1, 2 }), expired);
+    wheel.advance(at(170), expired);
+    ASSERT_EQ((vector<uint64_t>{ 1, 2, 3 }), expired);
+}
+
+TEST_F(TimerWheelTest, it_jumps_over_idle_periods) {
+    wheel.advance(at(1000000), expired);
+    ASSERT_EQ(at(1000010), wheel.getNextTick());
+    wheel.schedule(at(1000020), 1);
+    wheel.advance(at(1000020), expired);
+    ASSERT_EQ(vector<uint64_t>{ 1 }, expired);
+}
+
+TEST_F(TimerWheelTest, it_rejects_a_null_resolution) {
+    ASSERT_THROW(TimerWheel(Time(), 8), invalid_argument);
+}
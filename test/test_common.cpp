@@ -55,3 +55,176 @@ TEST_F(CommonTest, it_parses_a_read_digital_inputs_reply) {
     uint16_t expected[9] = { false, true, false, false, false, true, false, true, true };
     ASSERT_THAT(values, ElementsAreArray(expected));
 }
+
+TEST_F(CommonTest, it_parses_a_read_register_reply_from_a_frame_view) {
+    uint8_t payload[] = { 0x04, 0x1, 0x2, 0x3, 0x4 };
+    FrameView frame;
+    frame.address = 0x10;
+    frame.function = 0x03;
+    frame.payload = payload;
+    frame.payload_size = sizeof(payload);
+    uint16_t values[2];
+    common::parseReadRegisters(values, frame, 2);
+
+    uint16_t expected[] = { 0x0102, 0x0304 };
+    ASSERT_THAT(vector<uint16_t>(values, values + 2), ElementsAreArray(expected));
+}
+
+TEST_F(CommonTest, it_throws_if_a_read_register_reply_is_empty) {
+    FrameView frame;
+    ASSERT_THROW(common::parseReadRegisters(nullptr, frame, 2), UnexpectedReply);
+}
+
+TEST_F(CommonTest, it_parses_a_read_register_reply_from_a_static_frame) {
+    StaticFrame<8> frame;
+    frame.address = 0x10;
+    frame.function = 0x03;
+    frame.payload_size = 5;
+    uint8_t payload[] = { 0x04, 0x1, 0x2, 0x3, 0x4 };
+    std::copy(payload, payload + 5, frame.payload.begin());
+    uint16_t values[2];
+    common::parseReadRegisters(values, frame, 2);
+
+    uint16_t expected[] = { 0x0102, 0x0304 };
+    ASSERT_THAT(vector<uint16_t>(values, values + 2), ElementsAreArray(expected));
+}
+
+TEST_F(CommonTest, it_decodes_a_block_of_big_endian_values) {
+    for (size_t count = 0; count < 100; ++count) {
+        vector<uint8_t> buffer(count * 2);
+        for (auto& b : buffer) {
+            b = rand();
+        }
+
+        vector<uint16_t> expected(count);
+        for (size_t i = 0; i < count; ++i) {
+            common::parse16(&buffer[i * 2], expected[i]);
+        }
+
+        vector<uint16_t> values(count);
+        uint8_t const* end = common::parse16Block(values.data(), buffer.data(), count);
+        ASSERT_EQ(buffer.data() + count * 2, end);
+        ASSERT_EQ(expected, values);
+    }
+}
+
+TEST_F(CommonTest, it_decodes_a_block_of_big_endian_values_in_place) {
+    vector<uint16_t> values(77);
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(values.data());
+    for (size_t i = 0; i < values.size(); ++i) {
+        common::format16(buffer + i * 2, i * 0x0102);
+    }
+
+    common::parse16Block(values.data(), buffer, values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_EQ(i * 0x0102, values[i]);
+    }
+}
+
+TEST_F(CommonTest, it_encodes_a_block_of_values_in_big_endian) {
+    for (size_t count = 0; count < 100; ++count) {
+        vector<uint16_t> values(count);
+        for (auto& v : values) {
+            v = rand();
+        }
+
+        vector<uint8_t> expected(count * 2);
+        for (size_t i = 0; i < count; ++i) {
+            common::format16(&expected[i * 2], values[i]);
+        }
+
+        vector<uint8_t> buffer(count * 2);
+        uint8_t* end = common::format16Block(buffer.data(), values.data(), count);
+        ASSERT_EQ(buffer.data() + count * 2, end);
+        ASSERT_EQ(expected, buffer);
+    }
+}
+
+TEST_F(CommonTest, it_parses_a_read_digital_inputs_reply_into_packed_bits) {
+    Frame frame = { 0x10, 0x03, { 0x2, 0xa2, 0xff } };
+    uint8_t bits[2] = { 0xff, 0xff };
+    common::parseReadDigitalInputs(bits, FrameView(frame), 9);
+
+    ASSERT_EQ(0xa2, bits[0]);
+    ASSERT_EQ(0x01, bits[1]);
+}
+
+TEST_F(CommonTest, it_throws_if_a_packed_digital_inputs_reply_is_too_short) {
+    Frame frame = { 0x10, 0x03, { 0x1, 0xa2 } };
+    uint8_t bits[2];
+    ASSERT_THROW(common::parseReadDigitalInputs(bits, FrameView(frame), 9),
+                 UnexpectedReply);
+}
+
+TEST_F(CommonTest, it_unpacks_bits_into_booleans) {
+    uint8_t bits[] = { 0xa2, 0x05 };
+    bool values[11];
+    common::unpackBits(values, bits, 11);
+
+    bool expected[11] = { false, true, false, false, false, true, false, true,
+                          true, false, true };
+    ASSERT_THAT(vector<bool>(values, values + 11), ElementsAreArray(expected));
+}
+
+TEST_F(CommonTest, it_reports_an_unexpected_register_count_without_throwing) {
+    Frame frame = { 0x10, 0x03, { 2, 1, 2 } };
+    uint16_t values[2];
+    Result result = common::tryParseReadRegisters(values, FrameView(frame), 2);
+    ASSERT_EQ(RESULT_UNEXPECTED_REPLY, result.code);
+}
+
+TEST_F(CommonTest, it_accepts_a_reply_with_the_request_function) {
+    Frame frame = { 0x10, 0x03, { 2, 1, 2 } };
+    ASSERT_TRUE(common::checkReply(FrameView(frame), 0x03).ok());
+}
+
+TEST_F(CommonTest, it_reports_an_exception_reply) {
+    Frame frame = { 0x10, 0x83, { 2 } };
+    Result result = common::checkReply(FrameView(frame), 0x03);
+    ASSERT_EQ(RESULT_REQUEST_EXCEPTION, result.code);
+    ASSERT_EQ(0x03, result.function_code);
+    ASSERT_EQ(2, result.exception_code);
+}
+
+TEST_F(CommonTest, it_reports_a_reply_with_an_unexpected_function) {
+    Frame frame = { 0x10, 0x04, { 2 } };
+    Result result = common::checkReply(FrameView(frame), 0x03);
+    ASSERT_EQ(RESULT_UNEXPECTED_REPLY, result.code);
+}
+
+TEST_F(CommonTest, it_accepts_a_write_multiple_reply_that_echoes_the_request) {
+    Frame frame = { 0x10, 0x10, { 0x12, 0x34, 0, 2 } };
+    ASSERT_TRUE(common::checkWriteMultipleReply(FrameView(frame), 0x1234, 2).ok());
+}
+
+TEST_F(CommonTest, it_rejects_a_write_multiple_reply_that_does_not_echo_the_request) {
+    Frame frame = { 0x10, 0x10, { 0x12, 0x34, 0, 3 } };
+    Result result = common::checkWriteMultipleReply(FrameView(frame), 0x1234, 2);
+    ASSERT_EQ(RESULT_UNEXPECTED_REPLY, result.code);
+}
+
+TEST_F(CommonTest, it_packs_booleans_into_bits) {
+    vector<bool> values = { false, true, false, true, true, false, true, true,
+                            true, false, true, false };
+    uint8_t bits[2] = { 0xff, 0xff };
+    common::packBits(bits, values, 1, 10);
+    ASSERT_EQ(0xed, bits[0]);
+    ASSERT_EQ(0x02, bits[1]);
+}
+
+TEST_F(CommonTest, it_rejects_a_mask_write_reply_that_does_not_echo_the_request) {
+    Frame frame = { 0x11, 0x16, { 0, 4, 0, 0xf2, 0, 0x24 } };
+    Result result = common::checkMaskWriteReply(FrameView(frame), 4, 0xf2, 0x25);
+    ASSERT_EQ(RESULT_UNEXPECTED_REPLY, result.code);
+}
+
+TEST_F(CommonTest, it_reports_the_sizes_when_the_byte_count_and_payload_size_differ) {
+    Frame frame = { 0x10, 0x03, { 0x06, 0x1, 0x2, 0x3, 0x4, 0x5 } };
+    try {
+        common::parseReadRegisters(nullptr, frame, 2);
+        FAIL();
+    }
+    catch(UnexpectedReply const& e) {
+        ASSERT_THAT(e.what(), testing::HasSubstr("(7 != 6)"));
+    }
+}